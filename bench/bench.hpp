@@ -0,0 +1,112 @@
+/**
+ * @file bench.hpp
+ * @author Mateus Lima Alves (mateuslima.ti@gmail.com)
+ * @brief Shared microbenchmark harness. Counts heap allocations by replacing
+ * the global operator new, so it must be included by one translation unit
+ * per benchmark binary. Every result is printed for humans and, when the
+ * BENCH_OUTPUT environment variable names a file, appended to it as one
+ * JSON object per line.
+ * @version 0.1
+ * @date 2022-03-28
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef __BENCH_HPP__
+#define __BENCH_HPP__
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <new>
+
+#define BENCH_ITERATIONS    1000000UL
+
+/**
+ * @brief ICMP payload lengths, in octets, covered by the packet benchmarks:
+ * an empty probe, the classic ping payload and a near-MTU payload.
+ *
+ */
+static const size_t bench_payloads[] = {0, 56, 1400};
+
+/**
+ * @brief Number of heap allocations done since the program started.
+ *
+ */
+static size_t bench_allocations = 0;
+
+void *operator new(size_t size)
+{
+    void *pointer;
+
+    bench_allocations++;
+    pointer = malloc(size ? size : 1);
+    if (pointer == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return pointer;
+}
+
+void operator delete(void *pointer) noexcept
+{
+    free(pointer);
+}
+
+void operator delete(void *pointer, size_t) noexcept
+{
+    free(pointer);
+}
+
+/**
+ * @brief Runs a benchmark and reports time, allocations and rate per packet.
+ *
+ * @param suite Benchmark suite, the binary name without the bench_ prefix.
+ * @param name Benchmark name.
+ * @param length Packet length in octets.
+ * @param iterations Number of packets.
+ * @param function Function that handles one packet, given its index.
+ */
+template <typename Function>
+static void bench_run(const char *suite, const char *name, size_t length, size_t iterations,
+                      Function function)
+{
+    static FILE *output = nullptr;
+    size_t allocations_before = bench_allocations;
+    double ns, allocations, rate;
+    const char *path;
+    char label[64];
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; i++)
+    {
+        function(i);
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    ns = std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+    allocations = (double)(bench_allocations - allocations_before) / iterations;
+    rate = 1e9 / ns;
+
+    snprintf(label, sizeof(label), "%s/%s", suite, name);
+    printf("%-32s %5zu bytes %8.1f ns/packet %6.2f allocations/packet %12.0f packets/s\n",
+           label, length, ns, allocations, rate);
+
+    path = getenv("BENCH_OUTPUT");
+    if (output == nullptr && path != nullptr && *path != '\0')
+    {
+        output = fopen(path, "a");
+    }
+    if (output != nullptr)
+    {
+        fprintf(output, "{\"suite\":\"%s\",\"name\":\"%s\",\"length\":%zu,\"iterations\":%zu,"
+                "\"ns_per_packet\":%.2f,\"allocations_per_packet\":%.3f,"
+                "\"packets_per_second\":%.0f}\n",
+                suite, name, length, iterations, ns, allocations, rate);
+        fflush(output);
+    }
+}
+
+#endif //__BENCH_HPP__
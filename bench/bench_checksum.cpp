@@ -0,0 +1,90 @@
+/**
+ * @file bench_checksum.cpp
+ * @author Mateus Lima Alves (mateuslima.ti@gmail.com)
+ * @brief Microbenchmark of the internet checksum kernel selected for this
+ * CPU, of the ICMP and IPv4 update_checksum methods and of the incremental
+ * checksum update.
+ * @version 0.1
+ * @date 2022-03-20
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include "bench.hpp"
+#include <checksum.hpp>
+#include <icmp.hpp>
+#include <ipv4.hpp>
+#include <string>
+#include <vector>
+
+/**
+ * @brief ICMP packet exposing its checksum update.
+ *
+ */
+class BenchIcmp : public Icmp
+{
+public:
+    explicit BenchIcmp() : Icmp(ECHO)
+    {
+    }
+    using Icmp::update_checksum;
+};
+
+/**
+ * @brief IPv4 datagram exposing its checksum update.
+ *
+ */
+class BenchIpv4 : public Ipv4
+{
+public:
+    using Ipv4::update_checksum;
+};
+
+/**
+ * @brief benchmark main function.
+ *
+ * @return int
+ */
+int main()
+{
+    const size_t lengths[] = {20, 64, 1400, 9000};
+    std::string name = std::string("internet_checksum_") + checksum_kernel();
+    volatile uint16_t sink = 0;
+    BenchIcmp icmp;
+    BenchIpv4 ipv4;
+
+    for (size_t length : lengths)
+    {
+        std::vector<uint8_t> buffer(length);
+        for (size_t i = 0; i < length; i++)
+        {
+            buffer[i] = (uint8_t)rand();
+        }
+
+        bench_run("checksum", name.c_str(), length, BENCH_ITERATIONS, [&](size_t i) {
+            buffer[0] = (uint8_t)i;
+            sink = sink + internet_checksum(buffer.data(), buffer.size());
+        });
+
+        bench_run("checksum", "icmp_update_checksum", length, BENCH_ITERATIONS, [&](size_t i) {
+            buffer[0] = (uint8_t)i;
+            icmp.update_checksum(buffer.data(), buffer.size());
+        });
+    }
+
+    {
+        std::vector<uint8_t> header(IP_MIN_LENGTH, 0x45);
+
+        bench_run("checksum", "ipv4_update_checksum", header.size(), BENCH_ITERATIONS, [&](size_t i) {
+            header[8] = (uint8_t)i;
+            ipv4.update_checksum(header.data());
+        });
+    }
+
+    bench_run("checksum", "checksum_adjust", sizeof(uint16_t), BENCH_ITERATIONS, [&](size_t i) {
+        sink = checksum_adjust(sink, (uint16_t)(i - 1), (uint16_t)i);
+    });
+
+    return EXIT_SUCCESS;
+}
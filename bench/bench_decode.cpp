@@ -0,0 +1,58 @@
+/**
+ * @file bench_decode.cpp
+ * @author Mateus Lima Alves (mateuslima.ti@gmail.com)
+ * @brief Microbenchmark of the zero-copy Ipv4View and IcmpView decoders,
+ * including the checksum verification, for ECHO_REPLY datagrams of several
+ * payload lengths.
+ * @version 0.1
+ * @date 2022-03-28
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include "bench.hpp"
+#include <icmp.hpp>
+#include <ipv4.hpp>
+#include <ipv4_view.hpp>
+#include <icmp_view.hpp>
+#include <vector>
+
+/**
+ * @brief benchmark main function.
+ *
+ * @return int
+ */
+int main()
+{
+    static uint8_t frame[IP_MAX_LENGTH];
+    volatile size_t sink = 0;
+
+    for (size_t payload : bench_payloads)
+    {
+        Icmp icmp(ECHO_REPLY);
+        Ipv4 ipv4;
+        Ipv4View ipv4_view;
+        IcmpView icmp_view;
+        size_t length;
+
+        icmp.set_data(std::vector<uint8_t>(payload, 0xA5));
+        ipv4.set_protocol_number(ICMP_NUMBER);
+        ipv4.set_source_address(0x0100007F);
+        ipv4.set_destination_address(0x0100007F);
+        length = ipv4.encode_into(frame, sizeof(frame), icmp);
+
+        bench_run("decode", "ipv4_view", length, BENCH_ITERATIONS, [&](size_t) {
+            sink = sink + ipv4_view.parse(frame, length);
+        });
+
+        bench_run("decode", "ipv4_icmp_view", length, BENCH_ITERATIONS, [&](size_t) {
+            if (ipv4_view.parse(frame, length) &&
+                icmp_view.parse(ipv4_view.get_data(), ipv4_view.get_data_length()))
+            {
+                sink = sink + icmp_view.get_sequence_number();
+            }
+        });
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,118 @@
+/**
+ * @file bench_encode.cpp
+ * @author Mateus Lima Alves (mateuslima.ti@gmail.com)
+ * @brief Microbenchmark comparing the allocating encode paths, the
+ * zero-allocation encode_into paths, the compile-time IcmpMessage and the
+ * precompiled probe template for IPv4 + ICMP ECHO probes of several payload
+ * lengths.
+ * @version 0.1
+ * @date 2022-03-20
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include "bench.hpp"
+#include <icmp.hpp>
+#include <icmp_message.hpp>
+#include <ipv4.hpp>
+#include <probe_template.hpp>
+#include <packet_pool.hpp>
+#include <vector>
+
+/**
+ * @brief benchmark main function.
+ *
+ * @return int
+ */
+int main()
+{
+    static uint8_t frame[IP_MAX_LENGTH];
+    volatile size_t sink = 0;
+
+    bench_run("encode", "ipv4_construct", IP_MIN_LENGTH, BENCH_ITERATIONS, [&](size_t) {
+        Ipv4 ipv4;
+        sink = sink + ipv4.get_header_length();
+    });
+
+    for (size_t payload : bench_payloads)
+    {
+        Icmp icmp(ECHO);
+        Ipv4 ipv4;
+        size_t length;
+
+        icmp.set_data(std::vector<uint8_t>(payload, 0xA5));
+        ipv4.set_protocol_number(ICMP_NUMBER);
+        ipv4.set_source_address(0x0100007F);
+        ipv4.set_destination_address(0x0100007F);
+        length = ipv4.encode_into(frame, sizeof(frame), icmp);
+
+        bench_run("encode", "icmp_encode", icmp.get_length(), BENCH_ITERATIONS, [&](size_t i) {
+            icmp.set_sequence_number((uint16_t)i);
+            sink = sink + icmp.encode().size();
+        });
+
+        bench_run("encode", "icmp_encode_into", icmp.get_length(), BENCH_ITERATIONS, [&](size_t i) {
+            icmp.set_sequence_number((uint16_t)i);
+            sink = sink + icmp.encode_into(frame, sizeof(frame));
+        });
+
+        std::vector<uint8_t> reuse_buffer(payload, 0x5A);
+        bench_run("encode", "icmp_reuse_encode_into", icmp.get_length(), BENCH_ITERATIONS,
+                  [&](size_t i) {
+            icmp.reset();
+            icmp.set_sequence_number((uint16_t)i);
+            icmp.set_data(reuse_buffer.data(), reuse_buffer.size());
+            sink = sink + icmp.encode_into(frame, sizeof(frame));
+        });
+
+        bench_run("encode", "ipv4_encode", length, BENCH_ITERATIONS, [&](size_t i) {
+            icmp.set_sequence_number((uint16_t)i);
+            ipv4.set_data(icmp.encode());
+            sink = sink + ipv4.encode().size();
+        });
+
+        bench_run("encode", "ipv4_encode_into", length, BENCH_ITERATIONS, [&](size_t i) {
+            icmp.set_sequence_number((uint16_t)i);
+            sink = sink + ipv4.encode_into(frame, sizeof(frame), icmp);
+        });
+
+        IcmpMessage<ECHO> message;
+        std::vector<uint8_t> payload_buffer(payload, 0xA5);
+        message.set_payload(payload_buffer.data(), payload_buffer.size());
+
+        bench_run("encode", "icmp_message_encode_into", message.get_length(), BENCH_ITERATIONS,
+                  [&](size_t i) {
+            message.set_sequence_number((uint16_t)i);
+            sink = sink + message.encode_into(frame, sizeof(frame));
+        });
+
+        bench_run("encode", "ipv4_icmp_message", length, BENCH_ITERATIONS, [&](size_t i) {
+            size_t header_length = ipv4.get_header_length();
+
+            message.set_sequence_number((uint16_t)i);
+            header_length += message.encode_into(frame + header_length, sizeof(frame) - header_length);
+            sink = sink + ipv4.encode_header_into(frame, sizeof(frame), message.get_length());
+        });
+
+        PacketPool pool(length, 64);
+        bench_run("encode", "pool_ipv4_icmp_message", length, BENCH_ITERATIONS, [&](size_t i) {
+            uint8_t *pool_frame = pool.acquire();
+            size_t header_length = ipv4.get_header_length();
+
+            message.set_sequence_number((uint16_t)i);
+            message.encode_into(pool_frame + header_length, pool.get_frame_size() - header_length);
+            sink = sink + ipv4.encode_header_into(pool_frame, pool.get_frame_size(),
+                                                  message.get_length());
+            pool.release(pool_frame);
+        });
+
+        ProbeTemplate probe(ipv4, icmp);
+        bench_run("encode", "template", length, BENCH_ITERATIONS, [&](size_t i) {
+            probe.set_destination_address((uint32_t)i);
+            probe.set_sequence_number((uint16_t)i);
+            sink = sink + probe.get_length();
+        });
+    }
+    return EXIT_SUCCESS;
+}
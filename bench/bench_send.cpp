@@ -0,0 +1,131 @@
+/**
+ * @file bench_send.cpp
+ * @author Mateus Lima Alves (mateuslima.ti@gmail.com)
+ * @brief Microbenchmark of Socket::send_raw, Socket::send_gather and
+ * Socket::send_batch to a loopback sink. The gather variants share one
+ * payload buffer between every probe, the pcap variant captures every probe
+ * to a file. The probes are ECHO_REPLY messages, which the kernel
+ * delivers to nobody, so only the send path is measured. Needs CAP_NET_RAW
+ * and is skipped without it.
+ * @version 0.1
+ * @date 2022-03-28
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include "bench.hpp"
+#include <icmp.hpp>
+#include <ipv4.hpp>
+#include <socket.hpp>
+#include <pcap_writer.hpp>
+#include <probe_template.hpp>
+#include <exceptions.hpp>
+#include <memory>
+#include <vector>
+#include <cstring>
+#include <unistd.h>
+
+#define BENCH_SEND_ITERATIONS   200000UL
+#define BENCH_SEND_SINK         0x0100007FU     // 127.0.0.1, in network byte order.
+#define BENCH_SEND_CAPTURE      "build/bench_send.pcap"
+
+/**
+ * @brief benchmark main function.
+ *
+ * @return int
+ */
+int main()
+{
+    std::unique_ptr<Socket> socket;
+
+    try
+    {
+        socket = std::make_unique<Socket>();
+    }
+    catch (const std::exception &e)
+    {
+        printf("send/skipped: %s\n", e.what());
+        return EXIT_SUCCESS;
+    }
+
+    for (size_t payload : bench_payloads)
+    {
+        Icmp icmp(ECHO_REPLY);
+        Ipv4 ipv4;
+
+        icmp.set_data(std::vector<uint8_t>(payload, 0xA5));
+        ipv4.set_protocol_number(ICMP_NUMBER);
+        ipv4.set_source_address(BENCH_SEND_SINK);
+        ipv4.set_destination_address(BENCH_SEND_SINK);
+
+        ProbeTemplate probe(ipv4, icmp);
+        std::vector<uint8_t> buffers(SOCKET_BATCH_MAX * probe.get_length());
+        std::vector<socket_frame_t> frames(SOCKET_BATCH_MAX);
+
+        bench_run("send", "send_raw", probe.get_length(), BENCH_SEND_ITERATIONS, [&](size_t i) {
+            probe.set_sequence_number((uint16_t)i);
+            socket->send_raw(probe.data(), probe.get_length(), BENCH_SEND_SINK);
+        });
+
+        for (size_t i = 0; i < SOCKET_BATCH_MAX; i++)
+        {
+            memcpy(&buffers[i * probe.get_length()], probe.data(), probe.get_length());
+            frames[i].data = &buffers[i * probe.get_length()];
+            frames[i].length = probe.get_length();
+            frames[i].destination_address = BENCH_SEND_SINK;
+        }
+
+        /* One iteration is one batch, reported per packet. */
+        bench_run("send", "send_batch", probe.get_length(), BENCH_SEND_ITERATIONS, [&](size_t i) {
+            if (i % SOCKET_BATCH_MAX == SOCKET_BATCH_MAX - 1)
+            {
+                socket->send_batch(frames.data(), SOCKET_BATCH_MAX);
+            }
+        });
+
+        {
+            PcapWriter capture(BENCH_SEND_CAPTURE);
+
+            Socket::set_capture(&capture);
+            bench_run("send", "send_batch_pcap", probe.get_length(), BENCH_SEND_ITERATIONS, [&](size_t i) {
+                if (i % SOCKET_BATCH_MAX == SOCKET_BATCH_MAX - 1)
+                {
+                    socket->send_batch(frames.data(), SOCKET_BATCH_MAX);
+                }
+            });
+            Socket::set_capture(nullptr);
+        }
+        unlink(BENCH_SEND_CAPTURE);
+
+        Icmp header(ECHO_REPLY);
+        std::vector<uint8_t> payload_buffer(payload, 0xA5);
+        ProbeTemplate gather(ipv4, header);
+        std::vector<struct iovec> vectors(SOCKET_BATCH_MAX * PROBE_VECTORS_MAX);
+
+        gather.set_payload(payload_buffer.data(), payload_buffer.size());
+
+        bench_run("send", "send_gather", gather.get_length(), BENCH_SEND_ITERATIONS, [&](size_t i) {
+            gather.set_sequence_number((uint16_t)i);
+            socket->send_gather(vectors.data(), gather.get_vectors(vectors.data()), BENCH_SEND_SINK);
+        });
+
+        /* Every probe gets its own header copy, the payload is shared. */
+        bench_run("send", "send_batch_gather", gather.get_length(), BENCH_SEND_ITERATIONS, [&](size_t i) {
+            size_t index = i % SOCKET_BATCH_MAX;
+            struct iovec *frame_vectors = &vectors[index * PROBE_VECTORS_MAX];
+
+            gather.set_sequence_number((uint16_t)i);
+            memcpy(&buffers[index * gather.get_header_length()], gather.data(),
+                   gather.get_header_length());
+            frames[index].vectors_count = gather.get_vectors(frame_vectors);
+            frames[index].vectors = frame_vectors;
+            frame_vectors[0].iov_base = &buffers[index * gather.get_header_length()];
+            if (index == SOCKET_BATCH_MAX - 1)
+            {
+                socket->send_batch(frames.data(), SOCKET_BATCH_MAX);
+            }
+        });
+    }
+    return EXIT_SUCCESS;
+}
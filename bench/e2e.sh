@@ -0,0 +1,148 @@
+#!/bin/sh
+#
+# @file e2e.sh
+# @author Mateus Lima Alves (mateuslima.ti@gmail.com)
+# @brief End-to-end throughput and latency benchmark. Runs the ping mode
+# against a veth peer living in its own network namespace (or against
+# loopback) at fixed offered loads, once per send strategy, and writes a
+# report with the achieved rate, the loss and the RTT distribution.
+# @version 0.1
+# @date 2022-03-29
+#
+# @copyright Copyright (c) 2022
+#
+# usage: sudo bench/e2e.sh [--loopback] [--responder] [--count N] [--rates "PPS ..."]
+#                          [--batches "N ..."] [--output FILE]
+#
+# A rate of 0 sends as fast as possible. A batch of 1 sends every probe with
+# its own sendto call, larger batches use sendmmsg. --responder answers the
+# probes with the responder mode inside the namespace instead of the kernel.
+
+set -eu
+
+BINARY=./build/icmp-client
+NAMESPACE=icmp-e2e
+HOST_LINK=icmp-e2e0
+PEER_LINK=icmp-e2e1
+HOST_ADDRESS=10.250.0.1
+PEER_ADDRESS=10.250.0.2
+
+mode=veth
+responder=no
+count=100000
+rates="10000 100000 0"
+batches="1 8 64"
+output=build/e2e_report.md
+
+while [ $# -gt 0 ]; do
+    case "$1" in
+    --loopback) mode=loopback ;;
+    --responder) responder=yes ;;
+    --count) count=$2; shift ;;
+    --rates) rates=$2; shift ;;
+    --batches) batches=$2; shift ;;
+    --output) output=$2; shift ;;
+    *) echo "usage: $0 [--loopback] [--responder] [--count N] [--rates \"PPS ...\"]" \
+            "[--batches \"N ...\"] [--output FILE]" >&2; exit 1 ;;
+    esac
+    shift
+done
+
+if [ ! -x "$BINARY" ]; then
+    echo "$BINARY not found, run make first" >&2
+    exit 1
+fi
+
+cleanup() {
+    if [ -n "${responder_pid:-}" ]; then
+        kill "$responder_pid" 2>/dev/null || true
+        wait "$responder_pid" 2>/dev/null || true
+    fi
+    ip link del "$HOST_LINK" 2>/dev/null || true
+    ip netns del "$NAMESPACE" 2>/dev/null || true
+}
+
+if [ "$mode" = veth ]; then
+    cleanup
+    trap cleanup EXIT INT TERM
+    ip netns add "$NAMESPACE"
+    ip link add "$HOST_LINK" type veth peer name "$PEER_LINK"
+    ip link set "$PEER_LINK" netns "$NAMESPACE"
+    ip addr add "$HOST_ADDRESS/30" dev "$HOST_LINK"
+    ip link set "$HOST_LINK" up
+    ip -n "$NAMESPACE" addr add "$PEER_ADDRESS/30" dev "$PEER_LINK"
+    ip -n "$NAMESPACE" link set "$PEER_LINK" up
+    ip -n "$NAMESPACE" link set lo up
+    # The peer must answer every probe, without the kernel rate limit.
+    ip netns exec "$NAMESPACE" sysctl -qw net.ipv4.icmp_ratelimit=0
+    if [ "$responder" = yes ]; then
+        ip netns exec "$NAMESPACE" sysctl -qw net.ipv4.icmp_echo_ignore_all=1
+        ip netns exec "$NAMESPACE" "$BINARY" responder --quiet > /dev/null &
+        responder_pid=$!
+        sleep 1
+    fi
+    source=$HOST_ADDRESS
+    destination=$PEER_ADDRESS
+else
+    source=127.0.0.1
+    destination=127.0.0.1
+fi
+
+mkdir -p "$(dirname "$output")"
+json="${output%.*}.jsonl"
+: > "$json"
+
+{
+    echo "# End-to-end benchmark"
+    echo
+    echo "$mode, $([ "$responder" = yes ] && echo "responder mode" || echo "kernel") replies, $count probes per run, $(uname -r), $(nproc) CPUs"
+    echo
+    echo "| strategy | offered pps | achieved pps | received | kernel drops | loss % | p50 ms | p99 ms | p999 ms |"
+    echo "|---|---|---|---|---|---|---|---|---|"
+} > "$output"
+
+for batch in $batches; do
+    if [ "$batch" -eq 1 ]; then
+        strategy=sendto
+    else
+        strategy="sendmmsg/$batch"
+    fi
+    for rate in $rates; do
+        if [ "$rate" -eq 0 ]; then
+            pacing=""
+            offered=max
+        else
+            pacing="--rate $rate"
+            offered=$rate
+        fi
+
+        # shellcheck disable=SC2086
+        result=$("$BINARY" --quiet --count "$count" --batch "$batch" $pacing \
+                 "$source" "$destination" || true)
+
+        # "N packets transmitted, R received, F send errors, D kernel drops,
+        #  L% loss, sent in T s (P pps)" then the RTT line, when any reply.
+        echo "$result" | awk -v strategy="$strategy" -v offered="$offered" \
+                             -v markdown="$output" -v json="$json" '
+            /packets transmitted/ {
+                received = $4; drops = $9; loss = $12; sub("%", "", loss)
+                pps = $18; sub("\\(", "", pps)
+            }
+            /^rtt/ {
+                split($NF == "ms" ? $(NF - 1) : $NF, percentiles, "/")
+            }
+            END {
+                printf("| %s | %s | %s | %s | %s | %s | %s | %s | %s |\n", strategy, offered,
+                       pps, received, drops, loss, percentiles[1], percentiles[2],
+                       percentiles[3]) >> markdown
+                printf("{\"strategy\":\"%s\",\"offered_pps\":\"%s\",\"achieved_pps\":%s," \
+                       "\"received\":%s,\"kernel_drops\":%s,\"loss_percent\":%s," \
+                       "\"p50_ms\":%s,\"p99_ms\":%s,\"p999_ms\":%s}\n", strategy, offered,
+                       pps, received, drops, loss, percentiles[1] + 0, percentiles[2] + 0,
+                       percentiles[3] + 0) >> json
+            }'
+        echo "$strategy at $offered pps done"
+    done
+done
+
+cat "$output"
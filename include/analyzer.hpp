@@ -0,0 +1,234 @@
+/**
+ * @file analyzer.hpp
+ * @author Mateus Lima Alves (mateuslima.ti@gmail.com)
+ * @brief Offline capture analyzer. Pairs the ECHO requests of a capture
+ * with their ECHO_REPLY by (source, destination, identifier, sequence
+ * number) and computes the loss and the round trip time distribution of
+ * every target. The capture is split into record ranges that are analyzed
+ * by one thread each; the replies a range could not pair are paired with
+ * the requests left unanswered by the ranges before it when the results
+ * are merged.
+ * @version 0.1
+ * @date 2022-04-08
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef __ANALYZER_HPP__
+#define __ANALYZER_HPP__
+
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+
+#include <latency_histogram.hpp>
+#include <compact_histogram.hpp>
+
+/**
+ * @brief ECHO statistics of a target.
+ *
+ */
+typedef struct analyze_target
+{
+    /** Target address, in network byte order. */
+    uint32_t address;
+    /** ECHO requests sent to the target. */
+    uint64_t requests;
+    /** Requests answered. */
+    uint64_t replies;
+    /** Sum, minimum and maximum of the round trip times, in nanoseconds. */
+    uint64_t rtt_sum;
+    uint64_t rtt_min;
+    uint64_t rtt_max;
+    /** Round trip time distribution. */
+    CompactHistogram rtt;
+} analyze_target_t;
+
+/**
+ * @brief Totals of an analysis.
+ *
+ */
+typedef struct analyze_summary
+{
+    /** IPv4 datagrams read. */
+    uint64_t datagrams;
+    /** Records skipped: not IPv4, or not a valid ICMP message. */
+    uint64_t skipped;
+    /** ECHO requests. */
+    uint64_t requests;
+    /** ECHO_REPLY paired with a request. */
+    uint64_t replies;
+    /** ECHO_REPLY without a request: duplicates, or requests sent before the capture. */
+    uint64_t unmatched;
+    /** Number of ranges analyzed in parallel. */
+    size_t chunks;
+    /** Whether the capture ends in the middle of a record. */
+    bool truncated;
+    /** Time the analysis took, in nanoseconds. */
+    uint64_t duration;
+} analyze_summary_t;
+
+/**
+ * @brief Capture analyzer class.
+ *
+ */
+class Analyzer
+{
+public:
+    /**
+     * @brief Construct a new Analyzer object
+     *
+     * @param path Capture file path.
+     * @param threads Number of threads, zero for one per CPU.
+     */
+    explicit Analyzer(const char *path, size_t threads = 0);
+
+    /**
+     * @brief Destroy the Analyzer object
+     *
+     */
+    virtual ~Analyzer();
+
+    /**
+     * @brief Analyzes the whole capture.
+     *
+     */
+    void run();
+
+    /**
+     * @brief Get the totals of the analysis.
+     *
+     * @return const analyze_summary_t&
+     */
+    const analyze_summary_t &get_summary();
+
+    /**
+     * @brief Get the statistics of every target, by address.
+     *
+     * @return const std::vector<analyze_target_t>&
+     */
+    const std::vector<analyze_target_t> &get_targets();
+
+    /**
+     * @brief Get the round trip time distribution of every pair.
+     *
+     * @return const LatencyHistogram&
+     */
+    const LatencyHistogram &get_rtt();
+
+private:
+    /**
+     * @brief Key of an ECHO exchange, from the request point of view.
+     *
+     */
+    typedef struct analyze_key
+    {
+        uint32_t source_address;
+        uint32_t destination_address;
+        uint16_t identifier;
+        uint16_t sequence_number;
+
+        bool operator==(const analyze_key &other) const
+        {
+            return this->source_address == other.source_address &&
+                   this->destination_address == other.destination_address &&
+                   this->identifier == other.identifier && this->sequence_number == other.sequence_number;
+        }
+    } analyze_key_t;
+
+    /**
+     * @brief Hash of an exchange key.
+     *
+     */
+    typedef struct analyze_key_hash
+    {
+        size_t operator()(const analyze_key_t &key) const
+        {
+            uint64_t hash = ((uint64_t)key.source_address << 32 | key.destination_address) *
+                            0x9E3779B97F4A7C15ULL;
+
+            return (size_t)(hash ^ (hash >> 29) ^ ((uint64_t)key.identifier << 16 | key.sequence_number) *
+                                                  0xC2B2AE3D27D4EB4FULL);
+        }
+    } analyze_key_hash_t;
+
+    /**
+     * @brief ECHO_REPLY a range could not pair.
+     *
+     */
+    typedef struct analyze_orphan
+    {
+        /** Key of the request it answers. */
+        analyze_key_t key;
+        /** Capture time in nanoseconds. */
+        uint64_t timestamp;
+    } analyze_orphan_t;
+
+    /**
+     * @brief Results of a record range.
+     *
+     */
+    typedef struct analyze_chunk
+    {
+        /** Targets seen, by address. */
+        std::unordered_map<uint32_t, analyze_target_t> targets;
+        /** Requests left unanswered, with their capture time. */
+        std::unordered_map<analyze_key_t, uint64_t, analyze_key_hash_t> pending;
+        /** Replies not paired, in capture order. */
+        std::vector<analyze_orphan_t> orphans;
+        /** Round trip times of the range. */
+        LatencyHistogram rtt;
+        /** Totals of the range. */
+        analyze_summary_t summary;
+    } analyze_chunk_t;
+
+    /**
+     * @brief Analyzes the records in [begin, end).
+     *
+     * @param chunk Results of the range.
+     * @param begin Offset of the first record.
+     * @param end Offset past the last record.
+     */
+    void analyze(analyze_chunk_t *chunk, size_t begin, size_t end);
+
+    /**
+     * @brief Records a paired exchange.
+     *
+     * @param target Target of the request.
+     * @param histogram Round trip times of the range.
+     * @param rtt Round trip time in nanoseconds.
+     */
+    static void record(analyze_target_t *target, LatencyHistogram *histogram, uint64_t rtt);
+
+    /**
+     * @brief Merges the results of every range, in capture order.
+     *
+     * @param chunks Results of every range.
+     */
+    void merge(std::vector<analyze_chunk_t> &chunks);
+
+    /**
+     * @brief Capture file path.
+     */
+    const char *path;
+    /**
+     * @brief Number of threads.
+     */
+    size_t threads;
+    /**
+     * @brief Totals of the analysis.
+     */
+    analyze_summary_t summary;
+    /**
+     * @brief Statistics of every target, by address.
+     */
+    std::vector<analyze_target_t> targets;
+    /**
+     * @brief Round trip time distribution of every pair.
+     */
+    LatencyHistogram rtt;
+};
+
+#endif //__ANALYZER_HPP__
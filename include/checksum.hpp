@@ -0,0 +1,69 @@
+/**
+ * @file checksum.hpp
+ * @author Mateus Lima Alves (mateuslima.ti@gmail.com)
+ * @brief Internet checksum according rfc1071
+ * (https://datatracker.ietf.org/doc/html/rfc1071), shared by the IPv4 and
+ * ICMP packets. The summing kernel is vectorized (SSE2/AVX2) when the CPU
+ * supports it, with a portable fallback otherwise.
+ * @version 0.1
+ * @date 2022-03-20
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef __CHECKSUM_HPP__
+#define __CHECKSUM_HPP__
+
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * @brief Adds the 16 bit big-endian words of a buffer to a partial one's
+ * complement sum. Partial sums of consecutive buffers may be chained, as long
+ * as every buffer but the last one has an even length.
+ *
+ * @param buffer Data to be summed.
+ * @param length Data length in octets, odd lengths are zero padded.
+ * @param sum Partial sum of the previous buffers.
+ * @return uint32_t Partial sum including this buffer.
+ */
+uint32_t checksum_partial(const uint8_t *buffer, size_t length, uint32_t sum = 0);
+
+/**
+ * @brief Folds a partial sum into the 16 bit one's complement checksum.
+ *
+ * @param sum Partial sum.
+ * @return uint16_t Checksum, in host byte order.
+ */
+uint16_t checksum_fold(uint32_t sum);
+
+/**
+ * @brief Computes the internet checksum of a buffer.
+ *
+ * @param buffer Data to be summed.
+ * @param length Data length in octets.
+ * @return uint16_t Checksum, in host byte order.
+ */
+uint16_t internet_checksum(const uint8_t *buffer, size_t length);
+
+/**
+ * @brief Updates a checksum after one 16 bit word of the summed data changed,
+ * without summing the data again, according rfc1624 equation 3
+ * (https://datatracker.ietf.org/doc/html/rfc1624).
+ *
+ * @param checksum Current checksum, in host byte order.
+ * @param old_word Previous value of the changed word.
+ * @param new_word New value of the changed word.
+ * @return uint16_t Updated checksum, in host byte order.
+ */
+uint16_t checksum_adjust(uint16_t checksum, uint16_t old_word, uint16_t new_word);
+
+/**
+ * @brief Get the name of the summing kernel selected for this CPU.
+ *
+ * @return const char*
+ */
+const char *checksum_kernel();
+
+#endif //__CHECKSUM_HPP__
@@ -0,0 +1,123 @@
+/**
+ * @file compact_histogram.hpp
+ * @author Mateus Lima Alves (mateuslima.ti@gmail.com)
+ * @brief Sparse latency histogram, with the buckets of LatencyHistogram but
+ * only storing the ones that counted a value, eight octets each. Latencies
+ * of one target usually fall in a handful of buckets, so one of them per
+ * target costs tens of octets instead of kilobytes. Not thread safe.
+ * @version 0.1
+ * @date 2022-04-08
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef __COMPACT_HISTOGRAM_HPP__
+#define __COMPACT_HISTOGRAM_HPP__
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include <latency_histogram.hpp>
+
+/**
+ * @brief Low bits of an entry holding the bucket index, the count is in the
+ * high ones.
+ *
+ */
+#define COMPACT_HISTOGRAM_BUCKET_BITS   10U
+#define COMPACT_HISTOGRAM_BUCKET_MASK   ((1ULL << COMPACT_HISTOGRAM_BUCKET_BITS) - 1)
+
+/**
+ * @brief Compact histogram class.
+ *
+ */
+class CompactHistogram
+{
+public:
+    /**
+     * @brief Construct a new empty Compact Histogram object
+     *
+     */
+    explicit CompactHistogram();
+
+    /**
+     * @brief Destroy the Compact Histogram object
+     *
+     */
+    virtual ~CompactHistogram();
+
+    /**
+     * @brief Records a value.
+     *
+     * @param value Value in nanoseconds, clamped to HISTOGRAM_MAX_VALUE.
+     */
+    void record(uint64_t value);
+
+    /**
+     * @brief Adds the counts of another histogram to this one.
+     *
+     * @param other Histogram to be merged.
+     */
+    void merge(const CompactHistogram &other);
+
+    /**
+     * @brief Get the number of recorded values.
+     *
+     * @return uint64_t
+     */
+    uint64_t get_count() const;
+
+    /**
+     * @brief Get the smallest recorded value, zero when empty.
+     *
+     * @return uint64_t
+     */
+    uint64_t get_min() const;
+
+    /**
+     * @brief Get the largest recorded value, zero when empty.
+     *
+     * @return uint64_t
+     */
+    uint64_t get_max() const;
+
+    /**
+     * @brief Get the value at a percentile, reported as LatencyHistogram
+     * does.
+     *
+     * @param percentile Percentile, from 0 to 100.
+     * @return uint64_t
+     */
+    uint64_t get_percentile(double percentile) const;
+
+private:
+    /**
+     * @brief Adds to the count of a bucket, inserting it in order.
+     *
+     * @param bucket Bucket index.
+     * @param count Count added.
+     */
+    void add(size_t bucket, uint64_t count);
+
+    /**
+     * @brief Buckets that counted a value, by index: count in the high bits,
+     * index in the low COMPACT_HISTOGRAM_BUCKET_BITS.
+     */
+    std::vector<uint64_t> entries;
+    /**
+     * @brief Number of recorded values.
+     */
+    uint64_t count;
+    /**
+     * @brief Smallest recorded value.
+     */
+    uint64_t min;
+    /**
+     * @brief Largest recorded value.
+     */
+    uint64_t max;
+};
+
+#endif //__COMPACT_HISTOGRAM_HPP__
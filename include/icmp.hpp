@@ -24,7 +24,9 @@
 
 #include <vector>
 #include <cstdint>
-#include <memory>
+#include <cstddef>
+
+#include <payload_buffer.hpp>
 
 /**
  * @brief Summary of Message Types, according rfc792.
@@ -65,6 +67,116 @@ typedef enum message_code
     FRAGMENT_REASSEMBLY_TIME_EXCEEDED = 1,
 } message_code_t;
 
+/**
+ * @brief Size of the fixed ICMP header (type, code and checksum).
+ *
+ */
+#define ICMP_HEADER_LENGTH          (size_t)0x04
+
+/**
+ * @brief Size of the header of the timestamp messages, of every other
+ * message type and of the quoted original datagram of the error messages,
+ * in octets.
+ *
+ */
+#define ICMP_TIMESTAMP_LENGTH       (size_t)0x14
+#define ICMP_MESSAGE_LENGTH         (size_t)0x08
+#define ICMP_QUOTED_DATA_LENGTH     (size_t)0x08
+
+/**
+ * @brief Offsets of the ICMP fields, in octets.
+ *
+ */
+#define ICMP_TYPE_OFFSET            0U
+#define ICMP_CODE_OFFSET            1U
+#define ICMP_CHECKSUM_OFFSET        2U
+#define ICMP_IDENTIFIER_OFFSET      4U
+#define ICMP_SEQUENCE_OFFSET        6U
+#define ICMP_DATA_OFFSET            8U
+#define ICMP_POINTER_OFFSET         4U
+#define ICMP_GATEWAY_OFFSET         4U
+#define ICMP_NEXT_HOP_MTU_OFFSET    6U
+#define ICMP_ORIGINATE_OFFSET       8U
+#define ICMP_RECEIVE_OFFSET         12U
+#define ICMP_TRANSMIT_OFFSET        16U
+
+/**
+ * @brief Milliseconds in a day, the range of the standard timestamps, and
+ * the high order bit flagging a non-standard timestamp (rfc792).
+ *
+ */
+#define ICMP_DAY_MILLISECONDS       86400000U
+#define ICMP_TIMESTAMP_NONSTANDARD  (1U << 31)
+
+/**
+ * @brief Get the standard ICMP timestamp of a time: milliseconds since
+ * midnight UT.
+ *
+ * @param timestamp Time in nanoseconds since the epoch (CLOCK_REALTIME).
+ * @return constexpr uint32_t
+ */
+constexpr uint32_t icmp_timestamp(uint64_t timestamp)
+{
+    return (uint32_t)((timestamp / 1000000ULL) % ICMP_DAY_MILLISECONDS);
+}
+
+/**
+ * @brief Get the header length of a message type, the rest of the message
+ * being data. Zero for unknown types.
+ *
+ * @param type Message type.
+ * @return constexpr size_t
+ */
+constexpr size_t icmp_header_length(message_type_t type)
+{
+    return (type == TIMESTAMP || type == TIMESTAMP_REPLY) ? ICMP_TIMESTAMP_LENGTH :
+           (type == ECHO_REPLY || type == DESTINATION_UNREACHABLE || type == SOURCE_QUENCH ||
+            type == REDIRECT || type == ECHO || type == TIME_EXCEEDED ||
+            type == PARAMETER_PROBLEM || type == INFORMATION_REQUEST ||
+            type == INFORMATION_REPLY) ? ICMP_MESSAGE_LENGTH : 0;
+}
+
+/**
+ * @brief Checks whether a message type has identifier and sequence number
+ * fields.
+ *
+ * @param type Message type.
+ * @return constexpr bool
+ */
+constexpr bool icmp_has_sequence(message_type_t type)
+{
+    return type == ECHO || type == ECHO_REPLY || type == TIMESTAMP || type == TIMESTAMP_REPLY ||
+           type == INFORMATION_REQUEST || type == INFORMATION_REPLY;
+}
+
+/**
+ * @brief Checks whether a message type reports an error about a datagram,
+ * which is quoted as its data.
+ *
+ * @param type Message type.
+ * @return constexpr bool
+ */
+constexpr bool icmp_is_error(message_type_t type)
+{
+    return type == DESTINATION_UNREACHABLE || type == SOURCE_QUENCH || type == REDIRECT ||
+           type == TIME_EXCEEDED || type == PARAMETER_PROBLEM;
+}
+
+/**
+ * @brief Checks whether a code is valid for a message type.
+ *
+ * @param type Message type.
+ * @param code Message code.
+ * @return constexpr bool
+ */
+constexpr bool icmp_code_valid(message_type_t type, message_code_t code)
+{
+    return type == DESTINATION_UNREACHABLE ? code <= SOURCE_ROUTE_FAILED :
+           type == REDIRECT ? code <= REDIRECT_DATAGRAMS_FOR_TOS_AND_HOST :
+           type == TIME_EXCEEDED ? code <= FRAGMENT_REASSEMBLY_TIME_EXCEEDED :
+           icmp_header_length(type) != 0 && code == DEFAULT_CODE;
+}
+
 /**
  * @brief ICMP packet class.
  *
@@ -114,11 +226,35 @@ public:
     uint16_t get_sequence_number();
 
     /**
-     * @brief Set the data object
-     * 
-     * @return std::vector<uint16_t> 
+     * @brief Get the data carried after the type dependent header fields.
+     *
+     * @return byte_span_t View valid until the data or type changes.
      */
-    std::vector<uint16_t> get_data();
+    byte_span_t get_data() const;
+
+    /**
+     * @brief Get the originate timestamp object, the time the sender last
+     * touched the message before sending it.
+     *
+     * @return uint32_t Milliseconds since midnight UT.
+     */
+    uint32_t get_originate_timestamp();
+
+    /**
+     * @brief Get the receive timestamp object, the time the echoer first
+     * touched the message on receipt.
+     *
+     * @return uint32_t Milliseconds since midnight UT.
+     */
+    uint32_t get_receive_timestamp();
+
+    /**
+     * @brief Get the transmit timestamp object, the time the echoer last
+     * touched the message on sending it.
+     *
+     * @return uint32_t Milliseconds since midnight UT.
+     */
+    uint32_t get_transmit_timestamp();
 
     /**
      * @brief Set the type object
@@ -149,11 +285,43 @@ public:
     void set_sequence_number(uint16_t sequence_number);
 
     /**
-     * @brief Set the data object
-     * 
-     * @param data 
+     * @brief Set the originate, receive and transmit timestamps.
+     *
+     * @param originate Milliseconds since midnight UT.
+     * @param receive Milliseconds since midnight UT.
+     * @param transmit Milliseconds since midnight UT.
+     */
+    void set_timestamps(uint32_t originate, uint32_t receive, uint32_t transmit);
+
+    /**
+     * @brief Replace the data carried after the type dependent header fields.
+     *
+     * @param data Octets, any length, nullptr for none.
+     * @param length Number of octets.
+     */
+    void set_data(const uint8_t *data, size_t length);
+
+    /**
+     * @brief Replace the data carried after the type dependent header fields.
+     *
+     * @param data
+     */
+    void set_data(const std::vector<uint8_t> &data);
+
+    /**
+     * @brief Zero the type dependent header fields and drop the data, keeping
+     * type, code and the data storage, so the object can be reused for the
+     * next packet without allocating.
+     *
      */
-    void set_data(std::vector<uint16_t> data);
+    void reset();
+
+    /**
+     * @brief Get the length of the encoded packet.
+     *
+     * @return size_t
+     */
+    size_t get_length();
 
     /**
      * @brief This method transform ICMP packet fields in an array.
@@ -162,14 +330,42 @@ public:
      */
     std::vector<uint8_t> encode();
 
+    /**
+     * @brief This method writes the ICMP packet fields into a caller-owned
+     * buffer, without any heap allocation.
+     *
+     * @param buffer Destination buffer.
+     * @param capacity Size of the destination buffer in octets.
+     * @return Number of octets written.
+     */
+    size_t encode_into(uint8_t *buffer, size_t capacity);
+
 protected:
     /**
-     * @brief This method updates packet checksum.
+     * @brief This method updates packet checksum from the encoded packet.
      *
+     * @param encoded_data Encoded packet, with the checksum field zeroed.
+     * @param length Encoded packet length in octets.
      */
-    void update_checksum();
+    void update_checksum(const uint8_t *encoded_data, size_t length);
 
 private:
+    /**
+     * @brief Reads a big-endian 32 bit type dependent header field.
+     *
+     * @param offset Field offset in the message, in octets.
+     * @return uint32_t
+     */
+    uint32_t read_long(size_t offset);
+
+    /**
+     * @brief Writes a big-endian 32 bit type dependent header field.
+     *
+     * @param offset Field offset in the message, in octets.
+     * @param value
+     */
+    void write_long(size_t offset, uint32_t value);
+
     /**
      * @brief The type field indicates the type of the message. Its value
      * determines the format of the remaining data.
@@ -185,11 +381,16 @@ private:
      * message and parts of the IPv6 header.
      */
     uint16_t checksum;
+    /**
+     * @brief Type dependent header fields (identifier and sequence number,
+     * timestamps, gateway address...), in network byte order.
+     */
+    uint8_t fields[ICMP_TIMESTAMP_LENGTH - ICMP_HEADER_LENGTH];
     /**
      * @brief The data received in the echo message must be returned in the echo
-     * reply message.
+     * reply message. Held inline up to PAYLOAD_BUFFER_INLINE octets.
      */
-    std::shared_ptr<std::vector<uint16_t>> data;
+    PayloadBuffer data;
 };
 
 #endif //__ICMP_HPP__
\ No newline at end of file
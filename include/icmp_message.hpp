@@ -0,0 +1,347 @@
+/**
+ * @file icmp_message.hpp
+ * @author Mateus Lima Alves (mateuslima.ti@gmail.com)
+ * @brief Internet Control Message Protocol (ICMP) messages specialized at
+ * compile time by type and code. The header has the fixed size of its type,
+ * invalid codes and fields the type does not have are rejected by
+ * static_assert, so building a message does no runtime dispatch, never
+ * throws on the hot path and never allocates. The data (echo payload or
+ * quoted datagram) is a non-owning view of a caller buffer.
+ * @version 0.1
+ * @date 2022-03-30
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef __ICMP_MESSAGE_HPP__
+#define __ICMP_MESSAGE_HPP__
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+#include <icmp.hpp>
+#include <checksum.hpp>
+#include <exceptions.hpp>
+
+/**
+ * @brief ICMP message class template.
+ *
+ * @tparam TYPE Message type.
+ * @tparam CODE Message code, valid for the type.
+ */
+template <message_type_t TYPE, message_code_t CODE = DEFAULT_CODE>
+class IcmpMessage
+{
+    static_assert(icmp_header_length(TYPE) != 0, "ICMP - Unknown packet type.");
+    static_assert(icmp_code_valid(TYPE, CODE), "ICMP - This packet type don't have this code.");
+
+public:
+    /**
+     * @brief Header length of the message type, in octets.
+     */
+    static constexpr size_t HEADER_LENGTH = icmp_header_length(TYPE);
+
+    /**
+     * @brief Construct a new ICMP Message object, with every field zeroed
+     * and no data.
+     *
+     */
+    explicit IcmpMessage() :
+        header{}, payload{nullptr}, payload_length{0}
+    {
+        this->header[ICMP_TYPE_OFFSET] = (uint8_t)TYPE;
+        this->header[ICMP_CODE_OFFSET] = (uint8_t)CODE;
+    }
+
+    /**
+     * @brief Get the type object
+     *
+     * @return constexpr message_type_t
+     */
+    static constexpr message_type_t get_type()
+    {
+        return TYPE;
+    }
+
+    /**
+     * @brief Get the code object
+     *
+     * @return constexpr message_code_t
+     */
+    static constexpr message_code_t get_code()
+    {
+        return CODE;
+    }
+
+    /**
+     * @brief Get the identifier object
+     *
+     * @return uint16_t
+     */
+    uint16_t get_identifier() const
+    {
+        static_assert(icmp_has_sequence(TYPE), "ICMP - This packet type don't have this attribute.");
+        return this->read_word(ICMP_IDENTIFIER_OFFSET);
+    }
+
+    /**
+     * @brief Get the sequence number object
+     *
+     * @return uint16_t
+     */
+    uint16_t get_sequence_number() const
+    {
+        static_assert(icmp_has_sequence(TYPE), "ICMP - This packet type don't have this attribute.");
+        return this->read_word(ICMP_SEQUENCE_OFFSET);
+    }
+
+    /**
+     * @brief Set the identifier object
+     *
+     * @param identifier
+     */
+    void set_identifier(uint16_t identifier)
+    {
+        static_assert(icmp_has_sequence(TYPE), "ICMP - This packet type don't have this attribute.");
+        this->write_word(ICMP_IDENTIFIER_OFFSET, identifier);
+    }
+
+    /**
+     * @brief Set the sequence number object
+     *
+     * @param sequence_number
+     */
+    void set_sequence_number(uint16_t sequence_number)
+    {
+        static_assert(icmp_has_sequence(TYPE), "ICMP - This packet type don't have this attribute.");
+        this->write_word(ICMP_SEQUENCE_OFFSET, sequence_number);
+    }
+
+    /**
+     * @brief Set the pointer to the octet where a parameter problem was
+     * detected.
+     *
+     * @param pointer
+     */
+    void set_pointer(uint8_t pointer)
+    {
+        static_assert(TYPE == PARAMETER_PROBLEM, "ICMP - This packet type don't have this attribute.");
+        this->header[ICMP_POINTER_OFFSET] = pointer;
+    }
+
+    /**
+     * @brief Set the gateway internet address of a redirect.
+     *
+     * @param gateway_address Gateway address, in network byte order.
+     */
+    void set_gateway_address(uint32_t gateway_address)
+    {
+        static_assert(TYPE == REDIRECT, "ICMP - This packet type don't have this attribute.");
+        memcpy(&this->header[ICMP_GATEWAY_OFFSET], &gateway_address, sizeof(gateway_address));
+    }
+
+    /**
+     * @brief Set the MTU of the next hop, according rfc1191
+     * (https://datatracker.ietf.org/doc/html/rfc1191).
+     *
+     * @param mtu
+     */
+    void set_next_hop_mtu(uint16_t mtu)
+    {
+        static_assert(TYPE == DESTINATION_UNREACHABLE && CODE == FRAGMENTATION_NEEDED,
+                      "ICMP - This packet type don't have this attribute.");
+        this->write_word(ICMP_NEXT_HOP_MTU_OFFSET, mtu);
+    }
+
+    /**
+     * @brief Set the originate, receive and transmit timestamps, in
+     * milliseconds since midnight UT.
+     *
+     * @param originate
+     * @param receive
+     * @param transmit
+     */
+    void set_timestamps(uint32_t originate, uint32_t receive, uint32_t transmit)
+    {
+        static_assert(TYPE == TIMESTAMP || TYPE == TIMESTAMP_REPLY,
+                      "ICMP - This packet type don't have this attribute.");
+        this->write_long(ICMP_ORIGINATE_OFFSET, originate);
+        this->write_long(ICMP_RECEIVE_OFFSET, receive);
+        this->write_long(ICMP_TRANSMIT_OFFSET, transmit);
+    }
+
+    /**
+     * @brief Get the originate timestamp object
+     *
+     * @return uint32_t Milliseconds since midnight UT.
+     */
+    uint32_t get_originate_timestamp() const
+    {
+        static_assert(TYPE == TIMESTAMP || TYPE == TIMESTAMP_REPLY,
+                      "ICMP - This packet type don't have this attribute.");
+        return this->read_long(ICMP_ORIGINATE_OFFSET);
+    }
+
+    /**
+     * @brief Get the receive timestamp object
+     *
+     * @return uint32_t Milliseconds since midnight UT.
+     */
+    uint32_t get_receive_timestamp() const
+    {
+        static_assert(TYPE == TIMESTAMP || TYPE == TIMESTAMP_REPLY,
+                      "ICMP - This packet type don't have this attribute.");
+        return this->read_long(ICMP_RECEIVE_OFFSET);
+    }
+
+    /**
+     * @brief Get the transmit timestamp object
+     *
+     * @return uint32_t Milliseconds since midnight UT.
+     */
+    uint32_t get_transmit_timestamp() const
+    {
+        static_assert(TYPE == TIMESTAMP || TYPE == TIMESTAMP_REPLY,
+                      "ICMP - This packet type don't have this attribute.");
+        return this->read_long(ICMP_TRANSMIT_OFFSET);
+    }
+
+    /**
+     * @brief Set the data carried after the header: the echo payload, or the
+     * quoted internet header plus the first 64 bits of the original datagram
+     * data. The buffer is not copied and must outlive the encoding.
+     *
+     * @param payload Data, nullptr for none.
+     * @param length Data length in octets.
+     */
+    void set_payload(const uint8_t *payload, size_t length)
+    {
+        this->payload = payload;
+        this->payload_length = payload ? length : 0;
+    }
+
+    /**
+     * @brief Get the data carried after the header.
+     *
+     * @return const uint8_t*
+     */
+    const uint8_t *get_payload() const
+    {
+        return this->payload;
+    }
+
+    /**
+     * @brief Get the data length in octets.
+     *
+     * @return size_t
+     */
+    size_t get_payload_length() const
+    {
+        return this->payload_length;
+    }
+
+    /**
+     * @brief Get the length of the encoded message.
+     *
+     * @return size_t
+     */
+    size_t get_length() const
+    {
+        return HEADER_LENGTH + this->payload_length;
+    }
+
+    /**
+     * @brief Writes the message into a caller-owned buffer, with its
+     * checksum.
+     *
+     * @param buffer Destination buffer.
+     * @param capacity Size of the destination buffer in octets.
+     * @return size_t Number of octets written.
+     */
+    size_t encode_into(uint8_t *buffer, size_t capacity)
+    {
+        uint16_t checksum;
+
+        if (capacity < this->get_length())
+        {
+            throw Exception(EXCEPTION_MSG("ICMP - Buffer too small to encode packet."));
+        }
+
+        this->write_word(ICMP_CHECKSUM_OFFSET, 0);
+        /* The header has an even length, so the payload sum chains after it. */
+        checksum = checksum_fold(checksum_partial(this->payload, this->payload_length,
+                                                  checksum_partial(this->header, HEADER_LENGTH)));
+        this->write_word(ICMP_CHECKSUM_OFFSET, checksum);
+
+        memcpy(buffer, this->header, HEADER_LENGTH);
+        if (this->payload_length)
+        {
+            memcpy(buffer + HEADER_LENGTH, this->payload, this->payload_length);
+        }
+        return this->get_length();
+    }
+
+private:
+    /**
+     * @brief Reads a big-endian 16 bit word of the header.
+     *
+     * @param offset
+     * @return uint16_t
+     */
+    uint16_t read_word(size_t offset) const
+    {
+        return (uint16_t)((this->header[offset] << 8) | this->header[offset + 1]);
+    }
+
+    /**
+     * @brief Reads a big-endian 32 bit word of the header.
+     *
+     * @param offset
+     * @return uint32_t
+     */
+    uint32_t read_long(size_t offset) const
+    {
+        return ((uint32_t)this->read_word(offset) << 16) | this->read_word(offset + 2);
+    }
+
+    /**
+     * @brief Writes a big-endian 16 bit word of the header.
+     *
+     * @param offset
+     * @param value
+     */
+    void write_word(size_t offset, uint16_t value)
+    {
+        this->header[offset] = (uint8_t)(value >> 8);
+        this->header[offset + 1] = (uint8_t)value;
+    }
+
+    /**
+     * @brief Writes a big-endian 32 bit word of the header.
+     *
+     * @param offset
+     * @param value
+     */
+    void write_long(size_t offset, uint32_t value)
+    {
+        this->write_word(offset, (uint16_t)(value >> 16));
+        this->write_word(offset + 2, (uint16_t)value);
+    }
+
+    /**
+     * @brief Encoded header, the checksum is written on encode.
+     */
+    uint8_t header[HEADER_LENGTH];
+    /**
+     * @brief Data carried after the header.
+     */
+    const uint8_t *payload;
+    /**
+     * @brief Data length in octets.
+     */
+    size_t payload_length;
+};
+
+#endif //__ICMP_MESSAGE_HPP__
@@ -0,0 +1,182 @@
+/**
+ * @file icmp_view.hpp
+ * @author Mateus Lima Alves (mateuslima.ti@gmail.com)
+ * @brief Zero-copy decoder of received ICMP messages. The view only points
+ * into the receive buffer, so it is valid while that buffer is.
+ * @version 0.1
+ * @date 2022-03-22
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef __ICMP_VIEW_HPP__
+#define __ICMP_VIEW_HPP__
+
+#include <cstdint>
+#include <cstddef>
+
+#include <icmp.hpp>
+#include <ipv4_view.hpp>
+
+/**
+ * @brief ICMP message view class.
+ *
+ */
+class IcmpView
+{
+public:
+    /**
+     * @brief Construct a new empty Icmp View object
+     *
+     */
+    explicit IcmpView();
+
+    /**
+     * @brief Destroy the Icmp View object
+     *
+     */
+    virtual ~IcmpView();
+
+    /**
+     * @brief Points the view to a message and validates it.
+     *
+     * @param buffer Encoded message.
+     * @param length Message length in octets.
+     * @param quoted The message is quoted inside an ICMP error message, so
+     * it may be truncated and its checksum is not verified.
+     * @return true when the message is a valid ICMP message.
+     */
+    bool parse(const uint8_t *buffer, size_t length, bool quoted = false);
+
+    /**
+     * @brief Get the type object
+     *
+     * @return message_type_t
+     */
+    message_type_t get_type() const;
+
+    /**
+     * @brief Get the code object
+     *
+     * @return message_code_t
+     */
+    message_code_t get_code() const;
+
+    /**
+     * @brief Get the checksum object
+     *
+     * @return uint16_t
+     */
+    uint16_t get_checksum() const;
+
+    /**
+     * @brief Get the identifier object, meaningful for echo, timestamp and
+     * information messages.
+     *
+     * @return uint16_t
+     */
+    uint16_t get_identifier() const;
+
+    /**
+     * @brief Get the sequence number object, meaningful for echo, timestamp
+     * and information messages.
+     *
+     * @return uint16_t
+     */
+    uint16_t get_sequence_number() const;
+
+    /**
+     * @brief Get the next-hop MTU object, meaningful for destination
+     * unreachable messages with the fragmentation needed code (rfc1191).
+     * Zero when the router does not report it.
+     *
+     * @return uint16_t
+     */
+    uint16_t get_next_hop_mtu() const;
+
+    /**
+     * @brief Get the originate timestamp object, meaningful for timestamp
+     * messages.
+     *
+     * @return uint32_t Milliseconds since midnight UT, zero when the message
+     * is too short (a quoted header).
+     */
+    uint32_t get_originate_timestamp() const;
+
+    /**
+     * @brief Get the receive timestamp object, meaningful for timestamp
+     * messages.
+     *
+     * @return uint32_t Milliseconds since midnight UT, zero when the message
+     * is too short (a quoted header).
+     */
+    uint32_t get_receive_timestamp() const;
+
+    /**
+     * @brief Get the transmit timestamp object, meaningful for timestamp
+     * messages.
+     *
+     * @return uint32_t Milliseconds since midnight UT, zero when the message
+     * is too short (a quoted header).
+     */
+    uint32_t get_transmit_timestamp() const;
+
+    /**
+     * @brief Get the message data, after the 8 octets message header.
+     *
+     * @return const uint8_t*
+     */
+    const uint8_t *get_data() const;
+
+    /**
+     * @brief Get the message data length in octets.
+     *
+     * @return size_t
+     */
+    size_t get_data_length() const;
+
+    /**
+     * @brief Checks whether the message is an error message, which quotes
+     * the internet header and first octets of the datagram that caused it.
+     *
+     * @return true for error messages.
+     */
+    bool is_error() const;
+
+    /**
+     * @brief Points a view to the datagram quoted by an error message.
+     *
+     * @param datagram View of the quoted datagram.
+     * @return true when this is an error message quoting a valid datagram.
+     */
+    bool get_quoted_datagram(Ipv4View *datagram) const;
+
+private:
+    /**
+     * @brief Reads a big-endian 16 bit word.
+     *
+     * @param offset Word offset in octets.
+     * @return uint16_t
+     */
+    uint16_t read_word(size_t offset) const;
+
+    /**
+     * @brief Reads a big-endian 32 bit word.
+     *
+     * @param offset Word offset in octets.
+     * @return uint32_t Zero when the word is past the end of the message.
+     */
+    uint32_t read_long(size_t offset) const;
+
+    /**
+     * @brief Encoded message.
+     */
+    const uint8_t *buffer;
+    /**
+     * @brief Message length in octets.
+     */
+    size_t length;
+};
+
+#endif //__ICMP_VIEW_HPP__
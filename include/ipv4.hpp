@@ -32,8 +32,11 @@
 
 #include <vector>
 #include <cstdint>
+#include <cstddef>
 #include <memory>
 
+#include <icmp.hpp>
+
 /**
  * @brief This document describes version 4.
  * 
@@ -72,6 +75,20 @@
 
 #define IP_MIN_IHL                  (uint8_t)(IP_MIN_LENGTH / sizeof(uint32_t))
 
+#define IP_MAX_LENGTH               (uint16_t)0xFFFF
+
+/**
+ * @brief Offsets of the internet header fields, in octets.
+ *
+ */
+#define IP_TOTAL_LENGTH_OFFSET      2U
+#define IP_IDENTIFICATION_OFFSET    4U
+#define IP_TTL_OFFSET               8U
+#define IP_PROTOCOL_OFFSET          9U
+#define IP_CHECKSUM_OFFSET          10U
+#define IP_SOURCE_OFFSET            12U
+#define IP_DESTINATION_OFFSET       16U
+
 /**
  * @brief Various Control Flags.
  * 
@@ -115,6 +132,13 @@ public:
      */
     uint8_t get_protocol_number();
 
+    /**
+     * @brief Get the ttl object
+     *
+     * @return uint8_t
+     */
+    uint8_t get_ttl();
+
     /**
      * @brief Get the source address object
      * 
@@ -136,6 +160,13 @@ public:
      */
     void set_protocol_number(uint8_t protocol_number);
 
+    /**
+     * @brief Set the ttl object
+     *
+     * @param ttl Time to live, at least one.
+     */
+    void set_ttl(uint8_t ttl);
+
     /**
      * @brief Set the source address object
      * 
@@ -157,6 +188,13 @@ public:
      */
     void set_data(std::vector<uint8_t> data);
 
+    /**
+     * @brief Get the internet header length in octets, options included.
+     *
+     * @return size_t
+     */
+    size_t get_header_length();
+
     /**
      * @brief This method transform IPv4 packet fields in an array.
      *
@@ -164,12 +202,53 @@ public:
      */
     std::vector<uint8_t> encode();
 
+    /**
+     * @brief This method writes the IPv4 datagram, with the data previously
+     * set, into a caller-owned buffer.
+     *
+     * @param buffer Destination buffer.
+     * @param capacity Size of the destination buffer in octets.
+     * @return Number of octets written.
+     */
+    size_t encode_into(uint8_t *buffer, size_t capacity);
+
+    /**
+     * @brief This method writes the IPv4 datagram carrying the given ICMP
+     * packet into a caller-owned buffer in a single pass, without copying
+     * the ICMP packet into this object first.
+     *
+     * @param buffer Destination buffer.
+     * @param capacity Size of the destination buffer in octets.
+     * @param icmp ICMP packet to be carried as data.
+     * @return Number of octets written.
+     */
+    size_t encode_into(uint8_t *buffer, size_t capacity, Icmp &icmp);
+
+    /**
+     * @brief This method writes only the internet header of a datagram
+     * carrying data_length octets, which the caller writes right after it.
+     *
+     * @param buffer Destination buffer.
+     * @param capacity Size of the destination buffer in octets.
+     * @param data_length Length of the data carried, in octets.
+     * @return Header length in octets.
+     */
+    size_t encode_header_into(uint8_t *buffer, size_t capacity, size_t data_length);
+
 protected:
     /**
-     * @brief This method updates packet checksum.
+     * @brief This method updates packet checksum from the encoded header.
      *
+     * @param encoded_header Encoded header, with the checksum field zeroed.
      */
-    void update_checksum();
+    void update_checksum(const uint8_t *encoded_header);
+
+    /**
+     * @brief This method writes the internet header (options included).
+     *
+     * @param buffer Destination buffer, at least get_header_length() long.
+     */
+    void encode_header(uint8_t *buffer);
 
 private:
     /**
@@ -247,12 +326,12 @@ private:
      * @brief The options may appear or not in datagrams.  They must be
      * implemented by all IP modules (host and gateways).  What is optional
      * is their transmission in any particular datagram, not their
-     * implementation.
+     * implementation. Null until options are set.
      */
     std::shared_ptr<std::vector<uint16_t>> options;
     /**
-     * @brief 
-     * 
+     * @brief Data set with set_data, null until then.
+     *
      */
     std::shared_ptr<std::vector<uint8_t>> data;
 };
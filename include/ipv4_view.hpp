@@ -0,0 +1,166 @@
+/**
+ * @file ipv4_view.hpp
+ * @author Mateus Lima Alves (mateuslima.ti@gmail.com)
+ * @brief Zero-copy decoder of received IPv4 datagrams. The view only points
+ * into the receive buffer, so it is valid while that buffer is.
+ * @version 0.1
+ * @date 2022-03-22
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef __IPV4_VIEW_HPP__
+#define __IPV4_VIEW_HPP__
+
+#include <cstdint>
+#include <cstddef>
+
+#include <ipv4.hpp>
+
+/**
+ * @brief IPv4 datagram view class.
+ *
+ */
+class Ipv4View
+{
+public:
+    /**
+     * @brief Construct a new empty Ipv4 View object
+     *
+     */
+    explicit Ipv4View();
+
+    /**
+     * @brief Destroy the Ipv4 View object
+     *
+     */
+    virtual ~Ipv4View();
+
+    /**
+     * @brief Points the view to a datagram and validates it.
+     *
+     * @param buffer Encoded datagram.
+     * @param length Buffer length in octets.
+     * @param quoted The datagram is quoted inside an ICMP error message, so
+     * it may be truncated and its checksum is not verified.
+     * @return true when the datagram is a valid IPv4 datagram.
+     */
+    bool parse(const uint8_t *buffer, size_t length, bool quoted = false);
+
+    /**
+     * @brief Get the internet header length in octets, options included.
+     *
+     * @return size_t
+     */
+    size_t get_header_length() const;
+
+    /**
+     * @brief Get the type of service object
+     *
+     * @return uint8_t
+     */
+    uint8_t get_type_of_service() const;
+
+    /**
+     * @brief Get the total length object
+     *
+     * @return uint16_t
+     */
+    uint16_t get_total_length() const;
+
+    /**
+     * @brief Get the identification object
+     *
+     * @return uint16_t
+     */
+    uint16_t get_identification() const;
+
+    /**
+     * @brief Get the flags object
+     *
+     * @return uint8_t
+     */
+    uint8_t get_flags() const;
+
+    /**
+     * @brief Get the fragment offset object
+     *
+     * @return uint16_t
+     */
+    uint16_t get_fragment_offset() const;
+
+    /**
+     * @brief Get the ttl object
+     *
+     * @return uint8_t
+     */
+    uint8_t get_ttl() const;
+
+    /**
+     * @brief Get the protocol number object
+     *
+     * @return uint8_t
+     */
+    uint8_t get_protocol_number() const;
+
+    /**
+     * @brief Get the checksum object
+     *
+     * @return uint16_t
+     */
+    uint16_t get_checksum() const;
+
+    /**
+     * @brief Get the source address object
+     *
+     * @return uint32_t Source address, in network byte order.
+     */
+    uint32_t get_source_address() const;
+
+    /**
+     * @brief Get the destination address object
+     *
+     * @return uint32_t Destination address, in network byte order.
+     */
+    uint32_t get_destination_address() const;
+
+    /**
+     * @brief Get the datagram data, after the internet header.
+     *
+     * @return const uint8_t*
+     */
+    const uint8_t *get_data() const;
+
+    /**
+     * @brief Get the datagram data length in octets. For quoted datagrams it
+     * is the length actually quoted, not the original one.
+     *
+     * @return size_t
+     */
+    size_t get_data_length() const;
+
+private:
+    /**
+     * @brief Reads a big-endian 16 bit word.
+     *
+     * @param offset Word offset in octets.
+     * @return uint16_t
+     */
+    uint16_t read_word(size_t offset) const;
+
+    /**
+     * @brief Encoded datagram.
+     */
+    const uint8_t *buffer;
+    /**
+     * @brief Internet header length in octets.
+     */
+    size_t header_length;
+    /**
+     * @brief Data length in octets.
+     */
+    size_t data_length;
+};
+
+#endif //__IPV4_VIEW_HPP__
@@ -0,0 +1,178 @@
+/**
+ * @file latency_histogram.hpp
+ * @author Mateus Lima Alves (mateuslima.ti@gmail.com)
+ * @brief Fixed-memory latency histogram in the style of HdrHistogram. Values
+ * are counted in log-linear buckets (16 buckets per power of two, so at
+ * most 6.25% relative error) from 1 ns up to 2^36 ns (about 68 s).
+ * Recording is O(1), never allocates and only uses relaxed atomic
+ * increments, so one thread may record while others take snapshots or
+ * merge, without locks.
+ * @version 0.1
+ * @date 2022-03-26
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef __LATENCY_HISTOGRAM_HPP__
+#define __LATENCY_HISTOGRAM_HPP__
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+#define HISTOGRAM_SUB_BUCKET_BITS   5U
+#define HISTOGRAM_SUB_BUCKETS       (1U << HISTOGRAM_SUB_BUCKET_BITS)
+#define HISTOGRAM_MAX_VALUE_BITS    36U
+#define HISTOGRAM_MAX_VALUE         ((1ULL << HISTOGRAM_MAX_VALUE_BITS) - 1)
+#define HISTOGRAM_BUCKETS           ((HISTOGRAM_MAX_VALUE_BITS - HISTOGRAM_SUB_BUCKET_BITS + 2) * \
+                                     (HISTOGRAM_SUB_BUCKETS / 2))
+
+/**
+ * @brief Latency histogram class.
+ *
+ */
+class LatencyHistogram
+{
+public:
+    /**
+     * @brief Construct a new empty Latency Histogram object
+     *
+     */
+    explicit LatencyHistogram();
+
+    /**
+     * @brief Destroy the Latency Histogram object
+     *
+     */
+    virtual ~LatencyHistogram();
+
+    LatencyHistogram(const LatencyHistogram &) = delete;
+    LatencyHistogram &operator=(const LatencyHistogram &) = delete;
+
+    /**
+     * @brief Records a value.
+     *
+     * @param value Value in nanoseconds, clamped to HISTOGRAM_MAX_VALUE.
+     */
+    void record(uint64_t value);
+
+    /**
+     * @brief Adds the counts of another histogram to this one.
+     *
+     * @param other Histogram to be merged, it may be recording meanwhile.
+     */
+    void merge(const LatencyHistogram &other);
+
+    /**
+     * @brief Copies this histogram, which may be recording meanwhile.
+     *
+     * @param snapshot Histogram overwritten with the copy.
+     */
+    void snapshot(LatencyHistogram *snapshot) const;
+
+    /**
+     * @brief Forgets every recorded value.
+     *
+     */
+    void reset();
+
+    /**
+     * @brief Get the number of recorded values.
+     *
+     * @return uint64_t
+     */
+    uint64_t get_count() const;
+
+    /**
+     * @brief Get the smallest recorded value, zero when empty.
+     *
+     * @return uint64_t
+     */
+    uint64_t get_min() const;
+
+    /**
+     * @brief Get the largest recorded value, zero when empty.
+     *
+     * @return uint64_t
+     */
+    uint64_t get_max() const;
+
+    /**
+     * @brief Get the mean of the recorded values, zero when empty.
+     *
+     * @return double
+     */
+    double get_mean() const;
+
+    /**
+     * @brief Get the value at a percentile, reported as the highest value
+     * equivalent to the bucket holding it.
+     *
+     * @param percentile Percentile, from 0 to 100.
+     * @return uint64_t
+     */
+    uint64_t get_percentile(double percentile) const;
+
+    /**
+     * @brief Get the number of buckets.
+     *
+     * @return size_t
+     */
+    static size_t get_bucket_count();
+
+    /**
+     * @brief Get the count of a bucket.
+     *
+     * @param bucket Bucket index.
+     * @return uint64_t
+     */
+    uint64_t get_bucket(size_t bucket) const;
+
+    /**
+     * @brief Get the bucket counting a value.
+     *
+     * @param value Value in nanoseconds, at most HISTOGRAM_MAX_VALUE.
+     * @return size_t
+     */
+    static size_t get_bucket_index(uint64_t value);
+
+    /**
+     * @brief Get the highest value counted by a bucket.
+     *
+     * @param bucket Bucket index.
+     * @return uint64_t
+     */
+    static uint64_t get_bucket_value(size_t bucket);
+
+    /**
+     * @brief Get the sum of the recorded values.
+     *
+     * @return uint64_t
+     */
+    uint64_t get_sum() const;
+
+private:
+    /**
+     * @brief Count of every bucket.
+     */
+    std::atomic<uint64_t> counts[HISTOGRAM_BUCKETS];
+    /**
+     * @brief Number of recorded values.
+     */
+    std::atomic<uint64_t> count;
+    /**
+     * @brief Sum of the recorded values.
+     */
+    std::atomic<uint64_t> sum;
+    /**
+     * @brief Smallest recorded value.
+     */
+    std::atomic<uint64_t> min;
+    /**
+     * @brief Largest recorded value.
+     */
+    std::atomic<uint64_t> max;
+};
+
+#endif //__LATENCY_HISTOGRAM_HPP__
@@ -0,0 +1,210 @@
+/**
+ * @file metrics.hpp
+ * @author Mateus Lima Alves (mateuslima.ti@gmail.com)
+ * @brief Process-wide metrics. Counters and latency histograms live in
+ * per-thread blocks padded to a cache line: only the owning thread writes
+ * them, and a scrape sums and merges every block, so neither the threads nor
+ * reading contend with the send and receive loops.
+ * @version 0.1
+ * @date 2022-03-27
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef __METRICS_HPP__
+#define __METRICS_HPP__
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include <latency_histogram.hpp>
+
+#define METRICS_CACHE_LINE  64
+#define METRICS_PREFIX      "icmp_client_"
+
+/**
+ * @brief Counters of a thread, written only by that thread.
+ *
+ */
+typedef struct alignas(METRICS_CACHE_LINE) metrics_counters
+{
+    /** Packets encoded. */
+    std::atomic<uint64_t> encoded;
+    /** Packets sent. */
+    std::atomic<uint64_t> sent;
+    /** Packets that could not be sent. */
+    std::atomic<uint64_t> send_errors;
+    /** Datagrams received. */
+    std::atomic<uint64_t> received;
+    /** Replies matched to a probe. */
+    std::atomic<uint64_t> replies;
+    /** Probes that got no reply in time. */
+    std::atomic<uint64_t> timeouts;
+    /** Datagrams dropped by the kernel, socket buffer full. */
+    std::atomic<uint64_t> drops;
+} metrics_counters_t;
+
+/**
+ * @brief Latency histograms of a thread, written only by that thread.
+ *
+ */
+typedef struct alignas(METRICS_CACHE_LINE) metrics_histograms
+{
+    /** Time spent encoding a batch, in nanoseconds. */
+    LatencyHistogram encode_latency;
+    /** Time spent sending a batch, in nanoseconds. */
+    LatencyHistogram send_latency;
+    /** Round trip times, in nanoseconds. */
+    LatencyHistogram rtt;
+} metrics_histograms_t;
+
+/**
+ * @brief Metrics registry class, a process-wide singleton.
+ *
+ */
+class Metrics
+{
+public:
+    /**
+     * @brief Get the registry.
+     *
+     * @return Metrics&
+     */
+    static Metrics &get_instance();
+
+    /**
+     * @brief Get the counters of the calling thread, registered on first use.
+     *
+     * @return metrics_counters_t&
+     */
+    static metrics_counters_t &get_counters();
+
+    /**
+     * @brief Adds to a counter of the calling thread. Not a read-modify-write
+     * instruction, the thread is the only writer.
+     *
+     * @param counter Counter of the calling thread.
+     * @param value Value to be added.
+     */
+    static void add(std::atomic<uint64_t> &counter, uint64_t value = 1)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Set the number of probes waiting for a reply.
+     *
+     * @param in_flight
+     */
+    void set_in_flight(size_t in_flight);
+
+    /**
+     * @brief Get the time spent encoding a batch by the calling thread, in
+     * nanoseconds.
+     *
+     * @return LatencyHistogram&
+     */
+    static LatencyHistogram &get_encode_latency();
+
+    /**
+     * @brief Get the time spent sending a batch by the calling thread, in
+     * nanoseconds.
+     *
+     * @return LatencyHistogram&
+     */
+    static LatencyHistogram &get_send_latency();
+
+    /**
+     * @brief Get the round trip times measured by the calling thread, in
+     * nanoseconds.
+     *
+     * @return LatencyHistogram&
+     */
+    static LatencyHistogram &get_rtt();
+
+    /**
+     * @brief Get every metric in the Prometheus text exposition format.
+     *
+     * @return std::string
+     */
+    std::string get_text();
+
+private:
+    /**
+     * @brief Construct a new Metrics object
+     *
+     */
+    explicit Metrics();
+
+    /**
+     * @brief Metrics of a thread.
+     *
+     */
+    typedef struct metrics_thread
+    {
+        /** Counters of the thread. */
+        metrics_counters_t counters;
+        /** Histograms of the thread. */
+        metrics_histograms_t histograms;
+    } metrics_thread_t;
+
+    /**
+     * @brief Get the metrics of the calling thread, registered on first use.
+     *
+     * @return metrics_thread_t&
+     */
+    static metrics_thread_t &get_thread();
+
+    /**
+     * @brief Allocates the metrics of a new thread.
+     *
+     * @return metrics_thread_t*
+     */
+    metrics_thread_t *add_thread();
+
+    /**
+     * @brief Appends a counter summed over every thread. The caller holds
+     * the mutex.
+     *
+     * @param text Exposition text.
+     * @param name Metric name, without prefix.
+     * @param help Metric description.
+     * @param counter Counter member.
+     */
+    void append_counter(std::string &text, const char *name, const char *help,
+                        std::atomic<uint64_t> metrics_counters_t::*counter);
+
+    /**
+     * @brief Appends a histogram merged over every thread, in seconds, with
+     * one bucket per power of two. The caller holds the mutex.
+     *
+     * @param text Exposition text.
+     * @param name Metric name, without prefix.
+     * @param help Metric description.
+     * @param histogram Histogram member, in nanoseconds.
+     */
+    void append_histogram(std::string &text, const char *name, const char *help,
+                          LatencyHistogram metrics_histograms_t::*histogram);
+
+    /**
+     * @brief Guards the thread list, taken on thread registration and once
+     * per scrape.
+     */
+    std::mutex mutex;
+    /**
+     * @brief Metrics of every thread that ever counted.
+     */
+    std::vector<std::unique_ptr<metrics_thread_t>> threads;
+    /**
+     * @brief Probes waiting for a reply.
+     */
+    std::atomic<uint64_t> in_flight;
+};
+
+#endif //__METRICS_HPP__
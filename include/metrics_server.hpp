@@ -0,0 +1,75 @@
+/**
+ * @file metrics_server.hpp
+ * @author Mateus Lima Alves (mateuslima.ti@gmail.com)
+ * @brief Minimal HTTP listener serving the metrics in the Prometheus text
+ * format, from a background thread.
+ * @version 0.1
+ * @date 2022-03-27
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef __METRICS_SERVER_HPP__
+#define __METRICS_SERVER_HPP__
+
+#include <thread>
+
+#define METRICS_SERVER_BACKLOG          16
+#define METRICS_SERVER_REQUEST_LENGTH   4096    // Largest request read, in octets.
+#define METRICS_SERVER_REQUEST_TIMEOUT  1000    // In milliseconds.
+
+/**
+ * @brief Metrics HTTP server class.
+ *
+ */
+class MetricsServer
+{
+public:
+    /**
+     * @brief Construct a new Metrics Server object, listening on every
+     * address of the port.
+     *
+     * @param port Service name or port number, like SERVICE_PORT.
+     */
+    explicit MetricsServer(const char *port);
+
+    /**
+     * @brief Destroy the Metrics Server object, stopping its thread.
+     *
+     */
+    virtual ~MetricsServer();
+
+    MetricsServer(const MetricsServer &) = delete;
+    MetricsServer &operator=(const MetricsServer &) = delete;
+
+private:
+    /**
+     * @brief Accepts and answers connections until stopped.
+     *
+     */
+    void run();
+
+    /**
+     * @brief Answers one connection: GET /metrics gets the metrics, any
+     * other request gets 404.
+     *
+     * @param fd Connection file descriptor.
+     */
+    void serve(int fd);
+
+    /**
+     * @brief Listening socket.
+     */
+    int l_file_descriptor;
+    /**
+     * @brief Event file descriptor that wakes the thread up to stop.
+     */
+    int w_file_descriptor;
+    /**
+     * @brief Server thread.
+     */
+    std::thread thread;
+};
+
+#endif //__METRICS_SERVER_HPP__
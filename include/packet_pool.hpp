@@ -0,0 +1,123 @@
+/**
+ * @file packet_pool.hpp
+ * @author Mateus Lima Alves (mateuslima.ti@gmail.com)
+ * @brief Pool of fixed-size frame buffers carved from one memory mapping,
+ * optionally backed by huge pages. Frames are handed out and recycled
+ * through a preallocated free list, so neither acquire nor release ever
+ * touches the heap. A pool is not thread-safe, every thread owns its pools.
+ * @version 0.1
+ * @date 2022-03-31
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef __PACKET_POOL_HPP__
+#define __PACKET_POOL_HPP__
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#define PACKET_POOL_ALIGNMENT   64U             // Frames start on a cache line.
+#define PACKET_POOL_HUGE_PAGE   (2UL << 20)     // Huge page size, in octets.
+
+/**
+ * @brief Packet pool class.
+ *
+ */
+class PacketPool
+{
+public:
+    /**
+     * @brief Construct a new Packet Pool object, mapping and prefaulting
+     * every frame.
+     *
+     * @param frame_size Frame size in octets, rounded up to
+     * PACKET_POOL_ALIGNMENT.
+     * @param frame_count Number of frames.
+     * @param huge_pages Back the frames with huge pages when the system has
+     * them reserved, transparent huge pages are requested otherwise.
+     */
+    explicit PacketPool(size_t frame_size, size_t frame_count, bool huge_pages = false);
+
+    /**
+     * @brief Destroy the Packet Pool object, unmapping every frame.
+     *
+     */
+    virtual ~PacketPool();
+
+    PacketPool(const PacketPool &) = delete;
+    PacketPool &operator=(const PacketPool &) = delete;
+
+    /**
+     * @brief Takes a frame out of the pool.
+     *
+     * @return uint8_t* Frame, or nullptr when every frame is in use.
+     */
+    uint8_t *acquire();
+
+    /**
+     * @brief Gives a frame back to the pool, once its send or receive is
+     * complete.
+     *
+     * @param frame Frame acquired from this pool.
+     */
+    void release(uint8_t *frame);
+
+    /**
+     * @brief Get the frame size in octets.
+     *
+     * @return size_t
+     */
+    size_t get_frame_size();
+
+    /**
+     * @brief Get the number of frames.
+     *
+     * @return size_t
+     */
+    size_t get_frame_count();
+
+    /**
+     * @brief Get the number of frames not in use.
+     *
+     * @return size_t
+     */
+    size_t get_available();
+
+    /**
+     * @brief Checks whether the frames are backed by huge pages.
+     *
+     * @return bool
+     */
+    bool is_huge();
+
+private:
+    /**
+     * @brief Mapping holding every frame.
+     */
+    uint8_t *memory;
+    /**
+     * @brief Mapping length in octets.
+     */
+    size_t length;
+    /**
+     * @brief Frame size in octets.
+     */
+    size_t frame_size;
+    /**
+     * @brief Number of frames.
+     */
+    size_t frame_count;
+    /**
+     * @brief Whether the mapping uses huge pages.
+     */
+    bool huge;
+    /**
+     * @brief Indexes of the frames not in use, the last released on top.
+     */
+    std::vector<uint32_t> free_frames;
+};
+
+#endif //__PACKET_POOL_HPP__
@@ -0,0 +1,133 @@
+/**
+ * @file payload_buffer.hpp
+ * @author Mateus Lima Alves (mateuslima.ti@gmail.com)
+ * @brief Byte buffer class headers, holding small payloads inline and
+ * larger ones on the heap.
+ * @version 0.1
+ * @date 2022-04-01
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef __PAYLOAD_BUFFER_HPP__
+#define __PAYLOAD_BUFFER_HPP__
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+
+/**
+ * @brief Octets held inside the object before the heap is used. Covers the
+ * default 56 octets echo payload.
+ *
+ */
+#define PAYLOAD_BUFFER_INLINE   64U
+
+/**
+ * @brief Non-owning view of a run of octets, valid until its owner changes.
+ *
+ */
+typedef struct byte_span
+{
+    const uint8_t *data;
+    size_t length;
+} byte_span_t;
+
+/**
+ * @brief Payload buffer class.
+ *
+ */
+class PayloadBuffer
+{
+public:
+    /**
+     * @brief Construct a new empty Payload Buffer object.
+     *
+     */
+    explicit PayloadBuffer();
+
+    /**
+     * @brief Construct a new Payload Buffer object with a copy of other.
+     *
+     * @param other
+     */
+    PayloadBuffer(const PayloadBuffer &other);
+
+    /**
+     * @brief Copy other into this buffer.
+     *
+     * @param other
+     * @return PayloadBuffer&
+     */
+    PayloadBuffer &operator=(const PayloadBuffer &other);
+
+    /**
+     * @brief Destroy the Payload Buffer object
+     *
+     */
+    virtual ~PayloadBuffer();
+
+    /**
+     * @brief Replace the content with a copy of data. Only allocates when the
+     * length exceeds the current capacity.
+     *
+     * @param data Octets, nullptr for none.
+     * @param length Number of octets.
+     */
+    void assign(const uint8_t *data, size_t length);
+
+    /**
+     * @brief Drop the content, keeping the capacity.
+     *
+     */
+    void clear();
+
+    /**
+     * @brief Get a view of the content.
+     *
+     * @return byte_span_t
+     */
+    byte_span_t get_span() const;
+
+    /**
+     * @brief Get the content.
+     *
+     * @return const uint8_t*
+     */
+    const uint8_t *data() const;
+
+    /**
+     * @brief Get the content length in octets.
+     *
+     * @return size_t
+     */
+    size_t size() const;
+
+    /**
+     * @brief Get the octets that fit without allocating.
+     *
+     * @return size_t
+     */
+    size_t get_capacity() const;
+
+private:
+    /**
+     * @brief Inline storage, used while the content fits in it.
+     */
+    uint8_t inline_data[PAYLOAD_BUFFER_INLINE];
+    /**
+     * @brief Heap storage, null until the content outgrows the inline one.
+     */
+    std::unique_ptr<uint8_t[]> heap_data;
+    /**
+     * @brief Content length.
+     */
+    size_t length;
+    /**
+     * @brief Length of the storage in use.
+     */
+    size_t capacity;
+};
+
+#endif //__PAYLOAD_BUFFER_HPP__
@@ -0,0 +1,95 @@
+/**
+ * @file pcap.hpp
+ * @author Mateus Lima Alves (mateuslima.ti@gmail.com)
+ * @brief Capture file format, the libpcap file format
+ * (https://datatracker.ietf.org/doc/draft-ietf-opsawg-pcap/) with
+ * nanosecond timestamps. Records hold bare IPv4 datagrams (LINKTYPE_RAW),
+ * which Wireshark and tcpdump read as they are.
+ * @version 0.1
+ * @date 2022-04-06
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef __PCAP_HPP__
+#define __PCAP_HPP__
+
+#include <cstdint>
+
+/**
+ * @brief File header magic numbers, written in host byte order. The reader
+ * tells the byte order and the timestamp resolution from it.
+ *
+ */
+#define PCAP_MAGIC_MICROSECONDS     0xA1B2C3D4U
+#define PCAP_MAGIC_NANOSECONDS      0xA1B23C4DU
+
+#define PCAP_VERSION_MAJOR          2U
+#define PCAP_VERSION_MINOR          4U
+
+/**
+ * @brief Link types of the records: Ethernet frames, bare IPv4/IPv6
+ * datagrams, Linux cooked captures (tcpdump -i any) and bare IPv4
+ * datagrams.
+ *
+ */
+#define PCAP_LINKTYPE_ETHERNET      1U
+#define PCAP_LINKTYPE_RAW           101U
+#define PCAP_LINKTYPE_LINUX_SLL     113U
+#define PCAP_LINKTYPE_IPV4          228U
+
+/**
+ * @brief Link layer header lengths and the IPv4 and VLAN EtherTypes.
+ *
+ */
+#define PCAP_ETHERNET_LENGTH        14U
+#define PCAP_VLAN_LENGTH            4U
+#define PCAP_LINUX_SLL_LENGTH       16U
+#define PCAP_ETHERTYPE_IPV4         0x0800U
+#define PCAP_ETHERTYPE_VLAN         0x8100U
+
+/**
+ * @brief Largest record captured, in octets.
+ *
+ */
+#define PCAP_SNAPLEN                0xFFFFU
+
+/**
+ * @brief Capture file header.
+ *
+ */
+typedef struct pcap_file_header
+{
+    /** PCAP_MAGIC_NANOSECONDS or PCAP_MAGIC_MICROSECONDS. */
+    uint32_t magic;
+    /** File format version. */
+    uint16_t version_major;
+    uint16_t version_minor;
+    /** Unused, zero. */
+    int32_t zone;
+    /** Unused, zero. */
+    uint32_t sigfigs;
+    /** Largest record length, in octets. */
+    uint32_t snaplen;
+    /** Link type of every record. */
+    uint32_t linktype;
+} pcap_file_header_t;
+
+/**
+ * @brief Header of every record, followed by the captured octets.
+ *
+ */
+typedef struct pcap_record_header
+{
+    /** Capture time, seconds since the epoch. */
+    uint32_t seconds;
+    /** Capture time, nanoseconds (or microseconds) of the second. */
+    uint32_t fraction;
+    /** Octets captured. */
+    uint32_t captured_length;
+    /** Datagram length, in octets. */
+    uint32_t original_length;
+} pcap_record_header_t;
+
+#endif //__PCAP_HPP__
@@ -0,0 +1,218 @@
+/**
+ * @file pcap_reader.hpp
+ * @author Mateus Lima Alves (mateuslima.ti@gmail.com)
+ * @brief Memory-mapped capture reader. The file is mapped read-only and its
+ * records are walked in place, so a capture of any size is read without
+ * copying it to the heap. Only the IPv4 datagrams are returned, with their
+ * link layer header stripped.
+ * @version 0.1
+ * @date 2022-04-07
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef __PCAP_READER_HPP__
+#define __PCAP_READER_HPP__
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include <pcap.hpp>
+
+/**
+ * @brief Largest snap length trusted from a file header, the tcpdump one,
+ * used when the header has none.
+ *
+ */
+#define PCAP_READER_MAX_SNAPLEN     262144U
+
+/**
+ * @brief Number of chained record headers that must look valid for an
+ * offset to be taken as a record boundary.
+ *
+ */
+#define PCAP_READER_SYNC_RECORDS    4U
+
+/**
+ * @brief Largest capture time difference between those headers, in seconds.
+ *
+ */
+#define PCAP_READER_SYNC_SECONDS    3600U
+
+/**
+ * @brief Shortest range split gives, in octets, so small captures are not
+ * spread over threads that would only resynchronize.
+ *
+ */
+#define PCAP_READER_MIN_RANGE       (1U << 20)
+
+/**
+ * @brief IPv4 datagram of a capture record.
+ *
+ */
+typedef struct pcap_packet
+{
+    /** Capture time in nanoseconds since the epoch. */
+    uint64_t timestamp;
+    /** Captured octets of the datagram, inside the mapping. */
+    const uint8_t *data;
+    /** Captured length of the datagram, in octets. */
+    size_t length;
+    /** Datagram length on the wire, in octets. */
+    size_t original_length;
+} pcap_packet_t;
+
+/**
+ * @brief Capture reader class.
+ *
+ */
+class PcapReader
+{
+public:
+    /**
+     * @brief Construct a new Pcap Reader object, mapping the file and
+     * checking its header.
+     *
+     * @param path Capture file path.
+     */
+    explicit PcapReader(const char *path);
+
+    /**
+     * @brief Destroy the Pcap Reader object
+     *
+     */
+    virtual ~PcapReader();
+
+    /**
+     * @brief Get the next IPv4 datagram, skipping the records that hold
+     * anything else.
+     *
+     * @param packet Next datagram.
+     * @return true when there was one, false at the end of the records.
+     */
+    bool next(pcap_packet_t *packet);
+
+    /**
+     * @brief Splits the records into byte ranges of about the same length,
+     * without reading them.
+     *
+     * @param chunks Number of ranges wanted.
+     * @return std::vector<size_t> Offset of every range, followed by the end
+     * of the file. Fewer ranges than wanted when the file is short.
+     */
+    std::vector<size_t> split(size_t chunks);
+
+    /**
+     * @brief Restricts next to the records starting in [begin, end), offsets
+     * given by split. The first record is searched from begin unless begin
+     * is the first record of the file.
+     *
+     * @param begin Offset of the range.
+     * @param end Offset past the range.
+     */
+    void set_range(size_t begin, size_t end);
+
+    /**
+     * @brief Get the file length in octets.
+     *
+     * @return size_t
+     */
+    size_t get_size();
+
+    /**
+     * @brief Get the link type of the records.
+     *
+     * @return uint32_t
+     */
+    uint32_t get_linktype();
+
+    /**
+     * @brief Get the number of records skipped because they did not hold an
+     * IPv4 datagram.
+     *
+     * @return uint64_t
+     */
+    uint64_t get_skipped();
+
+    /**
+     * @brief Whether the last record was cut short by the end of the file.
+     *
+     * @return true when the file is truncated.
+     */
+    bool is_truncated();
+
+private:
+    /**
+     * @brief Reads a 32 bit field of the file, in the file byte order.
+     *
+     * @param data Field.
+     * @return uint32_t
+     */
+    uint32_t read_long(const uint8_t *data);
+
+    /**
+     * @brief Whether a record header starts at an offset, checking the
+     * headers chained after it as well.
+     *
+     * @param offset Offset of the header.
+     * @return true when PCAP_READER_SYNC_RECORDS chained headers, or every
+     * one up to the end of the file, look valid.
+     */
+    bool is_record(size_t offset);
+
+    /**
+     * @brief Strips the link layer header of a record.
+     *
+     * @param data Captured octets of the record.
+     * @param length Captured length, updated.
+     * @param original_length Length on the wire, updated.
+     * @return const uint8_t* The IPv4 datagram, null when the record holds
+     * something else.
+     */
+    const uint8_t *get_datagram(const uint8_t *data, size_t *length, size_t *original_length);
+
+    /**
+     * @brief Mapping of the whole file.
+     */
+    const uint8_t *mapping;
+    /**
+     * @brief File length in octets.
+     */
+    size_t size;
+    /**
+     * @brief Offset of the next record.
+     */
+    size_t offset;
+    /**
+     * @brief Offset past the last record read.
+     */
+    size_t end;
+    /**
+     * @brief Whether the file byte order is not the host one.
+     */
+    bool swapped;
+    /**
+     * @brief Nanoseconds per unit of the record time fraction.
+     */
+    uint64_t resolution;
+    /**
+     * @brief Link type of the records.
+     */
+    uint32_t linktype;
+    /**
+     * @brief Largest record captured, in octets.
+     */
+    uint32_t snaplen;
+    /**
+     * @brief Records skipped.
+     */
+    uint64_t skipped;
+    /**
+     * @brief Whether the last record was cut short.
+     */
+    bool truncated;
+};
+
+#endif //__PCAP_READER_HPP__
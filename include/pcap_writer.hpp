@@ -0,0 +1,206 @@
+/**
+ * @file pcap_writer.hpp
+ * @author Mateus Lima Alves (mateuslima.ti@gmail.com)
+ * @brief Streaming capture writer. Records are appended to large in-memory
+ * buffers under a short lock, and a background thread writes the full
+ * buffers to the file, so the send and receive paths never wait on the disk
+ * unless every buffer is full.
+ * @version 0.1
+ * @date 2022-04-06
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef __PCAP_WRITER_HPP__
+#define __PCAP_WRITER_HPP__
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <sys/uio.h>
+
+#include <pcap.hpp>
+#include <socket.hpp>
+
+/**
+ * @brief Length and number of the record buffers, in octets.
+ *
+ */
+#define PCAP_BUFFER_LENGTH          (4 << 20)
+#define PCAP_BUFFERS                4U
+
+/**
+ * @brief Longest time a record waits in a buffer before it is written, in
+ * milliseconds.
+ *
+ */
+#define PCAP_FLUSH_INTERVAL         200
+
+/**
+ * @brief Capture writer class.
+ *
+ */
+class PcapWriter
+{
+public:
+    /**
+     * @brief Construct a new Pcap Writer object, creating the file and
+     * writing its header.
+     *
+     * @param path File path, truncated when it exists.
+     * @param snaplen Octets kept of every datagram.
+     */
+    explicit PcapWriter(const char *path, uint32_t snaplen = PCAP_SNAPLEN);
+
+    /**
+     * @brief Destroy the Pcap Writer object, writing every buffered record.
+     *
+     */
+    virtual ~PcapWriter();
+
+    /**
+     * @brief Appends one datagram.
+     *
+     * @param data Datagram.
+     * @param length Datagram length in octets.
+     * @param timestamp Capture time in nanoseconds since the epoch.
+     */
+    void write(const uint8_t *data, size_t length, uint64_t timestamp);
+
+    /**
+     * @brief Appends one datagram scattered over several buffers.
+     *
+     * @param vectors Buffers of the datagram, in order.
+     * @param count Number of buffers.
+     * @param timestamp Capture time in nanoseconds since the epoch.
+     */
+    void write_gather(const struct iovec *vectors, size_t count, uint64_t timestamp);
+
+    /**
+     * @brief Appends the frames of a send batch that were sent, under a
+     * single lock.
+     *
+     * @param frames Frames given to Socket::send_batch.
+     * @param count Number of frames.
+     * @param timestamp Capture time in nanoseconds since the epoch.
+     */
+    void write_frames(const socket_frame_t *frames, size_t count, uint64_t timestamp);
+
+    /**
+     * @brief Get the number of records appended.
+     *
+     * @return uint64_t
+     */
+    uint64_t get_records();
+
+    /**
+     * @brief Get the number of records lost to file write errors.
+     *
+     * @return uint64_t
+     */
+    uint64_t get_dropped();
+
+private:
+    /**
+     * @brief Buffer handed to the flush thread.
+     *
+     */
+    typedef struct pcap_buffer
+    {
+        /** Records. */
+        uint8_t *data;
+        /** Octets used. */
+        size_t length;
+        /** Number of records. */
+        size_t records;
+    } pcap_buffer_t;
+
+    /**
+     * @brief Reserves room for a record of the given captured length in the
+     * active buffer, handing it to the flush thread and taking a free one
+     * when it is full. The lock must be held.
+     *
+     * @param lock Lock of the writer mutex.
+     * @param length Captured octets.
+     * @param original_length Datagram length in octets.
+     * @param timestamp Capture time in nanoseconds since the epoch.
+     * @return uint8_t* Where the captured octets go.
+     */
+    uint8_t *reserve(std::unique_lock<std::mutex> &lock, size_t length, size_t original_length,
+                     uint64_t timestamp);
+
+    /**
+     * @brief Hands the active buffer to the flush thread. The lock must be
+     * held.
+     *
+     */
+    void hand_off();
+
+    /**
+     * @brief Flush thread loop, writes the full buffers in order.
+     *
+     */
+    void run();
+
+    /**
+     * @brief File descriptor of the capture file.
+     */
+    int file_descriptor;
+    /**
+     * @brief Octets kept of every datagram.
+     */
+    uint32_t snaplen;
+    /**
+     * @brief Storage of every buffer.
+     */
+    std::unique_ptr<uint8_t[]> storage;
+    /**
+     * @brief Buffer records are appended to, data is null when none.
+     */
+    pcap_buffer_t active;
+    /**
+     * @brief Buffers free to become active.
+     */
+    std::vector<uint8_t *> free_buffers;
+    /**
+     * @brief Buffers waiting to be written, in order.
+     */
+    std::deque<pcap_buffer_t> full_buffers;
+    /**
+     * @brief Guards every buffer list.
+     */
+    std::mutex mutex;
+    /**
+     * @brief Signals the flush thread that a buffer is full.
+     */
+    std::condition_variable full_condition;
+    /**
+     * @brief Signals the writers that a buffer is free.
+     */
+    std::condition_variable free_condition;
+    /**
+     * @brief Whether the flush thread must write everything left and return.
+     */
+    bool stopping;
+    /**
+     * @brief Records appended.
+     */
+    std::atomic<uint64_t> records;
+    /**
+     * @brief Records lost to write errors.
+     */
+    std::atomic<uint64_t> dropped;
+    /**
+     * @brief Flush thread.
+     */
+    std::thread thread;
+};
+
+#endif //__PCAP_WRITER_HPP__
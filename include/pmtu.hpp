@@ -0,0 +1,350 @@
+/**
+ * @file pmtu.hpp
+ * @author Mateus Lima Alves (mateuslima.ti@gmail.com)
+ * @brief Path MTU discovery engine, according rfc1191
+ * (https://datatracker.ietf.org/doc/html/rfc1191). Every round sends DF
+ * ECHO probes of several sizes to a target at once and narrows the range
+ * between the largest size answered and the smallest size that did not get
+ * through. FRAGMENTATION_NEEDED replies cap the range at the next-hop MTU
+ * they report, so most paths converge in two rounds. Results are kept in a
+ * per-destination cache. Targets are read from a TargetSource as the window
+ * has room and their state is freed once reported. Runs on the shared probe
+ * window.
+ * @version 0.1
+ * @date 2022-04-03
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef __PMTU_HPP__
+#define __PMTU_HPP__
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+
+#include <probe_engine.hpp>
+#include <target_source.hpp>
+#include <ipv4.hpp>
+
+/**
+ * @brief Smallest MTU of an IPv4 path (rfc791) and default largest datagram
+ * probed, in octets.
+ *
+ */
+#define PMTU_MIN                68U
+#define PMTU_DEFAULT_MAX        9000U
+
+/**
+ * @brief Probes sent to a target per round, and rounds per target.
+ *
+ */
+#define PMTU_PROBES             8U
+#define PMTU_MAX_ROUNDS         6U
+
+/**
+ * @brief Time a cached path MTU is trusted, in nanoseconds. Ten minutes, as
+ * recommended by rfc1191.
+ *
+ */
+#define PMTU_CACHE_EXPIRY       (600ULL * 1000000000ULL)
+
+/**
+ * @brief Outcome of the discovery for a target.
+ *
+ */
+typedef enum pmtu_status
+{
+    PMTU_FOUND = 0,
+    PMTU_CACHED,
+    PMTU_UNREACHABLE
+} pmtu_status_t;
+
+/**
+ * @brief Result of the discovery for a target.
+ *
+ */
+typedef struct pmtu_result
+{
+    /** Index of the target, in the order the source gives them. */
+    size_t target;
+    /** Target address, in network byte order. */
+    uint32_t destination_address;
+    /** Discovery outcome. */
+    pmtu_status_t status;
+    /** Largest datagram that reached the target, in octets. */
+    uint16_t mtu;
+    /** Lowest next-hop MTU reported by FRAGMENTATION_NEEDED, zero when none. */
+    uint16_t next_hop_mtu;
+    /** Address of the router that reported it, in network byte order. */
+    uint32_t reporter;
+    /** Number of rounds sent. */
+    uint16_t rounds;
+} pmtu_result_t;
+
+/**
+ * @brief Called once per target, as soon as its path MTU is known.
+ *
+ */
+typedef std::function<void(const pmtu_result_t &result)> pmtu_callback_t;
+
+/**
+ * @brief Per-destination path MTU cache class.
+ *
+ */
+class PmtuCache
+{
+public:
+    /**
+     * @brief Construct a new Pmtu Cache object
+     *
+     * @param expiry Time an entry is trusted, in nanoseconds.
+     */
+    explicit PmtuCache(uint64_t expiry = PMTU_CACHE_EXPIRY);
+
+    /**
+     * @brief Destroy the Pmtu Cache object
+     *
+     */
+    virtual ~PmtuCache();
+
+    /**
+     * @brief Get the path MTU to a destination.
+     *
+     * @param destination_address Destination address, in network byte order.
+     * @param now Current time in nanoseconds.
+     * @return uint16_t Path MTU in octets, zero when unknown or expired.
+     */
+    uint16_t get(uint32_t destination_address, uint64_t now);
+
+    /**
+     * @brief Set the path MTU to a destination.
+     *
+     * @param destination_address Destination address, in network byte order.
+     * @param mtu Path MTU in octets.
+     * @param now Current time in nanoseconds.
+     */
+    void set(uint32_t destination_address, uint16_t mtu, uint64_t now);
+
+    /**
+     * @brief Get the number of cached destinations, expired ones included.
+     *
+     * @return size_t
+     */
+    size_t size();
+
+private:
+    /**
+     * @brief Cached path MTU.
+     *
+     */
+    typedef struct pmtu_entry
+    {
+        /** Path MTU in octets. */
+        uint16_t mtu;
+        /** Time the entry expires, in nanoseconds. */
+        uint64_t expires;
+    } pmtu_entry_t;
+
+    /**
+     * @brief Entries by destination address.
+     */
+    std::unordered_map<uint32_t, pmtu_entry_t> entries;
+    /**
+     * @brief Time an entry is trusted, in nanoseconds.
+     */
+    uint64_t expiry;
+};
+
+/**
+ * @brief Path MTU discovery engine class.
+ *
+ */
+class Pmtu : public ProbeEngine
+{
+public:
+    /**
+     * @brief Construct a new Pmtu object
+     *
+     * @param socket Socket used to send and receive, receive gets enabled.
+     * @param source_address Source address, in network byte order.
+     * @param in_flight Maximum number of probes waiting for a reply.
+     * @param timeout Time to wait for a reply, in milliseconds.
+     * @param max_mtu Largest datagram probed, in octets.
+     * @param cache Cache read before probing a target and filled with the
+     * results, nullptr for none.
+     */
+    explicit Pmtu(Socket &socket, uint32_t source_address, size_t in_flight, int timeout,
+                  uint16_t max_mtu = PMTU_DEFAULT_MAX, PmtuCache *cache = nullptr);
+
+    /**
+     * @brief Destroy the Pmtu object
+     *
+     */
+    virtual ~Pmtu();
+
+    /**
+     * @brief Discovers the path MTU of every target and reports each one
+     * through the callback. Targets are probed concurrently, sharing the
+     * window.
+     *
+     * @param source Targets, read as the window has room.
+     * @param callback Called once per target.
+     */
+    void run(TargetSource &source, const pmtu_callback_t &callback);
+
+    /**
+     * @brief Get the number of targets of the last run.
+     *
+     * @return size_t
+     */
+    size_t get_targets();
+
+protected:
+    /**
+     * @brief Whether there are rounds queued or targets left to start.
+     *
+     * @return true
+     * @return false
+     */
+    bool has_probes() override;
+
+    /**
+     * @brief Get the next probes: queued rounds first, then the first round
+     * of new targets.
+     *
+     * @param probes Next probes.
+     * @param max Largest number of probes wanted.
+     * @return size_t
+     */
+    size_t next_probes(engine_probe_t *probes, size_t max) override;
+
+    /**
+     * @brief Encodes a probe of the size packed in its target.
+     *
+     * @param probe Probe.
+     * @param sequence_number ICMP sequence number of the probe.
+     * @param buffer Frame of max_mtu octets.
+     * @return size_t
+     */
+    size_t encode(const engine_probe_t &probe, uint16_t sequence_number, uint8_t *buffer) override;
+
+    /**
+     * @brief Matches a received datagram against the probes in flight,
+     * either an ECHO_REPLY or a FRAGMENTATION_NEEDED quoting a probe.
+     *
+     * @param data Received datagram.
+     * @param length Datagram length in octets.
+     * @param timestamp Receive timestamp in nanoseconds.
+     */
+    void handle_reply(const uint8_t *data, size_t length, uint64_t timestamp) override;
+
+    /**
+     * @brief Handles a probe timeout, taken as the probe being too big.
+     *
+     * @param destination_address Target address, in network byte order.
+     * @param record Copy of the probe record.
+     */
+    void handle_timeout(uint32_t destination_address, const probe_record_t &record) override;
+
+    /**
+     * @brief Handles a probe that could not be sent, taken as the probe
+     * being too big.
+     *
+     * @param probe Probe.
+     */
+    void handle_send_error(const engine_probe_t &probe) override;
+
+private:
+    /**
+     * @brief Discovery state of a target. The path MTU is in (lower, upper]
+     * until lower equals upper.
+     *
+     */
+    typedef struct pmtu_state
+    {
+        /** Target address, in network byte order. */
+        uint32_t destination_address;
+        /** Largest datagram answered, zero when none. */
+        uint16_t lower;
+        /** Largest datagram that may get through. */
+        uint16_t upper;
+        /** Lowest next-hop MTU reported, zero when none. */
+        uint16_t next_hop_mtu;
+        /** Router that reported it. */
+        uint32_t reporter;
+        /** Probes of the current round without an outcome. */
+        uint16_t outstanding;
+        /** Rounds sent. */
+        uint16_t rounds;
+    } pmtu_state_t;
+
+    /**
+     * @brief Queues the next round of a target, or reports its result and
+     * frees its state when the range converged or the rounds ran out.
+     *
+     * @param target Index of the target.
+     */
+    void plan(size_t target);
+
+    /**
+     * @brief Records the outcome of a probe, planning the next round of the
+     * target once the round has no probes left.
+     *
+     * @param target Index of the target.
+     * @param size Datagram length in octets.
+     * @param answered Whether the probe reached the target.
+     */
+    void resolve(size_t target, uint16_t size, bool answered);
+
+    /**
+     * @brief IPv4 header of every probe, DF set.
+     */
+    Ipv4 ipv4;
+    /**
+     * @brief Largest datagram probed, in octets.
+     */
+    uint16_t max_mtu;
+    /**
+     * @brief Cache of the results, may be null.
+     */
+    PmtuCache *cache;
+    /**
+     * @brief Targets of the running discovery.
+     */
+    TargetSource *source;
+    /**
+     * @brief Whether every target was read from the source.
+     */
+    bool exhausted;
+    /**
+     * @brief Result callback of the running discovery.
+     */
+    const pmtu_callback_t *callback;
+    /**
+     * @brief Discovery state of the targets not reported yet, by target
+     * index.
+     */
+    std::unordered_map<size_t, pmtu_state_t> states;
+    /**
+     * @brief Probes waiting to be sent, sent before new targets. The probe
+     * target packs the target index and the datagram length.
+     */
+    std::deque<engine_probe_t> pending;
+    /**
+     * @brief Number of targets read from the source, the index of the next
+     * one.
+     */
+    size_t target_count;
+    /**
+     * @brief Zeroed ECHO payload, max_mtu long, shared by every probe.
+     */
+    std::vector<uint8_t> payload;
+};
+
+#endif //__PMTU_HPP__
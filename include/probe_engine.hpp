@@ -0,0 +1,218 @@
+/**
+ * @file probe_engine.hpp
+ * @author Mateus Lima Alves (mateuslima.ti@gmail.com)
+ * @brief Probe window shared by the sweep, traceroute and path MTU engines.
+ * It keeps a bounded number of probes in flight, sends them in batches
+ * interleaved with the socket receive loop, matches them by (destination,
+ * identifier, sequence number) and drives their timeouts with a timing
+ * wheel. The engines only choose, encode and interpret the probes.
+ * @version 0.1
+ * @date 2022-04-02
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef __PROBE_ENGINE_HPP__
+#define __PROBE_ENGINE_HPP__
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+
+#include <socket.hpp>
+#include <probe_table.hpp>
+#include <timing_wheel.hpp>
+#include <packet_pool.hpp>
+
+/**
+ * @brief Probe to be sent.
+ *
+ */
+typedef struct engine_probe
+{
+    /** Engine data kept in the probe record, usually the target index. */
+    uint64_t target;
+    /** Destination address, in network byte order. */
+    uint32_t destination_address;
+    /** Number of times the target was probed again, kept in the probe record. */
+    uint16_t retries;
+} engine_probe_t;
+
+/**
+ * @brief Probe window class, derived by every probing engine.
+ *
+ */
+class ProbeEngine
+{
+public:
+    /**
+     * @brief Construct a new Probe Engine object
+     *
+     * @param socket Socket used to send and receive, receive gets enabled.
+     * @param in_flight Maximum number of probes waiting for a reply.
+     * @param timeout Time to wait for a reply, in milliseconds.
+     */
+    explicit ProbeEngine(Socket &socket, size_t in_flight, int timeout);
+
+    /**
+     * @brief Destroy the Probe Engine object
+     *
+     */
+    virtual ~ProbeEngine();
+
+protected:
+    /**
+     * @brief Sends probes while there are some to send and the window has
+     * room, until every probe sent got a result.
+     *
+     */
+    void run_window();
+
+    /**
+     * @brief Allocates the frames of a send batch.
+     *
+     * @param frame_size Largest probe, in octets.
+     */
+    void set_frame_size(size_t frame_size);
+
+    /**
+     * @brief Matches a reply against the probes in flight, cancelling the
+     * timer of the probe it answers.
+     *
+     * @param destination_address Destination of the probe, in network byte order.
+     * @param sequence_number ICMP sequence number of the probe.
+     * @param record Copy of the probe record, when the probe is known.
+     * @return probe_match_t
+     */
+    probe_match_t match(uint32_t destination_address, uint16_t sequence_number,
+                        probe_record_t *record);
+
+    /**
+     * @brief Whether there are probes to send.
+     *
+     * @return true when next_probes may return probes.
+     */
+    virtual bool has_probes() = 0;
+
+    /**
+     * @brief Get the next probes to send.
+     *
+     * @param probes Next probes.
+     * @param max Largest number of probes wanted.
+     * @return size_t Number of probes.
+     */
+    virtual size_t next_probes(engine_probe_t *probes, size_t max) = 0;
+
+    /**
+     * @brief Called once per batch, before its probes are encoded.
+     *
+     * @param now Current time in nanoseconds.
+     */
+    virtual void prepare_batch(uint64_t now);
+
+    /**
+     * @brief Encodes a probe.
+     *
+     * @param probe Probe.
+     * @param sequence_number ICMP sequence number of the probe.
+     * @param buffer Frame of set_frame_size octets.
+     * @return size_t Datagram length in octets.
+     */
+    virtual size_t encode(const engine_probe_t &probe, uint16_t sequence_number, uint8_t *buffer) = 0;
+
+    /**
+     * @brief Handles a received datagram, calling match for the replies.
+     *
+     * @param data Received datagram.
+     * @param length Datagram length in octets.
+     * @param timestamp Receive timestamp in nanoseconds.
+     */
+    virtual void handle_reply(const uint8_t *data, size_t length, uint64_t timestamp) = 0;
+
+    /**
+     * @brief Handles a probe that got no reply in time.
+     *
+     * @param destination_address Destination of the probe, in network byte order.
+     * @param record Copy of the probe record.
+     */
+    virtual void handle_timeout(uint32_t destination_address, const probe_record_t &record) = 0;
+
+    /**
+     * @brief Handles a probe that could not be sent.
+     *
+     * @param probe Probe.
+     */
+    virtual void handle_send_error(const engine_probe_t &probe) = 0;
+
+    /**
+     * @brief Socket used to send and receive.
+     */
+    Socket &socket;
+    /**
+     * @brief ICMP identifier of every probe.
+     */
+    uint16_t identifier;
+
+private:
+    /**
+     * @brief Sends one batch of probes, if the window has room.
+     *
+     */
+    void send_window();
+
+    /**
+     * @brief Handles a probe timeout.
+     *
+     * @param data Timer data, the packed destination and sequence number.
+     */
+    void expire(uint64_t data);
+
+    /**
+     * @brief Get the milliseconds to wait on the socket before the next step.
+     *
+     * @param now Current time in nanoseconds.
+     * @return int
+     */
+    int get_wait_timeout(uint64_t now);
+
+    /**
+     * @brief ICMP sequence number of the next probe.
+     */
+    uint16_t sequence_number;
+    /**
+     * @brief Maximum number of probes waiting for a reply.
+     */
+    size_t max_in_flight;
+    /**
+     * @brief Time to wait for a reply, in nanoseconds.
+     */
+    uint64_t timeout;
+    /**
+     * @brief Probes in flight, matched by (destination, identifier, sequence).
+     */
+    ProbeTable table;
+    /**
+     * @brief Timeout timers of the probes in flight.
+     */
+    TimingWheel wheel;
+    /**
+     * @brief Frame buffers of a send batch, released once it is sent.
+     */
+    std::unique_ptr<PacketPool> pool;
+    /**
+     * @brief Frames of a send batch.
+     */
+    std::vector<socket_frame_t> frames;
+    /**
+     * @brief Probes of a send batch.
+     */
+    std::vector<engine_probe_t> probes;
+    /**
+     * @brief Sequence numbers of a send batch.
+     */
+    std::vector<uint16_t> sequences;
+};
+
+#endif //__PROBE_ENGINE_HPP__
@@ -0,0 +1,226 @@
+/**
+ * @file probe_table.hpp
+ * @author Mateus Lima Alves (mateuslima.ti@gmail.com)
+ * @brief In-flight probe table used to match replies to probes. It is a flat,
+ * power of two, open addressing (linear probing) table of fixed-size records
+ * keyed by (destination, identifier, sequence number), allocated once for
+ * the maximum number of probes in flight. Answered and expired probes are
+ * kept for a while, so duplicate and late replies can be told apart from
+ * unknown ones.
+ * @version 0.1
+ * @date 2022-03-24
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef __PROBE_TABLE_HPP__
+#define __PROBE_TABLE_HPP__
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * @brief Largest number of probes in flight. Probes to a destination are
+ * told apart by their 16 bit sequence number, so at least one of them is
+ * always free.
+ *
+ */
+#define PROBE_TABLE_MAX_IN_FLIGHT   65535U
+
+/**
+ * @brief State of a probe record.
+ *
+ */
+typedef enum probe_state
+{
+    PROBE_FREE = 0,
+    PROBE_IN_FLIGHT,
+    PROBE_ANSWERED,
+    PROBE_EXPIRED
+} probe_state_t;
+
+/**
+ * @brief Result of matching a reply against the table.
+ *
+ */
+typedef enum probe_match
+{
+    /** First reply to a probe in flight. */
+    PROBE_MATCHED = 0,
+    /** Another reply to a probe already answered. */
+    PROBE_DUPLICATE,
+    /** Reply to a probe that already expired. */
+    PROBE_LATE,
+    /** Reply to no known probe. */
+    PROBE_UNKNOWN
+} probe_match_t;
+
+/**
+ * @brief Probe record.
+ *
+ */
+typedef struct probe_record
+{
+    /** Packed (destination, identifier, sequence number) key. */
+    uint64_t key;
+    /** Send timestamp in nanoseconds. */
+    uint64_t sent_timestamp;
+    /** Index of the probed target. */
+    uint64_t target;
+    /** Timeout timer of the probe. */
+    uint32_t timer;
+    /** Number of times the target was probed again. */
+    uint16_t retries;
+    /** Record state. */
+    uint8_t state;
+} probe_record_t;
+
+/**
+ * @brief In-flight probe table class.
+ *
+ */
+class ProbeTable
+{
+public:
+    /**
+     * @brief Construct a new Probe Table object
+     *
+     * @param max_in_flight Maximum number of probes in flight.
+     */
+    explicit ProbeTable(size_t max_in_flight);
+
+    /**
+     * @brief Destroy the Probe Table object
+     *
+     */
+    virtual ~ProbeTable();
+
+    /**
+     * @brief Registers a probe just sent.
+     *
+     * @param destination_address Destination address, in network byte order.
+     * @param identifier ICMP identifier.
+     * @param sequence_number ICMP sequence number.
+     * @return probe_record_t* Record to be filled, nullptr when the maximum
+     * number of probes in flight is reached or the key is already in flight.
+     */
+    probe_record_t *insert(uint32_t destination_address, uint16_t identifier,
+                           uint16_t sequence_number);
+
+    /**
+     * @brief Whether a probe is in flight.
+     *
+     * @param destination_address Destination address, in network byte order.
+     * @param identifier ICMP identifier.
+     * @param sequence_number ICMP sequence number.
+     * @return true when the key is in flight.
+     */
+    bool is_in_flight(uint32_t destination_address, uint16_t identifier, uint16_t sequence_number);
+
+    /**
+     * @brief Matches a reply, marking its probe as answered.
+     *
+     * @param source_address Reply source address, in network byte order.
+     * @param identifier ICMP identifier.
+     * @param sequence_number ICMP sequence number.
+     * @param record Copy of the probe record, when the probe is known.
+     * @return probe_match_t
+     */
+    probe_match_t match(uint32_t source_address, uint16_t identifier,
+                        uint16_t sequence_number, probe_record_t *record);
+
+    /**
+     * @brief Marks a probe in flight as expired.
+     *
+     * @param destination_address Destination address, in network byte order.
+     * @param identifier ICMP identifier.
+     * @param sequence_number ICMP sequence number.
+     * @param record Copy of the probe record.
+     * @return true when the probe was in flight.
+     */
+    bool expire(uint32_t destination_address, uint16_t identifier,
+                uint16_t sequence_number, probe_record_t *record);
+
+    /**
+     * @brief Get the number of probes in flight.
+     *
+     * @return size_t
+     */
+    size_t get_in_flight();
+
+    /**
+     * @brief Forgets every probe.
+     *
+     */
+    void clear();
+
+private:
+    /**
+     * @brief Packs a probe key.
+     *
+     * @return uint64_t
+     */
+    static uint64_t make_key(uint32_t address, uint16_t identifier, uint16_t sequence_number);
+
+    /**
+     * @brief Finds the slot of a key.
+     *
+     * @param key Probe key.
+     * @return size_t Slot index, or the table capacity when not found.
+     */
+    size_t find(uint64_t key);
+
+    /**
+     * @brief Frees a slot, shifting back the records that follow it so no
+     * tombstone is needed.
+     *
+     * @param slot Slot index.
+     */
+    void erase(size_t slot);
+
+    /**
+     * @brief Moves a record out of flight and keeps it as retired, dropping
+     * the oldest retired record when there are too many.
+     *
+     * @param slot Slot index.
+     * @param state New state.
+     */
+    void retire(size_t slot, probe_state_t state);
+
+    /**
+     * @brief Records, capacity is a power of two.
+     */
+    std::vector<probe_record_t> records;
+    /**
+     * @brief Capacity minus one, masks a hash into a slot.
+     */
+    size_t mask;
+    /**
+     * @brief Shift turning the 64 bit hash into a slot index.
+     */
+    unsigned shift;
+    /**
+     * @brief Maximum number of probes in flight.
+     */
+    size_t max_in_flight;
+    /**
+     * @brief Number of probes in flight.
+     */
+    size_t in_flight;
+    /**
+     * @brief Keys of retired records, oldest first (ring buffer).
+     */
+    std::vector<uint64_t> retired;
+    /**
+     * @brief Index of the oldest retired key.
+     */
+    size_t retired_head;
+    /**
+     * @brief Number of retired keys.
+     */
+    size_t retired_count;
+};
+
+#endif //__PROBE_TABLE_HPP__
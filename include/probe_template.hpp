@@ -0,0 +1,215 @@
+/**
+ * @file probe_template.hpp
+ * @author Mateus Lima Alves (mateuslima.ti@gmail.com)
+ * @brief Precompiled IPv4 + ICMP ECHO probe. The datagram is encoded once and
+ * only the fields that change between probes (destination address,
+ * identifier and sequence number) are patched in place, with both checksums
+ * updated incrementally according rfc1624
+ * (https://datatracker.ietf.org/doc/html/rfc1624). A payload shared by
+ * every probe may be attached after the encoded datagram without being
+ * copied, the probe is then sent as a scatter-gather list.
+ * @version 0.1
+ * @date 2022-03-21
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef __PROBE_TEMPLATE_HPP__
+#define __PROBE_TEMPLATE_HPP__
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <sys/uio.h>
+
+#include <icmp.hpp>
+#include <icmp_message.hpp>
+#include <ipv4.hpp>
+
+#define PROBE_VECTORS_MAX   2U
+
+/**
+ * @brief Precompiled probe class.
+ *
+ */
+class ProbeTemplate
+{
+public:
+    /**
+     * @brief Construct a new Probe Template object, encoding the datagram.
+     *
+     * @param ipv4 IPv4 header of every probe.
+     * @param icmp ICMP packet of every probe, it must have identifier and
+     * sequence number fields.
+     */
+    explicit ProbeTemplate(Ipv4 &ipv4, Icmp &icmp);
+
+    /**
+     * @brief Construct a new Probe Template object from a message type
+     * checked at compile time, encoding the datagram.
+     *
+     * @param ipv4 IPv4 header of every probe.
+     * @param icmp ICMP message of every probe, its type must have
+     * identifier and sequence number fields.
+     */
+    template <message_type_t TYPE, message_code_t CODE>
+    explicit ProbeTemplate(Ipv4 &ipv4, IcmpMessage<TYPE, CODE> &icmp) :
+        payload{nullptr}, payload_length{0}
+    {
+        static_assert(icmp_has_sequence(TYPE),
+                      "PROBE - This packet type don't have identifier and sequence number.");
+
+        this->icmp_offset = ipv4.get_header_length();
+        this->frame.resize(this->icmp_offset + icmp.get_length());
+        icmp.encode_into(&this->frame[this->icmp_offset], icmp.get_length());
+        ipv4.encode_header_into(this->frame.data(), this->frame.size(), icmp.get_length());
+    }
+
+    /**
+     * @brief Destroy the Probe Template object
+     *
+     */
+    virtual ~ProbeTemplate();
+
+    /**
+     * @brief Get the destination address object
+     *
+     * @return uint32_t Destination address, in network byte order.
+     */
+    uint32_t get_destination_address();
+
+    /**
+     * @brief Get the identifier object
+     *
+     * @return uint16_t
+     */
+    uint16_t get_identifier();
+
+    /**
+     * @brief Get the ttl object
+     *
+     * @return uint8_t
+     */
+    uint8_t get_ttl();
+
+    /**
+     * @brief Get the sequence number object
+     *
+     * @return uint16_t
+     */
+    uint16_t get_sequence_number();
+
+    /**
+     * @brief Set the destination address object
+     *
+     * @param destination_address Destination address, in network byte order.
+     */
+    void set_destination_address(uint32_t destination_address);
+
+    /**
+     * @brief Set the identifier object
+     *
+     * @param identifier
+     */
+    void set_identifier(uint16_t identifier);
+
+    /**
+     * @brief Set the ttl object
+     *
+     * @param ttl Time to live, at least one.
+     */
+    void set_ttl(uint8_t ttl);
+
+    /**
+     * @brief Set the sequence number object
+     *
+     * @param sequence_number
+     */
+    void set_sequence_number(uint16_t sequence_number);
+
+    /**
+     * @brief Set the originate timestamp of a TIMESTAMP probe.
+     *
+     * @param originate Milliseconds since midnight UT.
+     */
+    void set_originate_timestamp(uint32_t originate);
+
+    /**
+     * @brief Attaches a payload after the encoded datagram. It is not copied,
+     * only summed once, and must outlive every probe sent with it.
+     *
+     * @param payload Shared payload, nullptr detaches the current one.
+     * @param length Payload length in octets.
+     */
+    void set_payload(const uint8_t *payload, size_t length);
+
+    /**
+     * @brief Get the encoded datagram, without the shared payload.
+     *
+     * @return const uint8_t*
+     */
+    const uint8_t *data();
+
+    /**
+     * @brief Get the datagram length in octets, shared payload included.
+     *
+     * @return size_t
+     */
+    size_t get_length();
+
+    /**
+     * @brief Get the encoded datagram length in octets, without the shared
+     * payload.
+     *
+     * @return size_t
+     */
+    size_t get_header_length();
+
+    /**
+     * @brief Fills the scatter-gather list of the datagram: the encoded part
+     * and, when attached, the shared payload.
+     *
+     * @param vectors List with room for PROBE_VECTORS_MAX entries.
+     * @return size_t Number of entries filled.
+     */
+    size_t get_vectors(struct iovec *vectors);
+
+private:
+    /**
+     * @brief Reads a big-endian 16 bit word of the datagram.
+     *
+     * @param offset Word offset in octets.
+     * @return uint16_t
+     */
+    uint16_t read_word(size_t offset);
+
+    /**
+     * @brief Writes a big-endian 16 bit word of the datagram and adjusts the
+     * checksum covering it.
+     *
+     * @param offset Word offset in octets.
+     * @param value New word value.
+     * @param checksum_offset Offset of the checksum covering the word.
+     */
+    void patch_word(size_t offset, uint16_t value, size_t checksum_offset);
+
+    /**
+     * @brief Encoded datagram.
+     */
+    std::vector<uint8_t> frame;
+    /**
+     * @brief Offset of the ICMP packet inside the datagram.
+     */
+    size_t icmp_offset;
+    /**
+     * @brief Shared payload sent after the encoded datagram.
+     */
+    const uint8_t *payload;
+    /**
+     * @brief Shared payload length in octets.
+     */
+    size_t payload_length;
+};
+
+#endif //__PROBE_TEMPLATE_HPP__
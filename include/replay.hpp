@@ -0,0 +1,115 @@
+/**
+ * @file replay.hpp
+ * @author Mateus Lima Alves (mateuslima.ti@gmail.com)
+ * @brief Capture replay engine. Sends the IPv4/ICMP datagrams of a capture
+ * again, straight from the file mapping, with the original gaps between
+ * them, with the gaps scaled by a speed factor, or as fast as possible.
+ * Datagrams that are due together leave in one send batch.
+ * @version 0.1
+ * @date 2022-04-07
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef __REPLAY_HPP__
+#define __REPLAY_HPP__
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include <socket.hpp>
+#include <pcap_reader.hpp>
+
+/**
+ * @brief Waits shorter than this are spun instead of slept, in nanoseconds.
+ *
+ */
+#define REPLAY_SPIN             50000ULL
+
+/**
+ * @brief Outcome of a replay.
+ *
+ */
+typedef struct replay_stats
+{
+    /** ICMP datagrams read from the capture. */
+    uint64_t datagrams;
+    /** Datagrams sent. */
+    uint64_t sent;
+    /** Datagrams the kernel refused. */
+    uint64_t send_errors;
+    /** Records skipped: not IPv4, not ICMP, truncated by the snap length or
+     * with an invalid header. */
+    uint64_t skipped;
+    /** Time between the first and the last datagram of the capture, in nanoseconds. */
+    uint64_t capture_duration;
+    /** Time the replay took, in nanoseconds. */
+    uint64_t duration;
+} replay_stats_t;
+
+/**
+ * @brief Capture replay engine class.
+ *
+ */
+class Replay
+{
+public:
+    /**
+     * @brief Construct a new Replay object
+     *
+     * @param socket Socket used to send.
+     * @param speed Factor the capture time is sped up by, 1 keeps the
+     * original gaps and 0 sends as fast as possible.
+     */
+    explicit Replay(Socket &socket, double speed = 1.0);
+
+    /**
+     * @brief Destroy the Replay object
+     *
+     */
+    virtual ~Replay();
+
+    /**
+     * @brief Sends every ICMP datagram of the capture, in order.
+     *
+     * @param reader Capture to replay, read until its end.
+     * @param stats Replay outcome.
+     */
+    void run(PcapReader &reader, replay_stats_t *stats);
+
+private:
+    /**
+     * @brief Sends the pending batch.
+     *
+     * @param stats Replay outcome, updated.
+     */
+    void flush(replay_stats_t *stats);
+
+    /**
+     * @brief Sleeps, then spins, until the deadline.
+     *
+     * @param deadline Time in nanoseconds, from get_timestamp.
+     */
+    void wait_until(uint64_t deadline);
+
+    /**
+     * @brief Socket used to send.
+     */
+    Socket &socket;
+    /**
+     * @brief Capture time speed-up factor, zero for as fast as possible.
+     */
+    double speed;
+    /**
+     * @brief Frames of the pending batch, pointing into the capture mapping.
+     */
+    std::vector<socket_frame_t> frames;
+    /**
+     * @brief Number of frames pending.
+     */
+    size_t pending;
+};
+
+#endif //__REPLAY_HPP__
@@ -0,0 +1,164 @@
+/**
+ * @file responder.hpp
+ * @author Mateus Lima Alves (mateuslima.ti@gmail.com)
+ * @brief Userspace ECHO responder, a load-test peer that is not bound by the
+ * kernel icmp_ratelimit. Every worker batch-receives ECHO requests on its own
+ * raw socket, rewrites them in place into ECHO_REPLY, patching the checksums
+ * instead of summing the messages again, and batch-sends them back. The
+ * kernel responder of the host should be turned off
+ * (net.ipv4.icmp_echo_ignore_all=1) or every request gets two replies.
+ * @version 0.1
+ * @date 2022-04-05
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef __RESPONDER_HPP__
+#define __RESPONDER_HPP__
+
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <exception>
+#include <cstdint>
+#include <cstddef>
+
+#include <socket.hpp>
+
+/**
+ * @brief Milliseconds a worker waits for requests before checking whether
+ * it was stopped.
+ *
+ */
+#define RESPONDER_WAIT_TIMEOUT  100
+
+/**
+ * @brief Largest number of workers.
+ *
+ */
+#define RESPONDER_MAX_THREADS   256U
+
+/**
+ * @brief ECHO responder class.
+ *
+ */
+class Responder
+{
+public:
+    /**
+     * @brief Construct a new Responder object, opening the sockets of the
+     * workers.
+     *
+     * @param threads Number of workers, zero for one per CPU.
+     */
+    explicit Responder(size_t threads = 0);
+
+    /**
+     * @brief Destroy the Responder object, stopping the workers.
+     *
+     */
+    virtual ~Responder();
+
+    /**
+     * @brief Starts the workers, each one pinned to a CPU.
+     *
+     */
+    void start();
+
+    /**
+     * @brief Stops the workers and waits for them to return.
+     *
+     */
+    void stop();
+
+    /**
+     * @brief Whether the workers are running, false once stopped or once a
+     * worker failed.
+     *
+     * @return true
+     * @return false
+     */
+    bool is_running();
+
+    /**
+     * @brief Throws the error of the first worker that failed, if any. Call
+     * it once the workers are stopped.
+     *
+     */
+    void check_error();
+
+    /**
+     * @brief Get the number of workers.
+     *
+     * @return size_t
+     */
+    size_t get_threads();
+
+    /**
+     * @brief Get the number of replies sent by every worker so far.
+     *
+     * @return uint64_t
+     */
+    uint64_t get_replies();
+
+    /**
+     * @brief Rewrites an ECHO request into its ECHO_REPLY in place: the
+     * addresses are swapped, the time to live reset and the type changed,
+     * with both checksums adjusted incrementally.
+     *
+     * @param data Received IPv4 datagram.
+     * @param length Datagram length in octets.
+     * @param destination_address Reply destination, in network byte order.
+     * @return size_t Reply length in octets, zero when the datagram was not a
+     * valid ECHO request.
+     */
+    static size_t reply(uint8_t *data, size_t length, uint32_t *destination_address);
+
+private:
+    /**
+     * @brief Replies sent by a worker, on its own cache line.
+     *
+     */
+    typedef struct alignas(64) responder_counter
+    {
+        std::atomic<uint64_t> replies;
+    } responder_counter_t;
+
+    /**
+     * @brief Worker loop, answers the requests of its socket until stopped.
+     *
+     * @param index Index of the worker.
+     */
+    void work(size_t index);
+
+    /**
+     * @brief Socket of every worker, each one receiving its share of the
+     * requests.
+     */
+    std::vector<std::unique_ptr<Socket>> sockets;
+    /**
+     * @brief Reply counter of every worker.
+     */
+    std::unique_ptr<responder_counter_t[]> counters;
+    /**
+     * @brief Worker threads, empty when stopped.
+     */
+    std::vector<std::thread> workers;
+    /**
+     * @brief Whether the workers must keep running.
+     */
+    std::atomic<bool> running;
+    /**
+     * @brief Error of the first worker that failed, null when none did.
+     */
+    std::exception_ptr error;
+    /**
+     * @brief Serializes the workers recording an error.
+     */
+    std::mutex error_mutex;
+};
+
+#endif //__RESPONDER_HPP__
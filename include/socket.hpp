@@ -14,11 +14,60 @@
 
 #include <string>
 #include <sys/epoll.h>
+#include <sys/uio.h>
+#include <linux/filter.h>
 #include <list>
 #include <memory>
 #include <vector>
+#include <functional>
+#include <atomic>
+#include <cstdint>
 
-#define SOCKET_WAIT_TIMEOUT 500 // In milliseconds.
+#include <packet_pool.hpp>
+
+#define SOCKET_WAIT_TIMEOUT     500             // In milliseconds.
+#define SOCKET_BATCH_MAX        64              // Messages per sendmmsg/recvmmsg call.
+#define SOCKET_BATCH_LIMIT      1024            // Largest --batch, 16 sendmmsg calls.
+#define SOCKET_RECEIVE_LENGTH   0xFFFF          // Largest datagram received, in octets.
+#define SOCKET_RECEIVE_BUFFER   (4 << 20)       // Kernel receive buffer, in octets.
+
+/**
+ * @brief Frame to be sent by Socket::send_batch.
+ *
+ */
+typedef struct socket_frame
+{
+    /** Encoded datagram. */
+    const uint8_t *data;
+    /** Datagram length in octets. */
+    size_t length;
+    /** Scatter-gather list of the datagram, used instead of data when set. */
+    const struct iovec *vectors;
+    /** Number of entries of the scatter-gather list. */
+    size_t vectors_count;
+    /** Destination address, in network byte order. */
+    uint32_t destination_address;
+    /** Send result, zero when sent or the errno of the failed send. */
+    int error;
+} socket_frame_t;
+
+/**
+ * @brief Called for every datagram received, with the whole IPv4 datagram
+ * and its kernel receive timestamp in nanoseconds (CLOCK_REALTIME).
+ *
+ */
+typedef std::function<void(const uint8_t *data, size_t length, uint64_t timestamp)> receive_callback_t;
+
+/**
+ * @brief Called once per recvmmsg batch, with frames holding the data and
+ * length of every datagram received. The data lives in the socket receive
+ * buffers: it may be rewritten in place, and sent with send_batch, until the
+ * callback returns.
+ *
+ */
+typedef std::function<void(socket_frame_t *frames, size_t count)> batch_callback_t;
+
+class PcapWriter;
 
 class Socket
 {
@@ -26,9 +75,29 @@ public:
     explicit Socket();
     virtual ~Socket();
 
-    void send_raw(std::vector<uint8_t> raw, uint32_t destination_address);
+    void send_raw(const std::vector<uint8_t> &raw, uint32_t destination_address);
+    void send_raw(const uint8_t *raw, size_t length, uint32_t destination_address);
+    void send_gather(const struct iovec *vectors, size_t count, uint32_t destination_address);
+    size_t send_batch(socket_frame_t *frames, size_t count);
+
+    void enable_receive();
+    void set_receive_filter(const struct sock_filter *program, size_t length);
+    size_t receive(int timeout, const receive_callback_t &callback);
+    size_t receive_batch(int timeout, const batch_callback_t &callback);
+
+    static void set_capture(PcapWriter *writer);
 private:
+    bool wait(int timeout);
+    size_t drain(const receive_callback_t *callback, const batch_callback_t *batch_callback);
+
     int s_file_descriptor;
+    int r_file_descriptor;
+    int e_file_descriptor;
+    uint32_t r_drops;
+    std::unique_ptr<PacketPool> r_pool;
+    uint8_t *r_frames[SOCKET_BATCH_MAX];
+
+    static std::atomic<PcapWriter *> capture;
 };
 
 #endif //__SOCKET_HPP__
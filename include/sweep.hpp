@@ -0,0 +1,255 @@
+/**
+ * @file sweep.hpp
+ * @author Mateus Lima Alves (mateuslima.ti@gmail.com)
+ * @brief Multi-target ECHO (or TIMESTAMP) sweep engine, on the shared probe
+ * window. Targets that time out are probed again up to a number of retries.
+ * Targets are read from a TargetSource one batch at a time, so a sweep of
+ * any number of targets starts at once and only keeps the probes in flight
+ * in memory.
+ * @version 0.1
+ * @date 2022-03-23
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef __SWEEP_HPP__
+#define __SWEEP_HPP__
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+
+#include <probe_engine.hpp>
+#include <probe_template.hpp>
+#include <target_source.hpp>
+#include <icmp.hpp>
+
+/**
+ * @brief Outcome of the probe sent to a target.
+ *
+ */
+typedef enum sweep_status
+{
+    SWEEP_ALIVE = 0,
+    SWEEP_TIMEOUT,
+    SWEEP_SEND_ERROR
+} sweep_status_t;
+
+/**
+ * @brief Result of a probe.
+ *
+ */
+typedef struct sweep_result
+{
+    /** Index of the target, in the order the source gives them. */
+    size_t target;
+    /** Target address, in network byte order. */
+    uint32_t address;
+    /** Probe outcome. */
+    sweep_status_t status;
+    /** Round trip time in nanoseconds, when alive. */
+    uint64_t rtt;
+    /** Number of probes sent again before the outcome. */
+    uint16_t retries;
+    /** Kernel receive timestamp of the reply in nanoseconds, when alive. */
+    uint64_t timestamp;
+    /** Receive and transmit timestamps of a TIMESTAMP_REPLY, milliseconds since midnight UT. */
+    uint32_t receive_timestamp;
+    uint32_t transmit_timestamp;
+} sweep_result_t;
+
+/**
+ * @brief Called once per probe, as soon as its result is known.
+ *
+ */
+typedef std::function<void(const sweep_result_t &result)> sweep_callback_t;
+
+/**
+ * @brief Sweep engine class.
+ *
+ */
+class Sweep : public ProbeEngine
+{
+public:
+    /**
+     * @brief Construct a new Sweep object
+     *
+     * @param socket Socket used to send and receive, receive gets enabled.
+     * @param source_address Source address, in network byte order.
+     * @param in_flight Maximum number of probes waiting for a reply.
+     * @param timeout Time to wait for a reply, in milliseconds.
+     * @param retries Number of times a target is probed again after a timeout.
+     * @param count Number of probes sent to every target.
+     * @param type Probe type, ECHO or TIMESTAMP.
+     */
+    explicit Sweep(Socket &socket, uint32_t source_address, size_t in_flight, int timeout,
+                   uint16_t retries = 0, size_t count = 1, message_type_t type = ECHO);
+
+    /**
+     * @brief Destroy the Sweep object
+     *
+     */
+    virtual ~Sweep();
+
+    /**
+     * @brief Probes every target and reports each probe through the callback.
+     * Every target is probed once before any target is probed again, the
+     * source is rewound for every round.
+     *
+     * @param source Targets, read as the window has room.
+     * @param callback Called once per probe.
+     */
+    void run(TargetSource &source, const sweep_callback_t &callback);
+
+    /**
+     * @brief Get the number of targets of the last run.
+     *
+     * @return size_t
+     */
+    size_t get_targets();
+
+    /**
+     * @brief Get the number of duplicate replies of the last run.
+     *
+     * @return size_t
+     */
+    size_t get_duplicates();
+
+    /**
+     * @brief Get the number of replies received after their probe expired
+     * in the last run.
+     *
+     * @return size_t
+     */
+    size_t get_late();
+
+protected:
+    /**
+     * @brief Whether there are targets left to probe.
+     *
+     * @return true
+     * @return false
+     */
+    bool has_probes() override;
+
+    /**
+     * @brief Get the next probes: retransmits first, then new targets.
+     *
+     * @param probes Next probes.
+     * @param max Largest number of probes wanted.
+     * @return size_t
+     */
+    size_t next_probes(engine_probe_t *probes, size_t max) override;
+
+    /**
+     * @brief Stamps the originate timestamp of a TIMESTAMP batch.
+     *
+     * @param now Current time in nanoseconds.
+     */
+    void prepare_batch(uint64_t now) override;
+
+    /**
+     * @brief Encodes a probe from the template.
+     *
+     * @param probe Probe.
+     * @param sequence_number ICMP sequence number of the probe.
+     * @param buffer Frame.
+     * @return size_t
+     */
+    size_t encode(const engine_probe_t &probe, uint16_t sequence_number, uint8_t *buffer) override;
+
+    /**
+     * @brief Matches a received datagram against the probes in flight.
+     *
+     * @param data Received datagram.
+     * @param length Datagram length in octets.
+     * @param timestamp Receive timestamp in nanoseconds.
+     */
+    void handle_reply(const uint8_t *data, size_t length, uint64_t timestamp) override;
+
+    /**
+     * @brief Handles a probe timeout, scheduling a retransmit while the
+     * target has retries left.
+     *
+     * @param destination_address Target address, in network byte order.
+     * @param record Copy of the probe record.
+     */
+    void handle_timeout(uint32_t destination_address, const probe_record_t &record) override;
+
+    /**
+     * @brief Reports a probe that could not be sent.
+     *
+     * @param probe Probe.
+     */
+    void handle_send_error(const engine_probe_t &probe) override;
+
+private:
+    /**
+     * @brief Reads the next targets to probe from the source, rewinding it
+     * at the end of every round but the last.
+     *
+     * @param probes Next targets.
+     * @param max Largest number of targets wanted.
+     * @return size_t Number of targets, zero once every round was read.
+     */
+    size_t read_targets(engine_probe_t *probes, size_t max);
+
+    /**
+     * @brief Precompiled probe, patched for every target.
+     */
+    std::unique_ptr<ProbeTemplate> probe;
+    /**
+     * @brief Probe type, ECHO or TIMESTAMP.
+     */
+    message_type_t type;
+    /**
+     * @brief Number of times a target is probed again after a timeout.
+     */
+    uint16_t max_retries;
+    /**
+     * @brief Number of probes sent to every target.
+     */
+    size_t count;
+    /**
+     * @brief Targets of the running sweep.
+     */
+    TargetSource *source;
+    /**
+     * @brief Round being read from the source, zero based.
+     */
+    size_t round;
+    /**
+     * @brief Whether every round was read from the source.
+     */
+    bool exhausted;
+    /**
+     * @brief Number of targets of a round.
+     */
+    size_t target_count;
+    /**
+     * @brief Result callback of the running sweep.
+     */
+    const sweep_callback_t *callback;
+    /**
+     * @brief Targets waiting to be probed again, sent before new targets.
+     */
+    std::deque<engine_probe_t> retransmits;
+    /**
+     * @brief Index of the next target read from the source.
+     */
+    size_t next_target;
+    /**
+     * @brief Number of duplicate replies.
+     */
+    size_t duplicates;
+    /**
+     * @brief Number of replies received after their probe expired.
+     */
+    size_t late;
+};
+
+#endif //__SWEEP_HPP__
@@ -0,0 +1,134 @@
+/**
+ * @file target_source.hpp
+ * @author Mateus Lima Alves (mateuslima.ti@gmail.com)
+ * @brief Streaming target source. Targets (addresses or CIDR prefixes) are
+ * parsed from the command line and then from a memory-mapped targets file
+ * only as they are asked for, and prefixes are expanded one address at a
+ * time, so memory and startup time do not depend on the number of targets.
+ * @version 0.1
+ * @date 2022-04-09
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef __TARGET_SOURCE_HPP__
+#define __TARGET_SOURCE_HPP__
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * @brief Longest target entry, "255.255.255.255/32", in octets.
+ *
+ */
+#define TARGET_ENTRY_MAX    18U
+
+/**
+ * @brief Target source class.
+ *
+ */
+class TargetSource
+{
+public:
+    /**
+     * @brief Construct a new Target Source object, mapping the targets file
+     * if there is one. Nothing is parsed yet.
+     *
+     * @param targets Targets given in the command line.
+     * @param targets_count Number of targets given in the command line.
+     * @param path File with one target per line ('#' starts a comment), null for none.
+     */
+    explicit TargetSource(char **targets, int targets_count, const char *path = nullptr);
+
+    /**
+     * @brief Construct a new Target Source object over addresses already
+     * parsed.
+     *
+     * @param addresses Target addresses, in network byte order. Must outlive
+     * the source.
+     */
+    explicit TargetSource(const std::vector<uint32_t> &addresses);
+
+    /**
+     * @brief Destroy the Target Source object
+     *
+     */
+    virtual ~TargetSource();
+
+    /**
+     * @brief Get the next target addresses, in the order they are given.
+     * Prefixes shorter than /31 skip their network and broadcast addresses.
+     *
+     * @param addresses Next addresses, in network byte order.
+     * @param max Largest number of addresses wanted.
+     * @return size_t Number of addresses, zero once every target was read.
+     */
+    size_t next(uint32_t *addresses, size_t max);
+
+    /**
+     * @brief Starts reading the targets again from the first one.
+     *
+     */
+    void rewind();
+
+private:
+    /**
+     * @brief Get the next target entry, with blanks and comments stripped.
+     *
+     * @param entry Entry text, not null terminated.
+     * @param length Entry length in octets.
+     * @return true when there was one, false once every entry was read.
+     */
+    bool next_entry(const char **entry, size_t *length);
+
+    /**
+     * @brief Parses a target entry into the range of addresses to expand.
+     *
+     * @param entry Entry text.
+     * @param length Entry length in octets.
+     */
+    void parse(const char *entry, size_t length);
+
+    /**
+     * @brief Targets given in the command line.
+     */
+    char **targets;
+    /**
+     * @brief Number of targets given in the command line.
+     */
+    int targets_count;
+    /**
+     * @brief Index of the next command line target.
+     */
+    int next_argument;
+    /**
+     * @brief Mapping of the whole targets file, null when there is none.
+     */
+    const char *mapping;
+    /**
+     * @brief Targets file length in octets.
+     */
+    size_t size;
+    /**
+     * @brief Offset of the next targets file line.
+     */
+    size_t offset;
+    /**
+     * @brief Addresses already parsed, null when parsing.
+     */
+    const std::vector<uint32_t> *addresses;
+    /**
+     * @brief Index of the next address already parsed.
+     */
+    size_t next_address;
+    /**
+     * @brief Next and last address of the entry being expanded, in host byte
+     * order. The range is empty when next is past last.
+     */
+    uint64_t range_next;
+    uint64_t range_last;
+};
+
+#endif //__TARGET_SOURCE_HPP__
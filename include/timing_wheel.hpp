@@ -0,0 +1,212 @@
+/**
+ * @file timing_wheel.hpp
+ * @author Mateus Lima Alves (mateuslima.ti@gmail.com)
+ * @brief Hashed hierarchical timing wheel (Varghese & Lauck) for probe
+ * timeouts. Four levels of 256 slots cover 2^32 ticks, timers are kept in a
+ * preallocated pool and linked by index, so scheduling and cancelling are
+ * O(1) and never allocate. Occupied slots are tracked by bitmaps, which lets
+ * the wheel skip idle ticks and tell how long the event loop may sleep.
+ * @version 0.1
+ * @date 2022-03-25
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef __TIMING_WHEEL_HPP__
+#define __TIMING_WHEEL_HPP__
+
+#include <vector>
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+
+#define TIMING_WHEEL_LEVELS     4U
+#define TIMING_WHEEL_BITS       8U
+#define TIMING_WHEEL_SLOTS      (1U << TIMING_WHEEL_BITS)
+#define TIMING_WHEEL_MASK       (TIMING_WHEEL_SLOTS - 1)
+
+/**
+ * @brief Default tick, in nanoseconds (the epoll wait resolution).
+ *
+ */
+#define TIMING_WHEEL_RESOLUTION 1000000ULL
+
+/**
+ * @brief Invalid timer identifier, returned when the pool is exhausted.
+ *
+ */
+#define TIMER_INVALID           UINT32_MAX
+
+/**
+ * @brief Timer identifier.
+ *
+ */
+typedef uint32_t timer_id_t;
+
+/**
+ * @brief Called with the user data of every expired timer.
+ *
+ */
+typedef std::function<void(uint64_t data)> timer_callback_t;
+
+/**
+ * @brief Timing wheel class.
+ *
+ */
+class TimingWheel
+{
+public:
+    /**
+     * @brief Construct a new Timing Wheel object
+     *
+     * @param capacity Maximum number of pending timers.
+     * @param now Current time in nanoseconds, from a clock that never steps
+     * (get_monotonic_timestamp); every time given to the wheel must be too.
+     * @param resolution Tick length in nanoseconds.
+     */
+    explicit TimingWheel(size_t capacity, uint64_t now,
+                         uint64_t resolution = TIMING_WHEEL_RESOLUTION);
+
+    /**
+     * @brief Destroy the Timing Wheel object
+     *
+     */
+    virtual ~TimingWheel();
+
+    /**
+     * @brief Schedules a timer.
+     *
+     * @param deadline Expiry time in nanoseconds, rounded up to a tick.
+     * @param data User data handed to the callback.
+     * @return timer_id_t Timer identifier, TIMER_INVALID when the pool is
+     * exhausted.
+     */
+    timer_id_t schedule(uint64_t deadline, uint64_t data);
+
+    /**
+     * @brief Cancels a pending timer.
+     *
+     * @param timer Timer identifier.
+     */
+    void cancel(timer_id_t timer);
+
+    /**
+     * @brief Expires every timer due until now, in batches per slot.
+     *
+     * @param now Current time in nanoseconds.
+     * @param callback Called for every expired timer.
+     * @return size_t Number of expired timers.
+     */
+    size_t advance(uint64_t now, const timer_callback_t &callback);
+
+    /**
+     * @brief Get the milliseconds the event loop may sleep before the wheel
+     * needs to advance again.
+     *
+     * @param now Current time in nanoseconds.
+     * @return int Timeout in milliseconds, -1 when no timer is pending.
+     */
+    int get_wait_timeout(uint64_t now);
+
+    /**
+     * @brief Get the number of pending timers.
+     *
+     * @return size_t
+     */
+    size_t get_pending();
+
+private:
+    /**
+     * @brief Timer node, linked by pool index.
+     *
+     */
+    typedef struct timer_node
+    {
+        /** Expiry tick. */
+        uint64_t expiry;
+        /** User data. */
+        uint64_t data;
+        /** Previous node of the slot list, or TIMER_INVALID. */
+        timer_id_t previous;
+        /** Next node of the slot or free list, or TIMER_INVALID. */
+        timer_id_t next;
+        /** Slot holding the node (level * TIMING_WHEEL_SLOTS + index). */
+        uint16_t slot;
+        /** The node is scheduled. */
+        bool pending;
+    } timer_node_t;
+
+    /**
+     * @brief Converts a time into a tick, rounding up.
+     *
+     * @param time Time in nanoseconds.
+     * @return uint64_t
+     */
+    uint64_t to_tick(uint64_t time);
+
+    /**
+     * @brief Links a node into the slot matching its expiry.
+     *
+     * @param timer Timer identifier.
+     */
+    void link(timer_id_t timer);
+
+    /**
+     * @brief Unlinks a node from its slot.
+     *
+     * @param timer Timer identifier.
+     */
+    void unlink(timer_id_t timer);
+
+    /**
+     * @brief Moves the timers of a higher level slot to the levels below.
+     *
+     * @param level Level of the slot.
+     * @param index Slot index.
+     */
+    void cascade(unsigned level, unsigned index);
+
+    /**
+     * @brief Finds the first occupied level zero slot in [from, TIMING_WHEEL_SLOTS).
+     *
+     * @param from First slot index.
+     * @return unsigned Slot index, TIMING_WHEEL_SLOTS when none.
+     */
+    unsigned find_slot(unsigned from);
+
+    /**
+     * @brief Timer pool.
+     */
+    std::vector<timer_node_t> nodes;
+    /**
+     * @brief Head of every slot list.
+     */
+    timer_id_t heads[TIMING_WHEEL_LEVELS * TIMING_WHEEL_SLOTS];
+    /**
+     * @brief Occupied slots of every level.
+     */
+    uint64_t bitmaps[TIMING_WHEEL_LEVELS][TIMING_WHEEL_SLOTS / 64];
+    /**
+     * @brief Head of the free node list.
+     */
+    timer_id_t free_list;
+    /**
+     * @brief Time of tick zero, in nanoseconds.
+     */
+    uint64_t origin;
+    /**
+     * @brief Tick length in nanoseconds.
+     */
+    uint64_t resolution;
+    /**
+     * @brief Last processed tick.
+     */
+    uint64_t current;
+    /**
+     * @brief Number of pending timers.
+     */
+    size_t pending;
+};
+
+#endif //__TIMING_WHEEL_HPP__
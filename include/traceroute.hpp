@@ -0,0 +1,260 @@
+/**
+ * @file traceroute.hpp
+ * @author Mateus Lima Alves (mateuslima.ti@gmail.com)
+ * @brief Parallel traceroute engine. Probes every TTL of every target at
+ * once, Paris-traceroute style: the ICMP checksum and identifier of the
+ * probes to a target never change, so per-flow load balancers keep them on
+ * one path. TIME_EXCEEDED replies are matched back to their probe through
+ * the quoted datagram. Targets are read from a TargetSource as the window
+ * has room and each path is reported and freed once every TTL has an
+ * outcome, so memory only depends on the probes in flight. Runs on the
+ * shared probe window.
+ * @version 0.1
+ * @date 2022-04-02
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef __TRACEROUTE_HPP__
+#define __TRACEROUTE_HPP__
+
+#include <vector>
+#include <memory>
+#include <functional>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+
+#include <probe_engine.hpp>
+#include <probe_template.hpp>
+#include <target_source.hpp>
+
+/**
+ * @brief Default and largest number of hops probed per target.
+ *
+ */
+#define TRACEROUTE_MAX_TTL          30U
+#define TRACEROUTE_TTL_LIMIT        255U
+
+/**
+ * @brief Data octets of every probe, rewritten with the complement of the
+ * sequence number so the ICMP checksum stays the same.
+ *
+ */
+#define TRACEROUTE_BALANCE_LENGTH   2U
+
+/**
+ * @brief Outcome of the probe sent to a hop.
+ *
+ */
+typedef enum traceroute_status
+{
+    TRACEROUTE_TIME_EXCEEDED = 0,
+    TRACEROUTE_REACHED,
+    TRACEROUTE_UNREACHABLE,
+    TRACEROUTE_TIMEOUT,
+    TRACEROUTE_SEND_ERROR
+} traceroute_status_t;
+
+/**
+ * @brief Result of a probe.
+ *
+ */
+typedef struct traceroute_hop
+{
+    /** Index of the target. */
+    size_t target;
+    /** Target address, in network byte order. */
+    uint32_t destination_address;
+    /** Time to live of the probe. */
+    uint8_t ttl;
+    /** Address of the node that answered, in network byte order, zero when none did. */
+    uint32_t address;
+    /** Probe outcome. */
+    traceroute_status_t status;
+    /** Round trip time in nanoseconds, when answered. */
+    uint64_t rtt;
+} traceroute_hop_t;
+
+/**
+ * @brief Results of every TTL probed to a target.
+ *
+ */
+typedef struct traceroute_path
+{
+    /** Index of the target, in the order the source gives them. */
+    size_t target;
+    /** Target address, in network byte order. */
+    uint32_t destination_address;
+    /** Result of every TTL, from 1 to max_ttl. */
+    std::vector<traceroute_hop_t> hops;
+    /** Number of TTLs with an outcome. */
+    size_t completed;
+} traceroute_path_t;
+
+/**
+ * @brief Called once per target, as soon as every TTL has an outcome.
+ *
+ */
+typedef std::function<void(const traceroute_path_t &path)> traceroute_callback_t;
+
+/**
+ * @brief Traceroute engine class.
+ *
+ */
+class Traceroute : public ProbeEngine
+{
+public:
+    /**
+     * @brief Construct a new Traceroute object
+     *
+     * @param socket Socket used to send and receive, receive gets enabled.
+     * @param source_address Source address, in network byte order.
+     * @param in_flight Maximum number of probes waiting for a reply.
+     * @param timeout Time to wait for a reply, in milliseconds.
+     * @param max_ttl Number of hops probed per target.
+     */
+    explicit Traceroute(Socket &socket, uint32_t source_address, size_t in_flight, int timeout,
+                        uint8_t max_ttl = TRACEROUTE_MAX_TTL);
+
+    /**
+     * @brief Destroy the Traceroute object
+     *
+     */
+    virtual ~Traceroute();
+
+    /**
+     * @brief Probes TTLs 1 to max_ttl of every target and reports each path
+     * through the callback. All the TTLs of a target are sent together and
+     * the window is shared by the targets.
+     *
+     * @param source Targets, read as the window has room.
+     * @param callback Called once per target.
+     */
+    void run(TargetSource &source, const traceroute_callback_t &callback);
+
+    /**
+     * @brief Get the number of targets of the last run.
+     *
+     * @return size_t
+     */
+    size_t get_targets();
+
+    /**
+     * @brief Get the number of hops probed per target.
+     *
+     * @return uint8_t
+     */
+    uint8_t get_max_ttl();
+
+protected:
+    /**
+     * @brief Whether there are probes left to send.
+     *
+     * @return true
+     * @return false
+     */
+    bool has_probes() override;
+
+    /**
+     * @brief Get the next probes, ordered by target then TTL.
+     *
+     * @param probes Next probes.
+     * @param max Largest number of probes wanted.
+     * @return size_t
+     */
+    size_t next_probes(engine_probe_t *probes, size_t max) override;
+
+    /**
+     * @brief Encodes a probe from the template, keeping its ICMP checksum.
+     *
+     * @param probe Probe.
+     * @param sequence_number ICMP sequence number of the probe.
+     * @param buffer Frame.
+     * @return size_t
+     */
+    size_t encode(const engine_probe_t &probe, uint16_t sequence_number, uint8_t *buffer) override;
+
+    /**
+     * @brief Matches a received datagram against the probes in flight,
+     * either an ECHO_REPLY from the target or an error quoting a probe.
+     *
+     * @param data Received datagram.
+     * @param length Datagram length in octets.
+     * @param timestamp Receive timestamp in nanoseconds.
+     */
+    void handle_reply(const uint8_t *data, size_t length, uint64_t timestamp) override;
+
+    /**
+     * @brief Reports a probe timeout.
+     *
+     * @param destination_address Target address, in network byte order.
+     * @param record Copy of the probe record.
+     */
+    void handle_timeout(uint32_t destination_address, const probe_record_t &record) override;
+
+    /**
+     * @brief Reports a probe that could not be sent.
+     *
+     * @param probe Probe.
+     */
+    void handle_send_error(const engine_probe_t &probe) override;
+
+private:
+    /**
+     * @brief Records a probe result, reporting and freeing the path of its
+     * target once every TTL has an outcome.
+     *
+     * @param probe Index of the probe.
+     * @param address Address of the node that answered, zero for none.
+     * @param status Probe outcome.
+     * @param rtt Round trip time in nanoseconds.
+     */
+    void report(uint64_t probe, uint32_t address, traceroute_status_t status, uint64_t rtt);
+
+    /**
+     * @brief Precompiled probe, patched for every target and TTL.
+     */
+    std::unique_ptr<ProbeTemplate> probe;
+    /**
+     * @brief Offset of the ICMP packet inside the probe.
+     */
+    size_t icmp_offset;
+    /**
+     * @brief Number of hops probed per target.
+     */
+    uint8_t max_ttl;
+    /**
+     * @brief Targets of the running trace.
+     */
+    TargetSource *source;
+    /**
+     * @brief Whether every target was read from the source.
+     */
+    bool exhausted;
+    /**
+     * @brief Number of targets read from the source, the index of the next
+     * one.
+     */
+    size_t target_count;
+    /**
+     * @brief Result callback of the running trace.
+     */
+    const traceroute_callback_t *callback;
+    /**
+     * @brief Address of the target being sent, in network byte order.
+     */
+    uint32_t destination_address;
+    /**
+     * @brief Next TTL of the target being sent, zero based; max_ttl once
+     * all were sent.
+     */
+    uint8_t next_ttl;
+    /**
+     * @brief Paths of the targets with probes in flight, by target index.
+     */
+    std::unordered_map<size_t, traceroute_path_t> paths;
+};
+
+#endif //__TRACEROUTE_HPP__
@@ -13,8 +13,85 @@
 #define __UTILS_HPP__
 
 #include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @brief Application modes, selected by the first command line argument.
+ *
+ */
+typedef enum application_mode
+{
+    MODE_PING = 0,
+    MODE_SWEEP,
+    MODE_TRACEROUTE,
+    MODE_PMTU,
+    MODE_TIMESTAMP,
+    MODE_RESPONDER,
+    MODE_REPLAY,
+    MODE_ANALYZE
+} application_mode_t;
+
+/**
+ * @brief Command line options of the application.
+ *
+ */
+typedef struct application_options
+{
+    /** Application mode. */
+    application_mode_t mode;
+    /** Source address, in network byte order. */
+    uint32_t source_address;
+    /** Destination address, in network byte order. */
+    uint32_t destination_address;
+    /** Number of ECHO probes to send. */
+    size_t count;
+    /** Number of probes handed to the kernel per send call. */
+    size_t batch;
+    /** ECHO payload length in octets, shared by every probe. */
+    size_t size;
+    /** Maximum number of probes waiting for a reply. */
+    size_t in_flight;
+    /** Time to wait for a reply, in milliseconds. */
+    int timeout;
+    /** Number of times a target is probed again after a timeout. */
+    uint16_t retries;
+    /** File with one target (address or CIDR prefix) per line. */
+    const char *targets_file;
+    /** Targets (addresses or CIDR prefixes) given in the command line. */
+    char **targets;
+    /** Number of targets given in the command line. */
+    int targets_count;
+    /** Serve the metrics over HTTP on SERVICE_PORT while running. */
+    bool metrics;
+    /** Offered load in probes per second, zero sends as fast as possible. */
+    size_t rate;
+    /** Print only the summary, not every reply. */
+    bool quiet;
+    /** Number of hops probed per target by traceroute. */
+    uint8_t max_ttl;
+    /** Largest datagram probed by path MTU discovery, in octets. */
+    uint16_t max_mtu;
+    /** Discover the path MTU before pinging and fit the payload in it. */
+    bool pmtu;
+    /** Number of responder or analyzer threads, zero for one per CPU. */
+    size_t threads;
+    /** File every datagram sent and received is captured to, null for none. */
+    const char *pcap_file;
+    /** Capture file read by the replay and analyze modes. */
+    const char *capture_file;
+    /** Replay speed-up factor of the capture time, zero for as fast as possible. */
+    double speed;
+} application_options_t;
 
 void get_application_addresses(int received_addresses_num, char *received_addresses[],
                                uint32_t *source_address, uint32_t *destination_address);
 
+void get_application_options(int argc, char *argv[], application_options_t *options);
+
+uint32_t get_address(const char *address);
+
+uint64_t get_timestamp();
+
+uint64_t get_monotonic_timestamp();
+
 #endif //__UTILS_HPP__
\ No newline at end of file
@@ -0,0 +1,295 @@
+/**
+ * @file analyzer.cpp
+ * @author Mateus Lima Alves (mateuslima.ti@gmail.com)
+ * @brief Offline capture analyzer methods.
+ * @version 0.1
+ * @date 2022-04-08
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include <analyzer.hpp>
+#include <pcap_reader.hpp>
+#include <icmp.hpp>
+#include <ipv4.hpp>
+#include <ipv4_view.hpp>
+#include <icmp_view.hpp>
+#include <utils.hpp>
+#include <exceptions.hpp>
+#include <algorithm>
+#include <thread>
+#include <exception>
+#include <cstring>
+#include <arpa/inet.h>
+
+/**
+ * @brief Construct a new Analyzer:: Analyzer object
+ *
+ * @param path
+ * @param threads
+ */
+Analyzer::Analyzer(const char *path, size_t threads) :
+    path{path}, threads{threads}
+{
+    if (this->threads == 0)
+    {
+        this->threads = std::max(std::thread::hardware_concurrency(), 1U);
+    }
+    memset(&this->summary, 0, sizeof(this->summary));
+}
+
+/**
+ * @brief Destroy the Analyzer:: Analyzer object
+ *
+ */
+Analyzer::~Analyzer()
+{
+}
+
+/**
+ * @brief Splits the capture into one record range per thread, analyzes the
+ * ranges in parallel and merges their results.
+ *
+ */
+void Analyzer::run()
+{
+    std::vector<analyze_chunk_t> chunks;
+    std::vector<std::exception_ptr> errors;
+    std::vector<std::thread> workers;
+    std::vector<size_t> offsets;
+    uint64_t start = get_timestamp();
+
+    {
+        PcapReader reader(this->path);
+        offsets = reader.split(this->threads);
+    }
+
+    chunks = std::vector<analyze_chunk_t>(offsets.size() - 1);
+    errors = std::vector<std::exception_ptr>(chunks.size());
+    for (size_t i = 0; i < chunks.size(); i++)
+    {
+        workers.emplace_back([this, &chunks, &errors, &offsets, i] {
+            try
+            {
+                this->analyze(&chunks[i], offsets[i], offsets[i + 1]);
+            }
+            catch (...)
+            {
+                errors[i] = std::current_exception();
+            }
+        });
+    }
+    for (size_t i = 0; i < workers.size(); i++)
+    {
+        workers[i].join();
+    }
+    for (const std::exception_ptr &error : errors)
+    {
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+    }
+
+    this->merge(chunks);
+    this->summary.chunks = chunks.size();
+    this->summary.duration = get_timestamp() - start;
+}
+
+/**
+ * @brief Get the totals of the analysis.
+ *
+ * @return const analyze_summary_t&
+ */
+const analyze_summary_t &Analyzer::get_summary()
+{
+    return this->summary;
+}
+
+/**
+ * @brief Get the statistics of every target, by address.
+ *
+ * @return const std::vector<analyze_target_t>&
+ */
+const std::vector<analyze_target_t> &Analyzer::get_targets()
+{
+    return this->targets;
+}
+
+/**
+ * @brief Get the round trip time distribution of every pair.
+ *
+ * @return const LatencyHistogram&
+ */
+const LatencyHistogram &Analyzer::get_rtt()
+{
+    return this->rtt;
+}
+
+/**
+ * @brief Analyzes the records in [begin, end), with its own reader. A reply
+ * is paired with the last request of the same exchange key; a request that
+ * replaces an unanswered one leaves the first one lost. Records cut by the
+ * snap length are decoded without checksum verification, as quoted ones.
+ *
+ * @param chunk
+ * @param begin
+ * @param end
+ */
+void Analyzer::analyze(analyze_chunk_t *chunk, size_t begin, size_t end)
+{
+    PcapReader reader(this->path);
+    pcap_packet_t packet;
+
+    memset(&chunk->summary, 0, sizeof(chunk->summary));
+    reader.set_range(begin, end);
+    while (reader.next(&packet))
+    {
+        bool truncated = packet.length < packet.original_length;
+        Ipv4View ipv4;
+        IcmpView icmp;
+        analyze_key_t key;
+
+        chunk->summary.datagrams++;
+        if (!ipv4.parse(packet.data, packet.length, truncated) ||
+            ipv4.get_protocol_number() != ICMP_NUMBER ||
+            !icmp.parse(ipv4.get_data(), ipv4.get_data_length(), truncated))
+        {
+            chunk->summary.skipped++;
+            continue;
+        }
+
+        switch (icmp.get_type())
+        {
+        case ECHO:
+        {
+            analyze_target_t &target = chunk->targets[ipv4.get_destination_address()];
+
+            key = {ipv4.get_source_address(), ipv4.get_destination_address(), icmp.get_identifier(),
+                   icmp.get_sequence_number()};
+            target.address = key.destination_address;
+            target.requests++;
+            chunk->pending[key] = packet.timestamp;
+            chunk->summary.requests++;
+            break;
+        }
+        case ECHO_REPLY:
+        {
+            key = {ipv4.get_destination_address(), ipv4.get_source_address(), icmp.get_identifier(),
+                   icmp.get_sequence_number()};
+            auto request = chunk->pending.find(key);
+            if (request == chunk->pending.end())
+            {
+                chunk->orphans.push_back({key, packet.timestamp});
+                break;
+            }
+            Analyzer::record(&chunk->targets[key.destination_address], &chunk->rtt,
+                             packet.timestamp > request->second ? packet.timestamp - request->second : 0);
+            chunk->pending.erase(request);
+            chunk->summary.replies++;
+            break;
+        }
+        default:
+        {
+            break;
+        }
+        }
+    }
+    chunk->summary.skipped += reader.get_skipped();
+    chunk->summary.truncated = reader.is_truncated();
+}
+
+/**
+ * @brief Records a paired exchange.
+ *
+ * @param target
+ * @param histogram
+ * @param rtt
+ */
+void Analyzer::record(analyze_target_t *target, LatencyHistogram *histogram, uint64_t rtt)
+{
+    if (target->replies == 0 || rtt < target->rtt_min)
+    {
+        target->rtt_min = rtt;
+    }
+    target->rtt_max = std::max(target->rtt_max, rtt);
+    target->rtt_sum += rtt;
+    target->replies++;
+    target->rtt.record(rtt);
+    histogram->record(rtt);
+}
+
+/**
+ * @brief Merges the results of every range, in capture order. The replies a
+ * range could not pair are looked up among the requests still unanswered at
+ * the end of the ranges before it, then its own unanswered requests join
+ * them.
+ *
+ * @param chunks
+ */
+void Analyzer::merge(std::vector<analyze_chunk_t> &chunks)
+{
+    std::unordered_map<uint32_t, analyze_target_t> merged;
+    std::unordered_map<analyze_key_t, uint64_t, analyze_key_hash_t> pending;
+
+    memset(&this->summary, 0, sizeof(this->summary));
+    this->rtt.reset();
+    for (analyze_chunk_t &chunk : chunks)
+    {
+        this->summary.datagrams += chunk.summary.datagrams;
+        this->summary.skipped += chunk.summary.skipped;
+        this->summary.requests += chunk.summary.requests;
+        this->summary.replies += chunk.summary.replies;
+        this->summary.truncated = this->summary.truncated || chunk.summary.truncated;
+        this->rtt.merge(chunk.rtt);
+
+        for (auto &entry : chunk.targets)
+        {
+            analyze_target_t &source = entry.second;
+            analyze_target_t &target = merged[entry.first];
+
+            if (source.replies && (target.replies == 0 || source.rtt_min < target.rtt_min))
+            {
+                target.rtt_min = source.rtt_min;
+            }
+            target.address = entry.first;
+            target.rtt_max = std::max(target.rtt_max, source.rtt_max);
+            target.rtt_sum += source.rtt_sum;
+            target.requests += source.requests;
+            target.replies += source.replies;
+            target.rtt.merge(source.rtt);
+        }
+
+        for (const analyze_orphan_t &orphan : chunk.orphans)
+        {
+            auto request = pending.find(orphan.key);
+
+            if (request == pending.end())
+            {
+                this->summary.unmatched++;
+                continue;
+            }
+            Analyzer::record(&merged[orphan.key.destination_address], &this->rtt,
+                             orphan.timestamp > request->second ? orphan.timestamp - request->second : 0);
+            pending.erase(request);
+            this->summary.replies++;
+        }
+
+        for (const auto &request : chunk.pending)
+        {
+            pending[request.first] = request.second;
+        }
+    }
+
+    this->targets.clear();
+    this->targets.reserve(merged.size());
+    for (auto &entry : merged)
+    {
+        this->targets.push_back(std::move(entry.second));
+    }
+    std::sort(this->targets.begin(), this->targets.end(),
+              [](const analyze_target_t &a, const analyze_target_t &b) {
+                  return ntohl(a.address) < ntohl(b.address);
+              });
+}
@@ -0,0 +1,280 @@
+/**
+ * @file checksum.cpp
+ * @author Mateus Lima Alves (mateuslima.ti@gmail.com)
+ * @brief Internet checksum kernels and runtime dispatch.
+ * @version 0.1
+ * @date 2022-03-20
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include <checksum.hpp>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CHECKSUM_X86
+#endif
+
+/**
+ * @brief Number of vector iterations before the 32 bit lanes are flushed
+ * into the 64 bit accumulator, so they never overflow.
+ *
+ */
+#define CHECKSUM_FLUSH_ITERATIONS   8192U
+
+/**
+ * @brief Kernel signature. Kernels sum the buffer as native-order 16 bit
+ * words, the byte order is fixed once at the end (rfc1071 section 2.B).
+ *
+ */
+typedef uint64_t (*checksum_kernel_t)(const uint8_t *buffer, size_t length);
+
+/**
+ * @brief Portable kernel, sums 32 bit words into a 64 bit accumulator.
+ *
+ * @param buffer
+ * @param length
+ * @return uint64_t Native-order sum.
+ */
+static uint64_t checksum_sum_portable(const uint8_t *buffer, size_t length)
+{
+    uint64_t sum = 0;
+    uint32_t word32;
+    uint16_t word16;
+
+    while (length >= sizeof(word32))
+    {
+        memcpy(&word32, buffer, sizeof(word32));
+        sum += word32;
+        buffer += sizeof(word32);
+        length -= sizeof(word32);
+    }
+    if (length >= sizeof(word16))
+    {
+        memcpy(&word16, buffer, sizeof(word16));
+        sum += word16;
+        buffer += sizeof(word16);
+        length -= sizeof(word16);
+    }
+    if (length)
+    {
+        uint8_t pad[sizeof(word16)] = {*buffer, 0};
+        memcpy(&word16, pad, sizeof(word16));
+        sum += word16;
+    }
+    return sum;
+}
+
+#ifdef CHECKSUM_X86
+/**
+ * @brief SSE2 kernel, widens 16 bit words into four 32 bit lanes.
+ *
+ * @param buffer
+ * @param length
+ * @return uint64_t Native-order sum.
+ */
+__attribute__((target("sse2")))
+static uint64_t checksum_sum_sse2(const uint8_t *buffer, size_t length)
+{
+    const __m128i zero = _mm_setzero_si128();
+    uint64_t sum = 0;
+    uint32_t lanes[4];
+
+    while (length >= sizeof(__m128i))
+    {
+        __m128i accumulator = _mm_setzero_si128();
+        unsigned iterations = 0;
+
+        while (length >= sizeof(__m128i) && iterations++ < CHECKSUM_FLUSH_ITERATIONS)
+        {
+            __m128i data = _mm_loadu_si128((const __m128i *)buffer);
+            accumulator = _mm_add_epi32(accumulator, _mm_unpacklo_epi16(data, zero));
+            accumulator = _mm_add_epi32(accumulator, _mm_unpackhi_epi16(data, zero));
+            buffer += sizeof(__m128i);
+            length -= sizeof(__m128i);
+        }
+        _mm_storeu_si128((__m128i *)lanes, accumulator);
+        sum += (uint64_t)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    }
+    return sum + checksum_sum_portable(buffer, length);
+}
+
+/**
+ * @brief AVX2 kernel, widens 16 bit words into eight 32 bit lanes.
+ *
+ * @param buffer
+ * @param length
+ * @return uint64_t Native-order sum.
+ */
+__attribute__((target("avx2")))
+static uint64_t checksum_sum_avx2(const uint8_t *buffer, size_t length)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    uint64_t sum = 0;
+    uint32_t lanes[8];
+
+    while (length >= sizeof(__m256i))
+    {
+        __m256i accumulator = _mm256_setzero_si256();
+        unsigned iterations = 0;
+
+        while (length >= sizeof(__m256i) && iterations++ < CHECKSUM_FLUSH_ITERATIONS)
+        {
+            __m256i data = _mm256_loadu_si256((const __m256i *)buffer);
+            accumulator = _mm256_add_epi32(accumulator, _mm256_unpacklo_epi16(data, zero));
+            accumulator = _mm256_add_epi32(accumulator, _mm256_unpackhi_epi16(data, zero));
+            buffer += sizeof(__m256i);
+            length -= sizeof(__m256i);
+        }
+        _mm256_storeu_si256((__m256i *)lanes, accumulator);
+        for (unsigned i = 0; i < 8; i++)
+        {
+            sum += lanes[i];
+        }
+    }
+    /* GCC does not always clear the upper halves on return, legacy SSE code
+     * run afterwards would stall on the dirty state. */
+    _mm256_zeroupper();
+    /* Tail handled here with VEX encoded instructions, calling the SSE2
+     * kernel would pay the AVX to SSE transition penalty. */
+    if (length >= sizeof(__m128i))
+    {
+        __m128i data = _mm_loadu_si128((const __m128i *)buffer);
+        __m128i accumulator = _mm_add_epi32(_mm_unpacklo_epi16(data, _mm_setzero_si128()),
+                                            _mm_unpackhi_epi16(data, _mm_setzero_si128()));
+        _mm_storeu_si128((__m128i *)lanes, accumulator);
+        sum += (uint64_t)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+        buffer += sizeof(__m128i);
+        length -= sizeof(__m128i);
+    }
+    return sum + checksum_sum_portable(buffer, length);
+}
+#endif
+
+/**
+ * @brief Selects the fastest kernel supported by the running CPU.
+ *
+ * @param name Selected kernel name.
+ * @return checksum_kernel_t
+ */
+static checksum_kernel_t checksum_select(const char **name)
+{
+#ifdef CHECKSUM_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        *name = "avx2";
+        return checksum_sum_avx2;
+    }
+    if (__builtin_cpu_supports("sse2"))
+    {
+        *name = "sse2";
+        return checksum_sum_sse2;
+    }
+#endif
+    *name = "portable";
+    return checksum_sum_portable;
+}
+
+/**
+ * @brief Name of the selected kernel.
+ *
+ */
+static const char *selected_kernel_name;
+
+/**
+ * @brief Get the selected kernel, resolved once on first use.
+ *
+ * @return checksum_kernel_t
+ */
+static checksum_kernel_t checksum_selected()
+{
+    static const checksum_kernel_t kernel = checksum_select(&selected_kernel_name);
+    return kernel;
+}
+
+/**
+ * @brief Adds the buffer to a partial one's complement sum.
+ *
+ * @param buffer
+ * @param length
+ * @param sum
+ * @return uint32_t
+ */
+uint32_t checksum_partial(const uint8_t *buffer, size_t length, uint32_t sum)
+{
+    uint64_t native = checksum_selected()(buffer, length);
+    uint16_t word;
+    uint8_t bytes[sizeof(word)];
+
+    while (native >> 16)
+    {
+        native = (native & __UINT16_MAX__) + (native >> 16);
+    }
+
+    /* Store the folded native-order word and read it back as big-endian. */
+    word = (uint16_t)native;
+    memcpy(bytes, &word, sizeof(word));
+    word = (uint16_t)((bytes[0] << 8) | bytes[1]);
+
+    sum += word;
+    return (sum & __UINT16_MAX__) + (sum >> 16);
+}
+
+/**
+ * @brief Folds a partial sum into the 16 bit one's complement checksum.
+ *
+ * @param sum
+ * @return uint16_t
+ */
+uint16_t checksum_fold(uint32_t sum)
+{
+    while (sum >> 16)
+    {
+        sum = (sum & __UINT16_MAX__) + (sum >> 16);
+    }
+    return (uint16_t)~sum;
+}
+
+/**
+ * @brief Computes the internet checksum of a buffer.
+ *
+ * @param buffer
+ * @param length
+ * @return uint16_t
+ */
+uint16_t internet_checksum(const uint8_t *buffer, size_t length)
+{
+    return checksum_fold(checksum_partial(buffer, length));
+}
+
+/**
+ * @brief Updates a checksum after one 16 bit word changed (rfc1624), that is
+ * HC' = ~(~HC + ~m + m').
+ *
+ * @param checksum
+ * @param old_word
+ * @param new_word
+ * @return uint16_t
+ */
+uint16_t checksum_adjust(uint16_t checksum, uint16_t old_word, uint16_t new_word)
+{
+    uint32_t sum = (uint16_t)~checksum;
+
+    sum += (uint16_t)~old_word;
+    sum += new_word;
+    return checksum_fold(sum);
+}
+
+/**
+ * @brief Get the name of the summing kernel selected for this CPU.
+ *
+ * @return const char*
+ */
+const char *checksum_kernel()
+{
+    checksum_selected();
+    return selected_kernel_name;
+}
@@ -0,0 +1,158 @@
+/**
+ * @file compact_histogram.cpp
+ * @author Mateus Lima Alves (mateuslima.ti@gmail.com)
+ * @brief Sparse latency histogram class methods.
+ * @version 0.1
+ * @date 2022-04-08
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include <compact_histogram.hpp>
+#include <algorithm>
+
+static_assert(HISTOGRAM_BUCKETS <= COMPACT_HISTOGRAM_BUCKET_MASK + 1,
+              "Bucket index does not fit an entry.");
+
+/**
+ * @brief Construct a new Compact Histogram:: Compact Histogram object
+ *
+ */
+CompactHistogram::CompactHistogram() :
+    count{0}, min{UINT64_MAX}, max{0}
+{
+}
+
+/**
+ * @brief Destroy the Compact Histogram:: Compact Histogram object
+ *
+ */
+CompactHistogram::~CompactHistogram()
+{
+}
+
+/**
+ * @brief Records a value.
+ *
+ * @param value
+ */
+void CompactHistogram::record(uint64_t value)
+{
+    if (value > HISTOGRAM_MAX_VALUE)
+    {
+        value = HISTOGRAM_MAX_VALUE;
+    }
+    this->add(LatencyHistogram::get_bucket_index(value), 1);
+    this->min = std::min(this->min, value);
+    this->max = std::max(this->max, value);
+    this->count++;
+}
+
+/**
+ * @brief Adds the counts of another histogram to this one.
+ *
+ * @param other
+ */
+void CompactHistogram::merge(const CompactHistogram &other)
+{
+    for (uint64_t entry : other.entries)
+    {
+        this->add((size_t)(entry & COMPACT_HISTOGRAM_BUCKET_MASK), entry >> COMPACT_HISTOGRAM_BUCKET_BITS);
+    }
+    this->min = std::min(this->min, other.min);
+    this->max = std::max(this->max, other.max);
+    this->count += other.count;
+}
+
+/**
+ * @brief Get the number of recorded values.
+ *
+ * @return uint64_t
+ */
+uint64_t CompactHistogram::get_count() const
+{
+    return this->count;
+}
+
+/**
+ * @brief Get the smallest recorded value.
+ *
+ * @return uint64_t
+ */
+uint64_t CompactHistogram::get_min() const
+{
+    return this->count ? this->min : 0;
+}
+
+/**
+ * @brief Get the largest recorded value.
+ *
+ * @return uint64_t
+ */
+uint64_t CompactHistogram::get_max() const
+{
+    return this->max;
+}
+
+/**
+ * @brief Get the value at a percentile: the highest value equivalent to the
+ * bucket holding it, at most the largest value recorded.
+ *
+ * @param percentile
+ * @return uint64_t
+ */
+uint64_t CompactHistogram::get_percentile(double percentile) const
+{
+    uint64_t rank, seen = 0;
+
+    if (this->count == 0)
+    {
+        return 0;
+    }
+    if (percentile > 100.0)
+    {
+        percentile = 100.0;
+    }
+
+    rank = (uint64_t)(percentile / 100.0 * this->count + 0.5);
+    if (rank == 0)
+    {
+        rank = 1;
+    }
+
+    for (uint64_t entry : this->entries)
+    {
+        seen += entry >> COMPACT_HISTOGRAM_BUCKET_BITS;
+        if (seen >= rank)
+        {
+            uint64_t value = LatencyHistogram::get_bucket_value(
+                (size_t)(entry & COMPACT_HISTOGRAM_BUCKET_MASK));
+
+            return value < this->max ? value : this->max;
+        }
+    }
+    return this->max;
+}
+
+/**
+ * @brief Adds to the count of a bucket. The entries stay sorted by bucket,
+ * few enough for a binary search and a vector insert to be cheap.
+ *
+ * @param bucket
+ * @param count
+ */
+void CompactHistogram::add(size_t bucket, uint64_t count)
+{
+    auto entry = std::lower_bound(this->entries.begin(), this->entries.end(), (uint64_t)bucket,
+                                  [](uint64_t entry, uint64_t bucket) {
+                                      return (entry & COMPACT_HISTOGRAM_BUCKET_MASK) < bucket;
+                                  });
+
+    if (entry != this->entries.end() && (*entry & COMPACT_HISTOGRAM_BUCKET_MASK) == bucket)
+    {
+        *entry += count << COMPACT_HISTOGRAM_BUCKET_BITS;
+        return;
+    }
+    this->entries.insert(entry, (count << COMPACT_HISTOGRAM_BUCKET_BITS) | bucket);
+}
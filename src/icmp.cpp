@@ -14,7 +14,9 @@
 #include <limits>
 #include <iterator>
 #include <iostream>
+#include <cstring>
 #include <exceptions.hpp>
+#include <checksum.hpp>
 
 /**
  * @brief Construct a new Icmp::Icmp object
@@ -26,7 +28,6 @@
  */
 Icmp::Icmp(message_type_t type, message_code_t code)
 {
-    this->data = std::make_shared<std::vector<uint16_t>>();
     this->set_type(type);
     this->set_code(code);
 }
@@ -66,9 +67,10 @@ message_code_t Icmp::get_code()
  */
 uint16_t Icmp::get_identifier()
 {
-    if (this->type == ECHO_REPLY || this->type == ECHO)
+    if (icmp_has_sequence(this->type))
     {
-        return this->data->at(0);
+        return (uint16_t)(this->fields[ICMP_IDENTIFIER_OFFSET - ICMP_HEADER_LENGTH] << 8 |
+                          this->fields[ICMP_IDENTIFIER_OFFSET - ICMP_HEADER_LENGTH + 1]);
     }
     throw Exception(EXCEPTION_MSG("ICMP - This packet type don't have this attribute."));
 }
@@ -80,9 +82,52 @@ uint16_t Icmp::get_identifier()
  */
 uint16_t Icmp::get_sequence_number()
 {
-    if (this->type == ECHO_REPLY || this->type == ECHO)
+    if (icmp_has_sequence(this->type))
     {
-        return this->data->at(1);
+        return (uint16_t)(this->fields[ICMP_SEQUENCE_OFFSET - ICMP_HEADER_LENGTH] << 8 |
+                          this->fields[ICMP_SEQUENCE_OFFSET - ICMP_HEADER_LENGTH + 1]);
+    }
+    throw Exception(EXCEPTION_MSG("ICMP - This packet type don't have this attribute."));
+}
+
+/**
+ * @brief Get the originate timestamp object
+ *
+ * @return uint32_t
+ */
+uint32_t Icmp::get_originate_timestamp()
+{
+    if (this->type == TIMESTAMP || this->type == TIMESTAMP_REPLY)
+    {
+        return this->read_long(ICMP_ORIGINATE_OFFSET);
+    }
+    throw Exception(EXCEPTION_MSG("ICMP - This packet type don't have this attribute."));
+}
+
+/**
+ * @brief Get the receive timestamp object
+ *
+ * @return uint32_t
+ */
+uint32_t Icmp::get_receive_timestamp()
+{
+    if (this->type == TIMESTAMP || this->type == TIMESTAMP_REPLY)
+    {
+        return this->read_long(ICMP_RECEIVE_OFFSET);
+    }
+    throw Exception(EXCEPTION_MSG("ICMP - This packet type don't have this attribute."));
+}
+
+/**
+ * @brief Get the transmit timestamp object
+ *
+ * @return uint32_t
+ */
+uint32_t Icmp::get_transmit_timestamp()
+{
+    if (this->type == TIMESTAMP || this->type == TIMESTAMP_REPLY)
+    {
+        return this->read_long(ICMP_TRANSMIT_OFFSET);
     }
     throw Exception(EXCEPTION_MSG("ICMP - This packet type don't have this attribute."));
 }
@@ -90,11 +135,11 @@ uint16_t Icmp::get_sequence_number()
 /**
  * @brief Get the data object
  *
- * @return std::vector<uint16_t>
+ * @return byte_span_t
  */
-std::vector<uint16_t> Icmp::get_data()
+byte_span_t Icmp::get_data() const
 {
-    return *this->data.get();
+    return this->data.get_span();
 }
 
 /**
@@ -104,29 +149,14 @@ std::vector<uint16_t> Icmp::get_data()
  */
 void Icmp::set_type(message_type_t type)
 {
-    switch (type)
-    {
-    case ECHO:
+    if (icmp_header_length(type) == 0)
     {
-        this->data.reset(new std::vector<uint16_t>(2, 0));
-        break;
-    }
-    case ECHO_REPLY:
-    case DESTINATION_UNREACHABLE:
-    case SOURCE_QUENCH:
-    case REDIRECT:
-    case TIME_EXCEEDED:
-    case PARAMETER_PROBLEM:
-    case TIMESTAMP:
-    case TIMESTAMP_REPLY:
-    case INFORMATION_REQUEST:
-    case INFORMATION_REPLY:
-    default:
-    {
-        throw Exception(EXCEPTION_MSG("ICMP - Packet type not implemented yet."));
-    }
+        throw Exception(EXCEPTION_MSG("ICMP - Unknown packet type."));
     }
+
     this->type = type;
+    this->code = DEFAULT_CODE;
+    this->reset();
 }
 
 /**
@@ -136,57 +166,11 @@ void Icmp::set_type(message_type_t type)
  */
 void Icmp::set_code(message_code_t code)
 {
-    switch (this->type)
-    {
-    case ECHO_REPLY:
-    case SOURCE_QUENCH:
-    case ECHO:
-    case PARAMETER_PROBLEM:
-    case TIMESTAMP:
-    case TIMESTAMP_REPLY:
-    case INFORMATION_REQUEST:
-    case INFORMATION_REPLY:
-    {
-        if (code != DEFAULT_CODE)
-        {
-            throw Exception(EXCEPTION_MSG("ICMP - This packet type don't have this code."));
-        }
-        break;
-    }
-    case DESTINATION_UNREACHABLE:
-    {
-        if (code != NET_UNREACHABLE && code != HOST_UNREACHABLE &&
-            code != PROTOCOL_UNREACHABLE && code != PORT_UNREACHABLE &&
-            code != FRAGMENTATION_NEEDED && code != SOURCE_ROUTE_FAILED)
-        {
-            throw Exception(EXCEPTION_MSG("ICMP - This packet type don't have this code."));
-        }
-        break;
-    }
-    case REDIRECT:
-    {
-        if (code != REDIRECT_DATAGRAMS_FOR_NET && code != REDIRECT_DATAGRAMS_FOR_HOST &&
-            code != REDIRECT_DATAGRAMS_FOR_TOS_AND_NET && code != REDIRECT_DATAGRAMS_FOR_TOS_AND_HOST)
-        {
-            throw Exception(EXCEPTION_MSG("ICMP - This packet type don't have this code."));
-        }
-        break;
-    }
-    case TIME_EXCEEDED:
-    {
-        if (code != TTL_EXCEEDED && code != FRAGMENT_REASSEMBLY_TIME_EXCEEDED)
-        {
-            throw Exception(EXCEPTION_MSG("ICMP - This packet type don't have this code."));
-        }
-        break;
-    }
-    default:
+    if (!icmp_code_valid(this->type, code))
     {
         throw Exception(EXCEPTION_MSG("ICMP - This packet type don't have this code."));
     }
-    }
     this->code = code;
-    return;
 }
 
 /**
@@ -196,29 +180,12 @@ void Icmp::set_code(message_code_t code)
  */
 void Icmp::set_identifier(uint16_t identifier)
 {
-    switch (this->type)
-    {
-    case ECHO_REPLY:
-    case ECHO:
-    {
-        (*this->data)[0] = identifier;
-        break;
-    }
-    case DESTINATION_UNREACHABLE:
-    case SOURCE_QUENCH:
-    case REDIRECT:
-    case TIME_EXCEEDED:
-    case PARAMETER_PROBLEM:
-    case TIMESTAMP:
-    case TIMESTAMP_REPLY:
-    case INFORMATION_REQUEST:
-    case INFORMATION_REPLY:
-    default:
+    if (!icmp_has_sequence(this->type))
     {
         throw Exception(EXCEPTION_MSG("ICMP - This packet type don't have this attribute."));
     }
-    }
-    return;
+    this->fields[ICMP_IDENTIFIER_OFFSET - ICMP_HEADER_LENGTH] = (uint8_t)(identifier >> 8);
+    this->fields[ICMP_IDENTIFIER_OFFSET - ICMP_HEADER_LENGTH + 1] = (uint8_t)(identifier & __UINT8_MAX__);
 }
 
 /**
@@ -228,60 +195,74 @@ void Icmp::set_identifier(uint16_t identifier)
  */
 void Icmp::set_sequence_number(uint16_t sequence_number)
 {
-    switch (this->type)
-    {
-    case ECHO_REPLY:
-    case ECHO:
+    if (!icmp_has_sequence(this->type))
     {
-        (*this->data)[1] = sequence_number;
-        break;
+        throw Exception(EXCEPTION_MSG("ICMP - This packet type don't have this attribute."));
     }
-    case DESTINATION_UNREACHABLE:
-    case SOURCE_QUENCH:
-    case REDIRECT:
-    case TIME_EXCEEDED:
-    case PARAMETER_PROBLEM:
-    case TIMESTAMP:
-    case TIMESTAMP_REPLY:
-    case INFORMATION_REQUEST:
-    case INFORMATION_REPLY:
-    default:
+    this->fields[ICMP_SEQUENCE_OFFSET - ICMP_HEADER_LENGTH] = (uint8_t)(sequence_number >> 8);
+    this->fields[ICMP_SEQUENCE_OFFSET - ICMP_HEADER_LENGTH + 1] = (uint8_t)(sequence_number & __UINT8_MAX__);
+}
+
+/**
+ * @brief Set the originate, receive and transmit timestamps. A request
+ * carries only the originate one, the reply fills the other two.
+ *
+ * @param originate
+ * @param receive
+ * @param transmit
+ */
+void Icmp::set_timestamps(uint32_t originate, uint32_t receive, uint32_t transmit)
+{
+    if (this->type != TIMESTAMP && this->type != TIMESTAMP_REPLY)
     {
         throw Exception(EXCEPTION_MSG("ICMP - This packet type don't have this attribute."));
     }
-    }
+    this->write_long(ICMP_ORIGINATE_OFFSET, originate);
+    this->write_long(ICMP_RECEIVE_OFFSET, receive);
+    this->write_long(ICMP_TRANSMIT_OFFSET, transmit);
 }
 
 /**
- * @brief Set the data object
+ * @brief Set the data object, replacing the previous one. Fits inline up
+ * to PAYLOAD_BUFFER_INLINE octets, larger data reuses the heap storage of
+ * the largest data set so far.
  *
  * @param data
+ * @param length
  */
-void Icmp::set_data(std::vector<uint16_t> data)
+void Icmp::set_data(const uint8_t *data, size_t length)
 {
-    switch (this->type)
-    {
-    case ECHO_REPLY:
-    case ECHO:
-    {
-        this->data->insert(this->data->end(),
-                           std::make_move_iterator(data.begin()),
-                           std::make_move_iterator(data.end()));
-        break;
-    }
-    case DESTINATION_UNREACHABLE:
-    case SOURCE_QUENCH:
-    case REDIRECT:
-    case TIME_EXCEEDED:
-    case PARAMETER_PROBLEM:
-    case TIMESTAMP:
-    case TIMESTAMP_REPLY:
-    case INFORMATION_REQUEST:
-    case INFORMATION_REPLY:
-    default:
-        break;
-    }
-    return;
+    this->data.assign(data, length);
+}
+
+/**
+ * @brief Set the data object, replacing the previous one.
+ *
+ * @param data
+ */
+void Icmp::set_data(const std::vector<uint8_t> &data)
+{
+    this->data.assign(data.data(), data.size());
+}
+
+/**
+ * @brief Zero the type dependent header fields and drop the data.
+ *
+ */
+void Icmp::reset()
+{
+    memset(this->fields, 0, sizeof(this->fields));
+    this->data.clear();
+}
+
+/**
+ * @brief Get the length of the encoded packet.
+ *
+ * @return size_t
+ */
+size_t Icmp::get_length()
+{
+    return icmp_header_length(this->type) + this->data.size();
 }
 
 /**
@@ -291,21 +272,74 @@ void Icmp::set_data(std::vector<uint16_t> data)
  */
 std::vector<uint8_t> Icmp::encode()
 {
-    std::vector<uint8_t> encoded_data = {};
+    std::vector<uint8_t> encoded_data(this->get_length());
+
+    this->encode_into(encoded_data.data(), encoded_data.size());
+    return encoded_data;
+}
+
+/**
+ * @brief Writes the encoded packet straight into the caller buffer, so the
+ * send path can reuse a preallocated frame for every packet.
+ *
+ * @param buffer Destination buffer.
+ * @param capacity Size of the destination buffer in octets.
+ * @return size_t Number of octets written.
+ */
+size_t Icmp::encode_into(uint8_t *buffer, size_t capacity)
+{
+    size_t length = this->get_length();
+    size_t header_length = icmp_header_length(this->type);
 
-    this->update_checksum();
+    if (capacity < length)
+    {
+        throw Exception(EXCEPTION_MSG("ICMP - Buffer too small to encode packet."));
+    }
 
-    encoded_data.push_back(this->type);
-    encoded_data.push_back(this->code);
-    encoded_data.push_back(this->checksum >> 8);
-    encoded_data.push_back(this->checksum & __UINT8_MAX__);
+    buffer[0] = this->type;
+    buffer[1] = this->code;
+    buffer[2] = 0;
+    buffer[3] = 0;
 
-    for (auto it = this->data->begin(); it != this->data->end(); ++it)
+    memcpy(buffer + ICMP_HEADER_LENGTH, this->fields, header_length - ICMP_HEADER_LENGTH);
+    if (this->data.size())
     {
-        encoded_data.push_back((uint8_t)(*it >> 8));
-        encoded_data.push_back((uint8_t)(*it & __UINT8_MAX__));
+        memcpy(buffer + header_length, this->data.data(), this->data.size());
     }
-    return encoded_data;
+
+    this->update_checksum(buffer, length);
+    buffer[2] = (uint8_t)(this->checksum >> 8);
+    buffer[3] = (uint8_t)(this->checksum & __UINT8_MAX__);
+    return length;
+}
+
+/**
+ * @brief Reads a big-endian 32 bit type dependent header field.
+ *
+ * @param offset
+ * @return uint32_t
+ */
+uint32_t Icmp::read_long(size_t offset)
+{
+    const uint8_t *field = &this->fields[offset - ICMP_HEADER_LENGTH];
+
+    return ((uint32_t)field[0] << 24) | ((uint32_t)field[1] << 16) | ((uint32_t)field[2] << 8) | field[3];
+}
+
+/**
+ * @brief Writes a big-endian 32 bit type dependent header field.
+ *
+ * @param offset
+ * @param value
+ */
+void Icmp::write_long(size_t offset, uint32_t value)
+{
+    uint8_t *field = &this->fields[offset - ICMP_HEADER_LENGTH];
+
+    field[0] = (uint8_t)(value >> 24);
+    field[1] = (uint8_t)(value >> 16);
+    field[2] = (uint8_t)(value >> 8);
+    field[3] = (uint8_t)value;
 }
 
 /**
@@ -314,17 +348,11 @@ std::vector<uint8_t> Icmp::encode()
  * For computing the checksum , the checksum field should be zero.
  * This checksum may be replaced in the future.
  *
+ * @param encoded_data Encoded packet, with the checksum field zeroed.
+ * @param length Encoded packet length in octets.
  */
-void Icmp::update_checksum()
+void Icmp::update_checksum(const uint8_t *encoded_data, size_t length)
 {
-    uint32_t checksum_tmp;
-    checksum_tmp = (this->type << 8) | this->code;
-    for (auto it = this->data->begin(); it != this->data->end(); ++it)
-    {
-        checksum_tmp += *it;
-    }
-    checksum_tmp += (uint16_t)(checksum_tmp >> 16);
-    checksum_tmp = (uint16_t)(__UINT16_MAX__ - (uint16_t)checksum_tmp);
-    this->checksum = (uint16_t)checksum_tmp;
+    this->checksum = internet_checksum(encoded_data, length);
     return;
 }
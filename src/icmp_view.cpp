@@ -0,0 +1,225 @@
+/**
+ * @file icmp_view.cpp
+ * @author Mateus Lima Alves (mateuslima.ti@gmail.com)
+ * @brief ICMP message view class methods.
+ * @version 0.1
+ * @date 2022-03-22
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include <icmp_view.hpp>
+#include <checksum.hpp>
+
+/**
+ * @brief Construct a new Icmp View:: Icmp View object
+ *
+ */
+IcmpView::IcmpView() :
+    buffer{nullptr}, length{0}
+{
+}
+
+/**
+ * @brief Destroy the Icmp View:: Icmp View object
+ *
+ */
+IcmpView::~IcmpView()
+{
+}
+
+/**
+ * @brief Points the view to a message and checks its length and, unless
+ * quoted, its checksum.
+ *
+ * @param buffer
+ * @param length
+ * @param quoted
+ * @return true when the message is valid.
+ */
+bool IcmpView::parse(const uint8_t *buffer, size_t length, bool quoted)
+{
+    this->buffer = nullptr;
+    if (length < ICMP_DATA_OFFSET)
+    {
+        return false;
+    }
+    if (!quoted && internet_checksum(buffer, length) != 0)
+    {
+        return false;
+    }
+    /* Timestamp messages have a longer header, unless quoted the whole of it
+     * must be there. */
+    if (!quoted && (buffer[ICMP_TYPE_OFFSET] == TIMESTAMP || buffer[ICMP_TYPE_OFFSET] == TIMESTAMP_REPLY) &&
+        length < ICMP_TIMESTAMP_LENGTH)
+    {
+        return false;
+    }
+
+    this->buffer = buffer;
+    this->length = length;
+    return true;
+}
+
+/**
+ * @brief Get the type object
+ *
+ * @return message_type_t
+ */
+message_type_t IcmpView::get_type() const
+{
+    return (message_type_t)this->buffer[ICMP_TYPE_OFFSET];
+}
+
+/**
+ * @brief Get the code object
+ *
+ * @return message_code_t
+ */
+message_code_t IcmpView::get_code() const
+{
+    return (message_code_t)this->buffer[ICMP_CODE_OFFSET];
+}
+
+/**
+ * @brief Get the checksum object
+ *
+ * @return uint16_t
+ */
+uint16_t IcmpView::get_checksum() const
+{
+    return this->read_word(ICMP_CHECKSUM_OFFSET);
+}
+
+/**
+ * @brief Get the identifier object
+ *
+ * @return uint16_t
+ */
+uint16_t IcmpView::get_identifier() const
+{
+    return this->read_word(ICMP_IDENTIFIER_OFFSET);
+}
+
+/**
+ * @brief Get the sequence number object
+ *
+ * @return uint16_t
+ */
+uint16_t IcmpView::get_sequence_number() const
+{
+    return this->read_word(ICMP_SEQUENCE_OFFSET);
+}
+
+/**
+ * @brief Get the next-hop MTU object
+ *
+ * @return uint16_t
+ */
+uint16_t IcmpView::get_next_hop_mtu() const
+{
+    return this->read_word(ICMP_NEXT_HOP_MTU_OFFSET);
+}
+
+/**
+ * @brief Get the originate timestamp object
+ *
+ * @return uint32_t
+ */
+uint32_t IcmpView::get_originate_timestamp() const
+{
+    return this->read_long(ICMP_ORIGINATE_OFFSET);
+}
+
+/**
+ * @brief Get the receive timestamp object
+ *
+ * @return uint32_t
+ */
+uint32_t IcmpView::get_receive_timestamp() const
+{
+    return this->read_long(ICMP_RECEIVE_OFFSET);
+}
+
+/**
+ * @brief Get the transmit timestamp object
+ *
+ * @return uint32_t
+ */
+uint32_t IcmpView::get_transmit_timestamp() const
+{
+    return this->read_long(ICMP_TRANSMIT_OFFSET);
+}
+
+/**
+ * @brief Get the message data, after the 8 octets message header.
+ *
+ * @return const uint8_t*
+ */
+const uint8_t *IcmpView::get_data() const
+{
+    return this->buffer + ICMP_DATA_OFFSET;
+}
+
+/**
+ * @brief Get the message data length in octets.
+ *
+ * @return size_t
+ */
+size_t IcmpView::get_data_length() const
+{
+    return this->length - ICMP_DATA_OFFSET;
+}
+
+/**
+ * @brief Checks whether the message is an error message.
+ *
+ * @return true for error messages.
+ */
+bool IcmpView::is_error() const
+{
+    return icmp_is_error(this->get_type());
+}
+
+/**
+ * @brief Points a view to the datagram quoted by an error message.
+ *
+ * @param datagram
+ * @return true when this is an error message quoting a valid datagram.
+ */
+bool IcmpView::get_quoted_datagram(Ipv4View *datagram) const
+{
+    if (!this->is_error())
+    {
+        return false;
+    }
+    return datagram->parse(this->get_data(), this->get_data_length(), true);
+}
+
+/**
+ * @brief Reads a big-endian 16 bit word.
+ *
+ * @param offset
+ * @return uint16_t
+ */
+uint16_t IcmpView::read_word(size_t offset) const
+{
+    return (uint16_t)((this->buffer[offset] << 8) | this->buffer[offset + 1]);
+}
+
+/**
+ * @brief Reads a big-endian 32 bit word. Quoted timestamp messages may stop
+ * after the 8 octets header, so the length is checked.
+ *
+ * @param offset
+ * @return uint32_t
+ */
+uint32_t IcmpView::read_long(size_t offset) const
+{
+    if (offset + sizeof(uint32_t) > this->length)
+    {
+        return 0;
+    }
+    return ((uint32_t)this->read_word(offset) << 16) | this->read_word(offset + 2);
+}
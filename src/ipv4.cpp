@@ -13,7 +13,10 @@
 #include <ipv4.hpp>
 #include <limits>
 #include <iterator>
+#include <cstring>
 #include <inttypes.h>
+#include <exceptions.hpp>
+#include <checksum.hpp>
 
 /**
  * @brief Construct a new Ipv 4:: Ipv 4 object
@@ -25,6 +28,7 @@ Ipv4::Ipv4()
 
     this->ihl = IP_MIN_IHL;
 
+    this->type_of_service = 0;
     this->type_of_service |= (uint8_t)TOS_ROUTINE;
     this->type_of_service &= (uint8_t)~TOS_DELAY;
     this->type_of_service &= (uint8_t)~TOS_THROUGHPUT;
@@ -32,13 +36,23 @@ Ipv4::Ipv4()
 
     this->total_length = IP_MIN_LENGTH;
 
+    this->identification = 0;
+    this->fragment_offset = 0;
+
+    this->flags = 0;
     this->flags |= (uint8_t)FLAG_DF;
     this->flags &= (uint8_t) ~(FLAG_MF);
 
     this->ttl = DEFAULT_TTL;
 
-    this->options = std::shared_ptr<std::vector<uint16_t>>(new std::vector<uint16_t>);
-    this->data = std::shared_ptr<std::vector<uint8_t>>(new std::vector<uint8_t>);
+    this->protocol = 0;
+    this->checksum = 0;
+    this->source_address = 0;
+    this->destination_address = 0;
+
+    /* Allocated on first use, a datagram built over a caller buffer never needs them. */
+    this->options = nullptr;
+    this->data = nullptr;
 }
 
 /**
@@ -59,6 +73,16 @@ uint8_t Ipv4::get_protocol_number()
     return this->protocol;
 }
 
+/**
+ * @brief Get the ttl object
+ *
+ * @return uint8_t
+ */
+uint8_t Ipv4::get_ttl()
+{
+    return this->ttl;
+}
+
 /**
  * @brief Get the source address object
  *
@@ -89,6 +113,20 @@ void Ipv4::set_protocol_number(uint8_t protocol_number)
     this->protocol = protocol_number;
 }
 
+/**
+ * @brief Set the ttl object
+ *
+ * @param ttl
+ */
+void Ipv4::set_ttl(uint8_t ttl)
+{
+    if (ttl == 0)
+    {
+        throw Exception(EXCEPTION_MSG("IPv4 - Time to live must be at least one."));
+    }
+    this->ttl = ttl;
+}
+
 /**
  * @brief Set the source address object
  *
@@ -120,6 +158,16 @@ void Ipv4::set_data(std::vector<uint8_t> data)
     this->total_length = IP_MIN_LENGTH + this->data->size();
 }
 
+/**
+ * @brief Get the internet header length in octets, options included.
+ *
+ * @return size_t
+ */
+size_t Ipv4::get_header_length()
+{
+    return IP_MIN_LENGTH + (this->options ? this->options->size() * sizeof(uint16_t) : 0);
+}
+
 /**
  * @brief
  *
@@ -127,41 +175,133 @@ void Ipv4::set_data(std::vector<uint8_t> data)
  */
 std::vector<uint8_t> Ipv4::encode()
 {
-    std::vector<uint8_t> encoded_data = {};
-    
-    this->update_checksum();
-    
-    encoded_data.push_back((this->version << 4) | this->ihl);
-    encoded_data.push_back(this->type_of_service);
-    encoded_data.push_back((uint8_t)(this->total_length >> 8) & __UINT8_MAX__);
-    encoded_data.push_back((uint8_t)this->total_length & __UINT8_MAX__);
-    encoded_data.push_back((uint8_t)(this->identification >> 8) & __UINT8_MAX__);
-    encoded_data.push_back((uint8_t)this->identification & __UINT8_MAX__);
-    encoded_data.push_back((uint8_t)(this->flags << 5) | ((this->fragment_offset >> 8) & 0x3));
-    encoded_data.push_back((uint8_t)(this->fragment_offset));
-    encoded_data.push_back((uint8_t)this->ttl);
-    encoded_data.push_back((uint8_t)this->protocol);
-    encoded_data.push_back((uint8_t)(this->checksum >> 8));
-    encoded_data.push_back((uint8_t)this->checksum & __UINT8_MAX__);
-    encoded_data.push_back((uint8_t)(this->source_address >> 24));
-    encoded_data.push_back((uint8_t)(this->source_address >> 16));
-    encoded_data.push_back((uint8_t)(this->source_address >> 8));
-    encoded_data.push_back((uint8_t)this->source_address);
-    encoded_data.push_back((uint8_t)(this->destination_address >> 24));
-    encoded_data.push_back((uint8_t)(this->destination_address >> 16));
-    encoded_data.push_back((uint8_t)(this->destination_address >> 8));
-    encoded_data.push_back((uint8_t)this->destination_address);
-
-    for (auto it = this->options->begin(); it != this->options->end(); ++it)
+    std::vector<uint8_t> encoded_data(this->get_header_length() +
+                                      (this->data ? this->data->size() : 0));
+
+    this->encode_into(encoded_data.data(), encoded_data.size());
+    return encoded_data;
+}
+
+/**
+ * @brief Writes the datagram, with the data previously set, into the caller
+ * buffer.
+ *
+ * @param buffer Destination buffer.
+ * @param capacity Size of the destination buffer in octets.
+ * @return size_t Number of octets written.
+ */
+size_t Ipv4::encode_into(uint8_t *buffer, size_t capacity)
+{
+    size_t header_length = this->get_header_length();
+    size_t length = header_length + (this->data ? this->data->size() : 0);
+
+    if (capacity < length)
     {
-        encoded_data.push_back((uint8_t)(*it >> 8));
-        encoded_data.push_back((uint8_t)(*it & __UINT8_MAX__));
+        throw Exception(EXCEPTION_MSG("IPv4 - Buffer too small to encode packet."));
     }
-    for (auto it = this->data->begin(); it != this->data->end(); ++it)
+
+    this->total_length = (uint16_t)length;
+    this->encode_header(buffer);
+    if (this->data && !this->data->empty())
     {
-        encoded_data.push_back(*it);
+        memcpy(buffer + header_length, this->data->data(), this->data->size());
     }
-    return encoded_data;
+    return length;
+}
+
+/**
+ * @brief Writes the datagram carrying the ICMP packet into the caller buffer.
+ * The ICMP packet is encoded in place right after the header, so neither
+ * this object nor the caller ever holds an intermediate copy of it.
+ *
+ * @param buffer Destination buffer.
+ * @param capacity Size of the destination buffer in octets.
+ * @param icmp ICMP packet to be carried as data.
+ * @return size_t Number of octets written.
+ */
+size_t Ipv4::encode_into(uint8_t *buffer, size_t capacity, Icmp &icmp)
+{
+    size_t header_length = this->get_header_length();
+    size_t length;
+
+    if (capacity < header_length)
+    {
+        throw Exception(EXCEPTION_MSG("IPv4 - Buffer too small to encode packet."));
+    }
+
+    length = icmp.encode_into(buffer + header_length, capacity - header_length);
+    return this->encode_header_into(buffer, capacity, length) + length;
+}
+
+/**
+ * @brief Writes the internet header of a datagram carrying data_length
+ * octets.
+ *
+ * @param buffer Destination buffer.
+ * @param capacity Size of the destination buffer in octets.
+ * @param data_length Length of the data carried, in octets.
+ * @return size_t Header length in octets.
+ */
+size_t Ipv4::encode_header_into(uint8_t *buffer, size_t capacity, size_t data_length)
+{
+    size_t header_length = this->get_header_length();
+
+    if (capacity < header_length)
+    {
+        throw Exception(EXCEPTION_MSG("IPv4 - Buffer too small to encode packet."));
+    }
+    if (header_length + data_length > IP_MAX_LENGTH)
+    {
+        throw Exception(EXCEPTION_MSG("IPv4 - Datagram exceeds maximum length."));
+    }
+
+    this->total_length = (uint16_t)(header_length + data_length);
+    this->encode_header(buffer);
+    return header_length;
+}
+
+/**
+ * @brief Writes the internet header (options included) into the buffer.
+ *
+ * @param buffer Destination buffer, at least get_header_length() long.
+ */
+void Ipv4::encode_header(uint8_t *buffer)
+{
+    uint8_t *options_buffer = buffer + IP_MIN_LENGTH;
+
+    buffer[0] = (this->version << 4) | this->ihl;
+    buffer[1] = this->type_of_service;
+    buffer[2] = (uint8_t)(this->total_length >> 8) & __UINT8_MAX__;
+    buffer[3] = (uint8_t)this->total_length & __UINT8_MAX__;
+    buffer[4] = (uint8_t)(this->identification >> 8) & __UINT8_MAX__;
+    buffer[5] = (uint8_t)this->identification & __UINT8_MAX__;
+    buffer[6] = (uint8_t)(this->flags << 5) | ((this->fragment_offset >> 8) & 0x3);
+    buffer[7] = (uint8_t)(this->fragment_offset);
+    buffer[8] = (uint8_t)this->ttl;
+    buffer[9] = (uint8_t)this->protocol;
+    buffer[10] = 0;
+    buffer[11] = 0;
+    buffer[12] = (uint8_t)(this->source_address >> 24);
+    buffer[13] = (uint8_t)(this->source_address >> 16);
+    buffer[14] = (uint8_t)(this->source_address >> 8);
+    buffer[15] = (uint8_t)this->source_address;
+    buffer[16] = (uint8_t)(this->destination_address >> 24);
+    buffer[17] = (uint8_t)(this->destination_address >> 16);
+    buffer[18] = (uint8_t)(this->destination_address >> 8);
+    buffer[19] = (uint8_t)this->destination_address;
+
+    if (this->options)
+    {
+        for (auto it = this->options->begin(); it != this->options->end(); ++it)
+        {
+            *options_buffer++ = (uint8_t)(*it >> 8);
+            *options_buffer++ = (uint8_t)(*it & __UINT8_MAX__);
+        }
+    }
+
+    this->update_checksum(buffer);
+    buffer[10] = (uint8_t)(this->checksum >> 8);
+    buffer[11] = (uint8_t)this->checksum & __UINT8_MAX__;
 }
 
 /**
@@ -169,25 +309,9 @@ std::vector<uint8_t> Ipv4::encode()
  * (e.g., time to live), this is recomputed and verified at each point
  * that the internet header is processed.
  *
+ * @param encoded_header Encoded header, with the checksum field zeroed.
  */
-void Ipv4::update_checksum()
-{
-    uint32_t checksum_tmp;
-    checksum_tmp = ((this->version << 12) | (this->ihl << 8) |
-                   (this->type_of_service));
-    checksum_tmp += this->total_length;
-    checksum_tmp += this->identification;
-    checksum_tmp += (this->flags << 13) | (this->fragment_offset);
-    checksum_tmp += (this->ttl << 8) | (this->protocol);
-    checksum_tmp += ((this->source_address >> 16) & __UINT16_MAX__);
-    checksum_tmp += (this->source_address & __UINT16_MAX__);
-    checksum_tmp += ((this->destination_address >> 16) & __UINT16_MAX__);
-    checksum_tmp += (this->destination_address & __UINT16_MAX__);
-    for (auto it = this->options->begin(); it != this->options->end(); ++it)
-    {
-        checksum_tmp += *it;
-    }
-    checksum_tmp += (uint16_t)(checksum_tmp >> 16);
-    checksum_tmp = (uint16_t)(__UINT16_MAX__ - (uint16_t)checksum_tmp);
-    this->checksum = (uint16_t)checksum_tmp;
-}
\ No newline at end of file
+void Ipv4::update_checksum(const uint8_t *encoded_header)
+{
+    this->checksum = internet_checksum(encoded_header, this->get_header_length());
+}
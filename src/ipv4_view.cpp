@@ -0,0 +1,220 @@
+/**
+ * @file ipv4_view.cpp
+ * @author Mateus Lima Alves (mateuslima.ti@gmail.com)
+ * @brief IPv4 datagram view class methods.
+ * @version 0.1
+ * @date 2022-03-22
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include <ipv4_view.hpp>
+#include <checksum.hpp>
+#include <cstring>
+#include <algorithm>
+
+/**
+ * @brief Construct a new Ipv4 View:: Ipv4 View object
+ *
+ */
+Ipv4View::Ipv4View() :
+    buffer{nullptr}, header_length{0}, data_length{0}
+{
+}
+
+/**
+ * @brief Destroy the Ipv4 View:: Ipv4 View object
+ *
+ */
+Ipv4View::~Ipv4View()
+{
+}
+
+/**
+ * @brief Points the view to a datagram and checks version, lengths and,
+ * unless quoted, the header checksum.
+ *
+ * @param buffer
+ * @param length
+ * @param quoted
+ * @return true when the datagram is valid.
+ */
+bool Ipv4View::parse(const uint8_t *buffer, size_t length, bool quoted)
+{
+    size_t header_length, total_length;
+
+    this->buffer = nullptr;
+    if (length < IP_MIN_LENGTH || (buffer[0] >> 4) != IP_VERSION)
+    {
+        return false;
+    }
+
+    header_length = (buffer[0] & 0x0F) * sizeof(uint32_t);
+    total_length = (buffer[IP_TOTAL_LENGTH_OFFSET] << 8) | buffer[IP_TOTAL_LENGTH_OFFSET + 1];
+    if (header_length < IP_MIN_LENGTH || header_length > length || total_length < header_length)
+    {
+        return false;
+    }
+
+    if (quoted)
+    {
+        total_length = std::min(total_length, length);
+    }
+    else if (total_length > length || internet_checksum(buffer, header_length) != 0)
+    {
+        return false;
+    }
+
+    this->buffer = buffer;
+    this->header_length = header_length;
+    this->data_length = total_length - header_length;
+    return true;
+}
+
+/**
+ * @brief Get the internet header length in octets, options included.
+ *
+ * @return size_t
+ */
+size_t Ipv4View::get_header_length() const
+{
+    return this->header_length;
+}
+
+/**
+ * @brief Get the type of service object
+ *
+ * @return uint8_t
+ */
+uint8_t Ipv4View::get_type_of_service() const
+{
+    return this->buffer[1];
+}
+
+/**
+ * @brief Get the total length object
+ *
+ * @return uint16_t
+ */
+uint16_t Ipv4View::get_total_length() const
+{
+    return this->read_word(IP_TOTAL_LENGTH_OFFSET);
+}
+
+/**
+ * @brief Get the identification object
+ *
+ * @return uint16_t
+ */
+uint16_t Ipv4View::get_identification() const
+{
+    return this->read_word(IP_IDENTIFICATION_OFFSET);
+}
+
+/**
+ * @brief Get the flags object
+ *
+ * @return uint8_t
+ */
+uint8_t Ipv4View::get_flags() const
+{
+    return this->buffer[IP_IDENTIFICATION_OFFSET + 2] >> 5;
+}
+
+/**
+ * @brief Get the fragment offset object
+ *
+ * @return uint16_t
+ */
+uint16_t Ipv4View::get_fragment_offset() const
+{
+    return this->read_word(IP_IDENTIFICATION_OFFSET + 2) & 0x1FFF;
+}
+
+/**
+ * @brief Get the ttl object
+ *
+ * @return uint8_t
+ */
+uint8_t Ipv4View::get_ttl() const
+{
+    return this->buffer[IP_TTL_OFFSET];
+}
+
+/**
+ * @brief Get the protocol number object
+ *
+ * @return uint8_t
+ */
+uint8_t Ipv4View::get_protocol_number() const
+{
+    return this->buffer[IP_PROTOCOL_OFFSET];
+}
+
+/**
+ * @brief Get the checksum object
+ *
+ * @return uint16_t
+ */
+uint16_t Ipv4View::get_checksum() const
+{
+    return this->read_word(IP_CHECKSUM_OFFSET);
+}
+
+/**
+ * @brief Get the source address object
+ *
+ * @return uint32_t
+ */
+uint32_t Ipv4View::get_source_address() const
+{
+    uint32_t address;
+
+    memcpy(&address, &this->buffer[IP_SOURCE_OFFSET], sizeof(address));
+    return address;
+}
+
+/**
+ * @brief Get the destination address object
+ *
+ * @return uint32_t
+ */
+uint32_t Ipv4View::get_destination_address() const
+{
+    uint32_t address;
+
+    memcpy(&address, &this->buffer[IP_DESTINATION_OFFSET], sizeof(address));
+    return address;
+}
+
+/**
+ * @brief Get the datagram data, after the internet header.
+ *
+ * @return const uint8_t*
+ */
+const uint8_t *Ipv4View::get_data() const
+{
+    return this->buffer + this->header_length;
+}
+
+/**
+ * @brief Get the datagram data length in octets.
+ *
+ * @return size_t
+ */
+size_t Ipv4View::get_data_length() const
+{
+    return this->data_length;
+}
+
+/**
+ * @brief Reads a big-endian 16 bit word.
+ *
+ * @param offset
+ * @return uint16_t
+ */
+uint16_t Ipv4View::read_word(size_t offset) const
+{
+    return (uint16_t)((this->buffer[offset] << 8) | this->buffer[offset + 1]);
+}
@@ -0,0 +1,288 @@
+/**
+ * @file latency_histogram.cpp
+ * @author Mateus Lima Alves (mateuslima.ti@gmail.com)
+ * @brief Fixed-memory latency histogram class methods.
+ * @version 0.1
+ * @date 2022-03-26
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include <latency_histogram.hpp>
+
+/**
+ * @brief Construct a new Latency Histogram:: Latency Histogram object
+ *
+ */
+LatencyHistogram::LatencyHistogram()
+{
+    this->reset();
+}
+
+/**
+ * @brief Destroy the Latency Histogram:: Latency Histogram object
+ *
+ */
+LatencyHistogram::~LatencyHistogram()
+{
+}
+
+/**
+ * @brief Records a value.
+ *
+ * @param value
+ */
+void LatencyHistogram::record(uint64_t value)
+{
+    uint64_t current;
+
+    if (value > HISTOGRAM_MAX_VALUE)
+    {
+        value = HISTOGRAM_MAX_VALUE;
+    }
+
+    this->counts[get_bucket_index(value)].fetch_add(1, std::memory_order_relaxed);
+    this->sum.fetch_add(value, std::memory_order_relaxed);
+
+    current = this->min.load(std::memory_order_relaxed);
+    while (value < current &&
+           !this->min.compare_exchange_weak(current, value, std::memory_order_relaxed))
+    {
+    }
+    current = this->max.load(std::memory_order_relaxed);
+    while (value > current &&
+           !this->max.compare_exchange_weak(current, value, std::memory_order_relaxed))
+    {
+    }
+
+    /* Published last, so readers never see more values than counted. */
+    this->count.fetch_add(1, std::memory_order_release);
+}
+
+/**
+ * @brief Adds the counts of another histogram to this one.
+ *
+ * @param other
+ */
+void LatencyHistogram::merge(const LatencyHistogram &other)
+{
+    uint64_t value, current;
+
+    if (other.count.load(std::memory_order_acquire) == 0)
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < HISTOGRAM_BUCKETS; i++)
+    {
+        value = other.counts[i].load(std::memory_order_relaxed);
+        if (value)
+        {
+            this->counts[i].fetch_add(value, std::memory_order_relaxed);
+        }
+    }
+    this->sum.fetch_add(other.sum.load(std::memory_order_relaxed), std::memory_order_relaxed);
+
+    value = other.min.load(std::memory_order_relaxed);
+    current = this->min.load(std::memory_order_relaxed);
+    while (value < current &&
+           !this->min.compare_exchange_weak(current, value, std::memory_order_relaxed))
+    {
+    }
+    value = other.max.load(std::memory_order_relaxed);
+    current = this->max.load(std::memory_order_relaxed);
+    while (value > current &&
+           !this->max.compare_exchange_weak(current, value, std::memory_order_relaxed))
+    {
+    }
+
+    this->count.fetch_add(other.count.load(std::memory_order_relaxed), std::memory_order_release);
+}
+
+/**
+ * @brief Copies this histogram. The count is read first, so the copy never
+ * claims more values than its buckets hold.
+ *
+ * @param snapshot
+ */
+void LatencyHistogram::snapshot(LatencyHistogram *snapshot) const
+{
+    snapshot->count.store(this->count.load(std::memory_order_acquire), std::memory_order_relaxed);
+    for (size_t i = 0; i < HISTOGRAM_BUCKETS; i++)
+    {
+        snapshot->counts[i].store(this->counts[i].load(std::memory_order_relaxed),
+                                  std::memory_order_relaxed);
+    }
+    snapshot->sum.store(this->sum.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    snapshot->min.store(this->min.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    snapshot->max.store(this->max.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+/**
+ * @brief Forgets every recorded value. Not meant to race with record.
+ *
+ */
+void LatencyHistogram::reset()
+{
+    for (size_t i = 0; i < HISTOGRAM_BUCKETS; i++)
+    {
+        this->counts[i].store(0, std::memory_order_relaxed);
+    }
+    this->count.store(0, std::memory_order_relaxed);
+    this->sum.store(0, std::memory_order_relaxed);
+    this->min.store(UINT64_MAX, std::memory_order_relaxed);
+    this->max.store(0, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Get the number of recorded values.
+ *
+ * @return uint64_t
+ */
+uint64_t LatencyHistogram::get_count() const
+{
+    return this->count.load(std::memory_order_acquire);
+}
+
+/**
+ * @brief Get the smallest recorded value.
+ *
+ * @return uint64_t
+ */
+uint64_t LatencyHistogram::get_min() const
+{
+    return this->get_count() ? this->min.load(std::memory_order_relaxed) : 0;
+}
+
+/**
+ * @brief Get the largest recorded value.
+ *
+ * @return uint64_t
+ */
+uint64_t LatencyHistogram::get_max() const
+{
+    return this->max.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Get the mean of the recorded values.
+ *
+ * @return double
+ */
+double LatencyHistogram::get_mean() const
+{
+    uint64_t count = this->get_count();
+
+    return count ? (double)this->sum.load(std::memory_order_relaxed) / count : 0.0;
+}
+
+/**
+ * @brief Get the value at a percentile.
+ *
+ * @param percentile
+ * @return uint64_t
+ */
+uint64_t LatencyHistogram::get_percentile(double percentile) const
+{
+    uint64_t count = this->get_count(), rank, seen = 0;
+
+    if (count == 0)
+    {
+        return 0;
+    }
+    if (percentile > 100.0)
+    {
+        percentile = 100.0;
+    }
+
+    rank = (uint64_t)(percentile / 100.0 * count + 0.5);
+    if (rank == 0)
+    {
+        rank = 1;
+    }
+
+    for (size_t i = 0; i < HISTOGRAM_BUCKETS; i++)
+    {
+        seen += this->counts[i].load(std::memory_order_relaxed);
+        if (seen >= rank)
+        {
+            uint64_t value = get_bucket_value(i);
+            return value < this->get_max() ? value : this->get_max();
+        }
+    }
+    return this->get_max();
+}
+
+/**
+ * @brief Get the number of buckets.
+ *
+ * @return size_t
+ */
+size_t LatencyHistogram::get_bucket_count()
+{
+    return HISTOGRAM_BUCKETS;
+}
+
+/**
+ * @brief Get the count of a bucket.
+ *
+ * @param bucket
+ * @return uint64_t
+ */
+uint64_t LatencyHistogram::get_bucket(size_t bucket) const
+{
+    return this->counts[bucket].load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Get the highest value counted by a bucket. Buckets below
+ * HISTOGRAM_SUB_BUCKETS are exact, the following ones count groups of
+ * HISTOGRAM_SUB_BUCKETS / 2 buckets per power of two.
+ *
+ * @param bucket
+ * @return uint64_t
+ */
+uint64_t LatencyHistogram::get_bucket_value(size_t bucket)
+{
+    const size_t half = HISTOGRAM_SUB_BUCKETS / 2;
+    size_t shift;
+
+    if (bucket < HISTOGRAM_SUB_BUCKETS)
+    {
+        return bucket;
+    }
+    shift = bucket / half - 1;
+    return (((uint64_t)(bucket % half + half) + 1) << shift) - 1;
+}
+
+/**
+ * @brief Get the sum of the recorded values.
+ *
+ * @return uint64_t
+ */
+uint64_t LatencyHistogram::get_sum() const
+{
+    return this->sum.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Get the bucket counting a value: the value keeps its
+ * HISTOGRAM_SUB_BUCKET_BITS most significant bits.
+ *
+ * @param value
+ * @return size_t
+ */
+size_t LatencyHistogram::get_bucket_index(uint64_t value)
+{
+    const size_t half = HISTOGRAM_SUB_BUCKETS / 2;
+    unsigned exponent, shift;
+
+    if (value < HISTOGRAM_SUB_BUCKETS)
+    {
+        return (size_t)value;
+    }
+    exponent = 63U - (unsigned)__builtin_clzll(value);
+    shift = exponent - HISTOGRAM_SUB_BUCKET_BITS + 1;
+    return (shift + 1) * half + (size_t)((value >> shift) - half);
+}
@@ -13,11 +13,836 @@
 #include <iostream>
 #include <main.hpp>
 #include <icmp.hpp>
+#include <icmp_message.hpp>
 #include <ipv4.hpp>
 #include <socket.hpp>
+#include <probe_template.hpp>
+#include <ipv4_view.hpp>
+#include <icmp_view.hpp>
+#include <sweep.hpp>
+#include <traceroute.hpp>
+#include <pmtu.hpp>
+#include <responder.hpp>
+#include <pcap_writer.hpp>
+#include <pcap_reader.hpp>
+#include <replay.hpp>
+#include <analyzer.hpp>
+#include <target_source.hpp>
+#include <packet_pool.hpp>
+#include <latency_histogram.hpp>
+#include <compact_histogram.hpp>
+#include <metrics.hpp>
+#include <metrics_server.hpp>
 #include <utils.hpp>
 #include <memory>
+#include <vector>
+#include <algorithm>
+#include <cstring>
 #include <arpa/inet.h>
+#include <unistd.h>
+#include <signal.h>
+#include <time.h>
+
+/**
+ * @brief Sequence numbers tracked for round trip time, one per possible
+ * sequence number.
+ *
+ */
+#define SEQUENCE_SPACE  (UINT16_MAX + 1)
+
+/**
+ * @brief Interval between two responder rate reports, in milliseconds.
+ *
+ */
+#define RESPONDER_REPORT_INTERVAL   1000
+
+/**
+ * @brief Set by SIGINT or SIGTERM, stops the responder.
+ *
+ */
+static volatile sig_atomic_t interrupted = 0;
+
+/**
+ * @brief ECHO replies of a target probed more than once, round trip times
+ * in nanoseconds. The sparse histogram keeps a few tens of octets per
+ * target, so a sweep of millions of targets can afford one each.
+ *
+ */
+typedef struct sweep_target
+{
+    uint32_t address;
+    CompactHistogram rtt;
+} sweep_target_t;
+
+/**
+ * @brief Clock offset and one-way delays of the TIMESTAMP replies of a
+ * target, in milliseconds. The offset is the target clock minus the local
+ * one; the sample with the lowest delay is the least disturbed by queueing.
+ *
+ */
+typedef struct timestamp_stats
+{
+    size_t replies;
+    size_t nonstandard;
+    double offset_sum;
+    double offset;
+    double forward;
+    double backward;
+    double delay;
+} timestamp_stats_t;
+
+/**
+ * @brief Get a time as milliseconds since midnight UT, keeping the
+ * sub-millisecond part.
+ *
+ * @param timestamp Time in nanoseconds since the epoch.
+ * @return double
+ */
+static double get_day_milliseconds(uint64_t timestamp)
+{
+    return (double)(timestamp % (ICMP_DAY_MILLISECONDS * 1000000ULL)) / 1000000.0;
+}
+
+/**
+ * @brief Get the difference between two times of the day, across midnight.
+ *
+ * @param later Milliseconds since midnight UT.
+ * @param earlier Milliseconds since midnight UT.
+ * @return double Difference in (-12 h, 12 h], in milliseconds.
+ */
+static double get_day_difference(double later, double earlier)
+{
+    double difference = later - earlier;
+
+    if (difference > ICMP_DAY_MILLISECONDS / 2)
+    {
+        difference -= ICMP_DAY_MILLISECONDS;
+    }
+    else if (difference <= -(double)(ICMP_DAY_MILLISECONDS / 2))
+    {
+        difference += ICMP_DAY_MILLISECONDS;
+    }
+    return difference;
+}
+
+/**
+ * @brief Prints the round trip time statistics of a histogram.
+ *
+ * @param histogram Round trip times in nanoseconds.
+ */
+static void print_latency(const LatencyHistogram &histogram)
+{
+    if (histogram.get_count() == 0)
+    {
+        return;
+    }
+
+    std::cout << "rtt min/avg/max = " << (double)histogram.get_min() / 1000000.0 << "/"
+              << histogram.get_mean() / 1000000.0 << "/"
+              << (double)histogram.get_max() / 1000000.0 << " ms, p50/p99/p999 = "
+              << (double)histogram.get_percentile(50.0) / 1000000.0 << "/"
+              << (double)histogram.get_percentile(99.0) / 1000000.0 << "/"
+              << (double)histogram.get_percentile(99.9) / 1000000.0 << " ms" << std::endl;
+}
+
+/**
+ * @brief Checks whether the datagram is an ECHO_REPLY to one of our probes
+ * and prints its round trip time.
+ *
+ * @param data Received IPv4 datagram.
+ * @param length Datagram length in octets.
+ * @param timestamp Receive timestamp in nanoseconds.
+ * @param options Application options.
+ * @param identifier Identifier of our probes.
+ * @param sent_timestamps Send timestamp of every sequence number, zero when not
+ * sent or already answered.
+ * @param histogram Round trip times in nanoseconds.
+ * @return true when the datagram answers one of our probes.
+ */
+static bool handle_reply(const uint8_t *data, size_t length, uint64_t timestamp,
+                         const application_options_t &options, uint16_t identifier,
+                         std::vector<uint64_t> &sent_timestamps, LatencyHistogram &histogram)
+{
+    uint64_t rtt;
+    Ipv4View ipv4;
+    IcmpView icmp;
+    uint32_t source_address;
+    uint16_t sequence;
+    char address[INET_ADDRSTRLEN];
+
+    if (!ipv4.parse(data, length) || ipv4.get_protocol_number() != ICMP_NUMBER ||
+        !icmp.parse(ipv4.get_data(), ipv4.get_data_length()))
+    {
+        return false;
+    }
+
+    source_address = ipv4.get_source_address();
+    if (source_address != options.destination_address || icmp.get_type() != ECHO_REPLY ||
+        icmp.get_identifier() != identifier)
+    {
+        return false;
+    }
+
+    sequence = icmp.get_sequence_number();
+    if (sent_timestamps[sequence] == 0)
+    {
+        return false;
+    }
+
+    rtt = timestamp > sent_timestamps[sequence] ? timestamp - sent_timestamps[sequence] : 0;
+    histogram.record(rtt);
+    Metrics::add(Metrics::get_counters().replies);
+    Metrics::get_rtt().record(rtt);
+
+    sent_timestamps[sequence] = 0;
+    if (options.quiet)
+    {
+        return true;
+    }
+
+    inet_ntop(AF_INET, &source_address, address, sizeof(address));
+    std::cout << ipv4.get_data_length() << " bytes from " << address
+              << ": icmp_seq=" << sequence << " ttl=" << (unsigned)ipv4.get_ttl()
+              << " time=" << (double)rtt / 1000000.0 << " ms" << std::endl;
+    return true;
+}
+
+/**
+ * @brief Discovers the path MTU to the destination and shrinks the payload
+ * so the probes get through without being fragmented or dropped.
+ *
+ * @param socket Socket used for the discovery.
+ * @param options Application options.
+ * @return size_t Payload length in octets.
+ */
+static size_t fit_path_mtu(Socket &socket, const application_options_t &options)
+{
+    size_t headers = IP_MIN_LENGTH + ICMP_MESSAGE_LENGTH;
+    std::vector<uint32_t> targets = {options.destination_address};
+    TargetSource source(targets);
+    PmtuCache cache;
+    uint16_t mtu;
+    char address[INET_ADDRSTRLEN];
+
+    {
+        Pmtu pmtu(socket, options.source_address, PMTU_PROBES, options.timeout,
+                  (uint16_t)std::min(std::max(options.size + headers, (size_t)PMTU_MIN),
+                                     (size_t)IP_MAX_LENGTH),
+                  &cache);
+        pmtu.run(source, [](const pmtu_result_t &) {});
+    }
+
+    mtu = cache.get(options.destination_address, get_timestamp());
+    if (mtu == 0 || options.size + headers <= mtu)
+    {
+        return options.size;
+    }
+
+    inet_ntop(AF_INET, &options.destination_address, address, sizeof(address));
+    std::cout << "path MTU to " << address << " is " << mtu << ", payload fitted to "
+              << mtu - headers << " octets" << std::endl;
+    return mtu - headers;
+}
+
+/**
+ * @brief Sends ECHO probes to a single destination and prints the replies.
+ *
+ * @param options Application options.
+ * @return int
+ */
+static int run_ping(const application_options_t &options)
+{
+    std::unique_ptr<IcmpMessage<ECHO>> icmp = std::make_unique<IcmpMessage<ECHO>>();
+    std::unique_ptr<Ipv4> ipv4 = std::make_unique<Ipv4>();
+    std::unique_ptr<Socket> socket = std::make_unique<Socket>();
+    uint16_t identifier = (uint16_t)getpid();
+    size_t size = options.size;
+
+    if (options.pmtu)
+    {
+        size = fit_path_mtu(*socket, options);
+    }
+
+    ipv4->set_protocol_number(ICMP_NUMBER);
+    ipv4->set_source_address(options.source_address);
+    ipv4->set_destination_address(options.destination_address);
+    icmp->set_identifier(identifier);
+
+    ProbeTemplate probe(*ipv4, *icmp);
+
+    /* Shared by every probe, only the headers are written per probe. */
+    std::vector<uint8_t> payload(size);
+    for (size_t i = 0; i < payload.size(); i++)
+    {
+        payload[i] = (uint8_t)i;
+    }
+    probe.set_payload(payload.data(), payload.size());
+
+    PacketPool pool(probe.get_header_length(), options.batch);
+    std::vector<struct iovec> vectors(options.batch * PROBE_VECTORS_MAX);
+    std::vector<socket_frame_t> frames(options.batch);
+    std::vector<uint64_t> sent_timestamps(SEQUENCE_SPACE, 0);
+    LatencyHistogram histogram;
+    metrics_counters_t &counters = Metrics::get_counters();
+    size_t failed = 0, received = 0;
+    uint64_t drops = counters.drops.load(std::memory_order_relaxed), start, elapsed;
+
+    receive_callback_t callback = [&](const uint8_t *data, size_t length, uint64_t timestamp) {
+        if (handle_reply(data, length, timestamp, options, identifier, sent_timestamps, histogram))
+        {
+            received++;
+        }
+    };
+
+    socket->enable_receive();
+
+    start = get_timestamp();
+    for (size_t sequence = 0; sequence < options.count;)
+    {
+        size_t length = std::min(options.batch, options.count - sequence);
+
+        /* Paced at the offered rate: batch N leaves at start + N * batch / rate. */
+        if (options.rate)
+        {
+            uint64_t next = start + (uint64_t)((double)sequence * 1e9 / options.rate);
+            for (uint64_t now = get_timestamp(); now < next; now = get_timestamp())
+            {
+                socket->receive((int)((next - now) / 1000000ULL), callback);
+            }
+        }
+
+        for (size_t i = 0; i < length; i++, sequence++)
+        {
+            struct iovec *frame_vectors = &vectors[i * PROBE_VECTORS_MAX];
+            size_t count;
+
+            /* The sequence number wraps past SEQUENCE_SPACE probes: a probe
+             * still unanswered keeps its slot until it times out, so its
+             * reply is never matched with the probe that reuses it. */
+            while (sent_timestamps[(uint16_t)sequence] != 0)
+            {
+                uint64_t expiry = sent_timestamps[(uint16_t)sequence] + options.timeout * 1000000ULL;
+                uint64_t now = get_timestamp();
+
+                if (now >= expiry)
+                {
+                    sent_timestamps[(uint16_t)sequence] = 0;
+                    break;
+                }
+                socket->receive((int)((expiry - now + 999999ULL) / 1000000ULL), callback);
+            }
+
+            probe.set_sequence_number((uint16_t)sequence);
+            sent_timestamps[(uint16_t)sequence] = get_timestamp();
+            count = probe.get_vectors(frame_vectors);
+            if (options.batch == 1)
+            {
+                /* Counted as a send error like in a batch, the run goes on. */
+                try
+                {
+                    socket->send_gather(frame_vectors, count, options.destination_address);
+                }
+                catch (const std::exception &)
+                {
+                    sent_timestamps[(uint16_t)sequence] = 0;
+                    failed++;
+                }
+                continue;
+            }
+            frame_vectors[0].iov_base = pool.acquire();
+            memcpy(frame_vectors[0].iov_base, probe.data(), probe.get_header_length());
+            frames[i].vectors = frame_vectors;
+            frames[i].vectors_count = count;
+            frames[i].destination_address = options.destination_address;
+        }
+        Metrics::add(counters.encoded, length);
+        if (options.batch > 1)
+        {
+            failed += length - socket->send_batch(frames.data(), length);
+            for (size_t i = 0; i < length; i++)
+            {
+                pool.release((uint8_t *)frames[i].vectors[0].iov_base);
+                if (frames[i].error)
+                {
+                    sent_timestamps[(uint16_t)(sequence - length + i)] = 0;
+                }
+            }
+        }
+        socket->receive(0, callback);
+    }
+    elapsed = get_timestamp() - start;
+
+    uint64_t deadline = get_timestamp() + options.timeout * 1000000ULL;
+    for (uint64_t now = get_timestamp(); received < options.count - failed && now < deadline;
+         now = get_timestamp())
+    {
+        socket->receive((int)((deadline - now + 999999ULL) / 1000000ULL), callback);
+    }
+
+    Metrics::add(counters.timeouts, options.count - failed - received);
+
+    std::cout << options.count << " packets transmitted, " << received << " received, "
+              << failed << " send errors, "
+              << counters.drops.load(std::memory_order_relaxed) - drops << " kernel drops, "
+              << 100.0 * (options.count - received) / options.count << "% loss, sent in "
+              << (double)elapsed / 1000000000.0 << " s ("
+              << (elapsed ? (uint64_t)(options.count * 1e9 / elapsed) : 0) << " pps)"
+              << std::endl;
+    print_latency(histogram);
+    return (failed || received == 0) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/**
+ * @brief Sends ECHO probes to every target, keeping a bounded number of
+ * probes in flight, and prints each target reachability. With more than one
+ * probe per target, the replies and the minimum, p50/p99/p999 and maximum
+ * round trip times are printed per target.
+ *
+ * @param options Application options.
+ * @return int
+ */
+static int run_sweep(const application_options_t &options)
+{
+    std::unique_ptr<Socket> socket = std::make_unique<Socket>();
+    TargetSource source(options.targets, options.targets_count, options.targets_file);
+    std::vector<sweep_target_t> summaries;
+    LatencyHistogram histogram;
+    size_t alive = 0, unreachable = 0, failed = 0;
+    uint64_t start;
+    char address[INET_ADDRSTRLEN];
+
+    Sweep sweep(*socket, options.source_address, options.in_flight, options.timeout,
+                options.retries, options.count);
+
+    start = get_timestamp();
+    sweep.run(source, [&](const sweep_result_t &result) {
+        /* Only the per-target summaries keep every target. */
+        if (options.count > 1 && result.target >= summaries.size())
+        {
+            summaries.resize(result.target + 1);
+        }
+        if (options.count > 1)
+        {
+            summaries[result.target].address = result.address;
+        }
+
+        switch (result.status)
+        {
+        case SWEEP_ALIVE:
+        {
+            alive++;
+            histogram.record(result.rtt);
+            if (options.count > 1)
+            {
+                summaries[result.target].rtt.record(result.rtt);
+                return;
+            }
+            inet_ntop(AF_INET, &result.address, address, sizeof(address));
+            std::cout << address << " is alive (" << (double)result.rtt / 1000000.0 << " ms)\n";
+            break;
+        }
+        case SWEEP_TIMEOUT:
+        {
+            unreachable++;
+            if (options.count == 1)
+            {
+                inet_ntop(AF_INET, &result.address, address, sizeof(address));
+                std::cout << address << " is unreachable\n";
+            }
+            break;
+        }
+        case SWEEP_SEND_ERROR:
+        default:
+        {
+            failed++;
+            inet_ntop(AF_INET, &result.address, address, sizeof(address));
+            std::cout << address << " could not be probed\n";
+            break;
+        }
+        }
+    });
+
+    for (const sweep_target_t &target : summaries)
+    {
+        inet_ntop(AF_INET, &target.address, address, sizeof(address));
+        std::cout << address << " : " << target.rtt.get_count() << "/" << options.count << " received";
+        if (target.rtt.get_count())
+        {
+            std::cout << ", min/p50/p99/p999/max = " << (double)target.rtt.get_min() / 1000000.0 << "/"
+                      << (double)target.rtt.get_percentile(50.0) / 1000000.0 << "/"
+                      << (double)target.rtt.get_percentile(99.0) / 1000000.0 << "/"
+                      << (double)target.rtt.get_percentile(99.9) / 1000000.0 << "/"
+                      << (double)target.rtt.get_max() / 1000000.0 << " ms";
+        }
+        std::cout << "\n";
+    }
+
+    std::cout << sweep.get_targets() * options.count << " probes to " << sweep.get_targets()
+              << " targets, " << alive << " replies, " << unreachable << " timeouts, "
+              << failed << " send errors, " << sweep.get_duplicates() << " duplicates, "
+              << sweep.get_late() << " late replies in "
+              << (double)(get_timestamp() - start) / 1000000000.0 << " s" << std::endl;
+    print_latency(histogram);
+    return alive ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+ * @brief Traces the path to every target, probing all of its TTLs at once,
+ * and prints the hops of each target up to the first one that answered
+ * from the target itself or reported it unreachable.
+ *
+ * @param options Application options.
+ * @return int
+ */
+static int run_traceroute(const application_options_t &options)
+{
+    std::unique_ptr<Socket> socket = std::make_unique<Socket>();
+    TargetSource source(options.targets, options.targets_count, options.targets_file);
+    size_t reached = 0;
+    uint64_t start;
+    char address[INET_ADDRSTRLEN];
+
+    Traceroute traceroute(*socket, options.source_address, options.in_flight, options.timeout,
+                          options.max_ttl);
+
+    start = get_timestamp();
+    traceroute.run(source, [&](const traceroute_path_t &path) {
+        inet_ntop(AF_INET, &path.destination_address, address, sizeof(address));
+        std::cout << "traceroute to " << address << ", " << (unsigned)options.max_ttl
+                  << " hops max\n";
+        for (const traceroute_hop_t &hop : path.hops)
+        {
+            std::cout << " " << (unsigned)hop.ttl << "  ";
+            switch (hop.status)
+            {
+            case TRACEROUTE_TIMEOUT:
+            {
+                std::cout << "*\n";
+                continue;
+            }
+            case TRACEROUTE_SEND_ERROR:
+            {
+                std::cout << "could not be probed\n";
+                continue;
+            }
+            default:
+            {
+                break;
+            }
+            }
+
+            inet_ntop(AF_INET, &hop.address, address, sizeof(address));
+            std::cout << address << "  " << (double)hop.rtt / 1000000.0 << " ms";
+            if (hop.status == TRACEROUTE_UNREACHABLE)
+            {
+                std::cout << " !U\n";
+                break;
+            }
+            std::cout << "\n";
+            if (hop.status == TRACEROUTE_REACHED)
+            {
+                reached++;
+                break;
+            }
+        }
+    });
+
+    std::cout << traceroute.get_targets() * options.max_ttl << " probes to "
+              << traceroute.get_targets() << " targets, " << reached << " reached in "
+              << (double)(get_timestamp() - start) / 1000000000.0 << " s" << std::endl;
+    return reached ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+ * @brief Discovers the path MTU of every target and prints it, with the
+ * router that reported the bottleneck when one did.
+ *
+ * @param options Application options.
+ * @return int
+ */
+static int run_pmtu(const application_options_t &options)
+{
+    std::unique_ptr<Socket> socket = std::make_unique<Socket>();
+    TargetSource source(options.targets, options.targets_count, options.targets_file);
+    PmtuCache cache;
+    size_t found = 0;
+    uint64_t start;
+    char address[INET_ADDRSTRLEN], reporter[INET_ADDRSTRLEN];
+
+    Pmtu pmtu(*socket, options.source_address, options.in_flight, options.timeout,
+              options.max_mtu, &cache);
+
+    start = get_timestamp();
+    pmtu.run(source, [&](const pmtu_result_t &result) {
+        inet_ntop(AF_INET, &result.destination_address, address, sizeof(address));
+        if (result.status == PMTU_UNREACHABLE)
+        {
+            std::cout << address << " is unreachable\n";
+            return;
+        }
+
+        found++;
+        std::cout << address << " path MTU " << result.mtu << " (" << result.rounds << " rounds";
+        if (result.next_hop_mtu)
+        {
+            inet_ntop(AF_INET, &result.reporter, reporter, sizeof(reporter));
+            std::cout << ", next-hop MTU " << result.next_hop_mtu << " reported by " << reporter;
+        }
+        std::cout << ")\n";
+    });
+
+    std::cout << pmtu.get_targets() << " targets, " << found << " path MTUs found in "
+              << (double)(get_timestamp() - start) / 1000000000.0 << " s" << std::endl;
+    return found ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+ * @brief Sends TIMESTAMP probes to every target and prints, per target, the
+ * clock offset and the forward and backward one-way delays, from the
+ * originate (local send time), receive, transmit and local receive times.
+ *
+ * @param options Application options.
+ * @return int
+ */
+static int run_timestamp(const application_options_t &options)
+{
+    std::unique_ptr<Socket> socket = std::make_unique<Socket>();
+    TargetSource source(options.targets, options.targets_count, options.targets_file);
+    std::vector<uint32_t> targets;
+    std::vector<timestamp_stats_t> stats;
+    LatencyHistogram histogram;
+    size_t replies = 0, unreachable = 0, failed = 0;
+    uint64_t start;
+    char address[INET_ADDRSTRLEN];
+
+    Sweep sweep(*socket, options.source_address, options.in_flight, options.timeout,
+                options.retries, options.count, TIMESTAMP);
+
+    start = get_timestamp();
+    sweep.run(source, [&](const sweep_result_t &result) {
+        double originate, received, forward, backward;
+
+        if (result.target >= targets.size())
+        {
+            targets.resize(result.target + 1);
+            stats.resize(result.target + 1, {0, 0, 0.0, 0.0, 0.0, 0.0, 0.0});
+        }
+        targets[result.target] = result.address;
+        timestamp_stats_t &target = stats[result.target];
+
+        switch (result.status)
+        {
+        case SWEEP_ALIVE:
+        {
+            replies++;
+            histogram.record(result.rtt);
+            target.replies++;
+            if ((result.receive_timestamp | result.transmit_timestamp) & ICMP_TIMESTAMP_NONSTANDARD)
+            {
+                target.nonstandard++;
+                return;
+            }
+
+            /* The target truncates its clock to the millisecond, half a
+             * millisecond is added to center the error. */
+            originate = get_day_milliseconds(result.timestamp - result.rtt);
+            received = get_day_milliseconds(result.timestamp);
+            forward = get_day_difference(result.receive_timestamp + 0.5, originate);
+            backward = get_day_difference(received, result.transmit_timestamp + 0.5);
+            target.offset_sum += (forward - backward) / 2;
+            if (target.replies - target.nonstandard == 1 || forward + backward < target.delay)
+            {
+                target.offset = (forward - backward) / 2;
+                target.forward = forward;
+                target.backward = backward;
+                target.delay = forward + backward;
+            }
+            break;
+        }
+        case SWEEP_TIMEOUT:
+        {
+            unreachable++;
+            break;
+        }
+        case SWEEP_SEND_ERROR:
+        default:
+        {
+            failed++;
+            break;
+        }
+        }
+    });
+
+    for (size_t i = 0; i < targets.size(); i++)
+    {
+        const timestamp_stats_t &target = stats[i];
+        size_t standard = target.replies - target.nonstandard;
+
+        inet_ntop(AF_INET, &targets[i], address, sizeof(address));
+        std::cout << address << " : " << target.replies << "/" << options.count << " replies";
+        if (standard)
+        {
+            std::cout << ", offset " << target.offset << " ms (mean " << target.offset_sum / standard
+                      << " ms), one-way forward/backward = " << target.forward << "/"
+                      << target.backward << " ms";
+        }
+        if (target.nonstandard)
+        {
+            std::cout << ", " << target.nonstandard << " non-standard timestamps";
+        }
+        std::cout << "\n";
+    }
+
+    std::cout << sweep.get_targets() * options.count << " probes to " << sweep.get_targets()
+              << " targets, " << replies << " replies, " << unreachable << " timeouts, "
+              << failed << " send errors, " << sweep.get_duplicates() << " duplicates, "
+              << sweep.get_late() << " late replies in "
+              << (double)(get_timestamp() - start) / 1000000000.0 << " s" << std::endl;
+    print_latency(histogram);
+    return replies ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+ * @brief Signal handler, asks the responder to stop.
+ *
+ * @param signal_number
+ */
+static void interrupt(int signal_number)
+{
+    (void)signal_number;
+    interrupted = 1;
+}
+
+/**
+ * @brief Answers ECHO requests until SIGINT or SIGTERM, printing the reply
+ * rate every second unless quiet, and the totals when stopped. A worker
+ * error stops the responder and is thrown.
+ *
+ * @param options Application options.
+ * @return int
+ */
+static int run_responder(const application_options_t &options)
+{
+    struct sigaction action;
+    struct timespec interval = {RESPONDER_REPORT_INTERVAL / 1000,
+                                (RESPONDER_REPORT_INTERVAL % 1000) * 1000000L};
+    Responder responder(options.threads);
+    uint64_t start, last, now, replies, last_replies = 0;
+
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = interrupt;
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+
+    std::cout << "Answering ECHO requests with " << responder.get_threads() << " threads" << std::endl;
+    responder.start();
+    start = last = get_timestamp();
+    while (!interrupted && responder.is_running())
+    {
+        nanosleep(&interval, nullptr);
+        now = get_timestamp();
+        replies = responder.get_replies();
+        if (!options.quiet && now > last)
+        {
+            std::cout << replies - last_replies << " replies, "
+                      << (uint64_t)((double)(replies - last_replies) * 1000000000.0 / (double)(now - last))
+                      << " pps" << std::endl;
+        }
+        last = now;
+        last_replies = replies;
+    }
+    responder.stop();
+    responder.check_error();
+
+    now = get_timestamp();
+    replies = responder.get_replies();
+    std::cout << replies << " replies in " << (double)(now - start) / 1000000000.0 << " s, "
+              << (uint64_t)((double)replies * 1000000000.0 / (double)(now - start)) << " pps"
+              << std::endl;
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Sends the ICMP datagrams of a capture again, with the original
+ * timing, scaled timing or as fast as possible, and prints the outcome.
+ *
+ * @param options Application options.
+ * @return int
+ */
+static int run_replay(const application_options_t &options)
+{
+    std::unique_ptr<Socket> socket = std::make_unique<Socket>();
+    PcapReader reader(options.capture_file);
+    Replay replay(*socket, options.speed);
+    replay_stats_t stats;
+
+    replay.run(reader, &stats);
+
+    std::cout << stats.datagrams << " datagrams replayed, " << stats.sent << " sent, "
+              << stats.send_errors << " send errors, " << stats.skipped << " records skipped";
+    if (reader.is_truncated())
+    {
+        std::cout << " (capture truncated)";
+    }
+    std::cout << "\n"
+              << "captured over " << (double)stats.capture_duration / 1000000000.0 << " s, replayed in "
+              << (double)stats.duration / 1000000000.0 << " s ("
+              << (stats.duration ? (uint64_t)((double)stats.sent * 1e9 / stats.duration) : 0) << " pps)"
+              << std::endl;
+    return (stats.datagrams && stats.send_errors == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+ * @brief Analyzes a capture and prints the loss and round trip times of
+ * every target, then the totals.
+ *
+ * @param options Application options.
+ * @return int
+ */
+static int run_analyze(const application_options_t &options)
+{
+    Analyzer analyzer(options.capture_file, options.threads);
+    char address[INET_ADDRSTRLEN];
+
+    analyzer.run();
+    const analyze_summary_t &summary = analyzer.get_summary();
+
+    for (const analyze_target_t &target : analyzer.get_targets())
+    {
+        if (options.quiet)
+        {
+            break;
+        }
+        inet_ntop(AF_INET, &target.address, address, sizeof(address));
+        std::cout << address << " : " << target.requests << " requests, " << target.replies
+                  << " replies, " << 100.0 * (target.requests - std::min(target.replies, target.requests)) /
+                                         target.requests
+                  << "% loss";
+        if (target.replies)
+        {
+            std::cout << ", rtt min/avg/max = " << (double)target.rtt_min / 1000000.0 << "/"
+                      << (double)target.rtt_sum / target.replies / 1000000.0 << "/"
+                      << (double)target.rtt_max / 1000000.0 << " ms";
+            std::cout << ", p50/p99/p999 = " << (double)target.rtt.get_percentile(50.0) / 1000000.0 << "/"
+                      << (double)target.rtt.get_percentile(99.0) / 1000000.0 << "/"
+                      << (double)target.rtt.get_percentile(99.9) / 1000000.0 << " ms";
+        }
+        std::cout << "\n";
+    }
+
+    std::cout << summary.datagrams << " datagrams, " << summary.skipped << " skipped, "
+              << summary.requests << " requests, " << summary.replies << " replies, "
+              << summary.unmatched << " unmatched replies, " << analyzer.get_targets().size()
+              << " targets";
+    if (summary.truncated)
+    {
+        std::cout << " (capture truncated)";
+    }
+    std::cout << ", analyzed in " << (double)summary.duration / 1000000000.0 << " s with "
+              << summary.chunks << " threads" << std::endl;
+    print_latency(analyzer.get_rtt());
+    return summary.requests ? EXIT_SUCCESS : EXIT_FAILURE;
+}
 
 /**
  * @brief service main function.
@@ -28,21 +853,57 @@
  */
 int main(int argc, char *argv[])
 {
-    uint32_t source_address, destination_address;
+    application_options_t options;
+    std::unique_ptr<MetricsServer> metrics;
+    std::unique_ptr<PcapWriter> capture;
     try
     {
-        get_application_addresses(argc, argv, &source_address, &destination_address);
-        std::unique_ptr<Icmp> icmp = std::make_unique<Icmp>(ECHO);
-        std::unique_ptr<Ipv4> ipv4 = std::make_unique<Ipv4>();
-        std::unique_ptr<Socket> socket = std::make_unique<Socket>();
-
-        ipv4->set_protocol_number(ICMP_NUMBER);
-        ipv4->set_source_address(source_address);
-        ipv4->set_destination_address(destination_address);
-
-        ipv4->set_data(icmp->encode());
-
-        socket->send_raw(ipv4->encode(), destination_address);
+        get_application_options(argc, argv, &options);
+        if (options.metrics)
+        {
+            metrics = std::make_unique<MetricsServer>(SERVICE_PORT);
+        }
+        if (options.pcap_file)
+        {
+            capture = std::make_unique<PcapWriter>(options.pcap_file);
+            Socket::set_capture(capture.get());
+        }
+        switch (options.mode)
+        {
+        case MODE_SWEEP:
+        {
+            return run_sweep(options);
+        }
+        case MODE_TRACEROUTE:
+        {
+            return run_traceroute(options);
+        }
+        case MODE_PMTU:
+        {
+            return run_pmtu(options);
+        }
+        case MODE_TIMESTAMP:
+        {
+            return run_timestamp(options);
+        }
+        case MODE_RESPONDER:
+        {
+            return run_responder(options);
+        }
+        case MODE_REPLAY:
+        {
+            return run_replay(options);
+        }
+        case MODE_ANALYZE:
+        {
+            return run_analyze(options);
+        }
+        case MODE_PING:
+        default:
+        {
+            return run_ping(options);
+        }
+        }
     }
     catch (const std::exception &e)
     {
@@ -50,4 +911,4 @@ int main(int argc, char *argv[])
         return EXIT_FAILURE;
     }
     return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
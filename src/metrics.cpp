@@ -0,0 +1,233 @@
+/**
+ * @file metrics.cpp
+ * @author Mateus Lima Alves (mateuslima.ti@gmail.com)
+ * @brief Process-wide metrics class methods.
+ * @version 0.1
+ * @date 2022-03-27
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include <metrics.hpp>
+#include <cstdio>
+
+/**
+ * @brief Construct a new Metrics:: Metrics object
+ *
+ */
+Metrics::Metrics() :
+    in_flight{0}
+{
+}
+
+/**
+ * @brief Get the registry.
+ *
+ * @return Metrics&
+ */
+Metrics &Metrics::get_instance()
+{
+    static Metrics instance;
+
+    return instance;
+}
+
+/**
+ * @brief Get the counters of the calling thread.
+ *
+ * @return metrics_counters_t&
+ */
+metrics_counters_t &Metrics::get_counters()
+{
+    return get_thread().counters;
+}
+
+/**
+ * @brief Get the metrics of the calling thread.
+ *
+ * @return Metrics::metrics_thread_t&
+ */
+Metrics::metrics_thread_t &Metrics::get_thread()
+{
+    thread_local metrics_thread_t *thread = get_instance().add_thread();
+
+    return *thread;
+}
+
+/**
+ * @brief Set the number of probes waiting for a reply.
+ *
+ * @param in_flight
+ */
+void Metrics::set_in_flight(size_t in_flight)
+{
+    this->in_flight.store(in_flight, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Get the encode latency histogram of the calling thread.
+ *
+ * @return LatencyHistogram&
+ */
+LatencyHistogram &Metrics::get_encode_latency()
+{
+    return get_thread().histograms.encode_latency;
+}
+
+/**
+ * @brief Get the send latency histogram of the calling thread.
+ *
+ * @return LatencyHistogram&
+ */
+LatencyHistogram &Metrics::get_send_latency()
+{
+    return get_thread().histograms.send_latency;
+}
+
+/**
+ * @brief Get the round trip time histogram of the calling thread.
+ *
+ * @return LatencyHistogram&
+ */
+LatencyHistogram &Metrics::get_rtt()
+{
+    return get_thread().histograms.rtt;
+}
+
+/**
+ * @brief Get every metric in the Prometheus text exposition format.
+ *
+ * @return std::string
+ */
+std::string Metrics::get_text()
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+    std::string text;
+    char line[128];
+
+    text.reserve(8192);
+    this->append_counter(text, "packets_encoded_total", "Packets encoded.",
+                         &metrics_counters_t::encoded);
+    this->append_counter(text, "packets_sent_total", "Packets sent.",
+                         &metrics_counters_t::sent);
+    this->append_counter(text, "send_errors_total", "Packets that could not be sent.",
+                         &metrics_counters_t::send_errors);
+    this->append_counter(text, "packets_received_total", "Datagrams received.",
+                         &metrics_counters_t::received);
+    this->append_counter(text, "replies_matched_total", "Replies matched to a probe.",
+                         &metrics_counters_t::replies);
+    this->append_counter(text, "timeouts_total", "Probes without a reply in time.",
+                         &metrics_counters_t::timeouts);
+    this->append_counter(text, "kernel_drops_total", "Datagrams dropped by the kernel.",
+                         &metrics_counters_t::drops);
+
+    snprintf(line, sizeof(line),
+             "# HELP " METRICS_PREFIX "in_flight Probes waiting for a reply.\n"
+             "# TYPE " METRICS_PREFIX "in_flight gauge\n"
+             METRICS_PREFIX "in_flight %lu\n",
+             (unsigned long)this->in_flight.load(std::memory_order_relaxed));
+    text += line;
+
+    this->append_histogram(text, "encode_seconds", "Time spent encoding a batch.",
+                           &metrics_histograms_t::encode_latency);
+    this->append_histogram(text, "send_seconds", "Time spent sending a batch.",
+                           &metrics_histograms_t::send_latency);
+    this->append_histogram(text, "rtt_seconds", "Round trip time of the replies.",
+                           &metrics_histograms_t::rtt);
+    return text;
+}
+
+/**
+ * @brief Allocates the metrics of a new thread. They outlive the thread, so
+ * its counts stay in the totals.
+ *
+ * @return Metrics::metrics_thread_t*
+ */
+Metrics::metrics_thread_t *Metrics::add_thread()
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+    std::unique_ptr<metrics_thread_t> thread = std::make_unique<metrics_thread_t>();
+    metrics_thread_t *pointer = thread.get();
+
+    pointer->counters.encoded.store(0);
+    pointer->counters.sent.store(0);
+    pointer->counters.send_errors.store(0);
+    pointer->counters.received.store(0);
+    pointer->counters.replies.store(0);
+    pointer->counters.timeouts.store(0);
+    pointer->counters.drops.store(0);
+    this->threads.push_back(std::move(thread));
+    return pointer;
+}
+
+/**
+ * @brief Appends a counter summed over every thread, under the scrape lock.
+ *
+ * @param text
+ * @param name
+ * @param help
+ * @param counter
+ */
+void Metrics::append_counter(std::string &text, const char *name, const char *help,
+                             std::atomic<uint64_t> metrics_counters_t::*counter)
+{
+    char line[256];
+    uint64_t sum = 0;
+
+    for (const std::unique_ptr<metrics_thread_t> &thread : this->threads)
+    {
+        sum += (thread->counters.*counter).load(std::memory_order_relaxed);
+    }
+
+    snprintf(line, sizeof(line), "# HELP " METRICS_PREFIX "%s %s\n# TYPE " METRICS_PREFIX
+             "%s counter\n" METRICS_PREFIX "%s %lu\n", name, help, name, name, (unsigned long)sum);
+    text += line;
+}
+
+/**
+ * @brief Appends a histogram merged from the one of every thread, under the
+ * scrape lock. The count is the bucket total, so it agrees with the +Inf
+ * bucket while values are being recorded.
+ *
+ * @param text
+ * @param name
+ * @param help
+ * @param histogram
+ */
+void Metrics::append_histogram(std::string &text, const char *name, const char *help,
+                               LatencyHistogram metrics_histograms_t::*histogram)
+{
+    std::unique_ptr<LatencyHistogram> snapshot = std::make_unique<LatencyHistogram>();
+    char line[256];
+    uint64_t cumulative = 0;
+
+    for (const std::unique_ptr<metrics_thread_t> &thread : this->threads)
+    {
+        snapshot->merge(thread->histograms.*histogram);
+    }
+
+    snprintf(line, sizeof(line), "# HELP " METRICS_PREFIX "%s %s\n# TYPE " METRICS_PREFIX
+             "%s histogram\n", name, help, name);
+    text += line;
+
+    for (size_t i = 0; i < LatencyHistogram::get_bucket_count(); i++)
+    {
+        cumulative += snapshot->get_bucket(i);
+        /* The last bucket of every power of two is an exact boundary. */
+        if (i < HISTOGRAM_SUB_BUCKETS || (i + 1) % (HISTOGRAM_SUB_BUCKETS / 2) != 0)
+        {
+            continue;
+        }
+        snprintf(line, sizeof(line), METRICS_PREFIX "%s_bucket{le=\"%.9g\"} %lu\n", name,
+                 (double)(LatencyHistogram::get_bucket_value(i) + 1) / 1e9,
+                 (unsigned long)cumulative);
+        text += line;
+    }
+
+    snprintf(line, sizeof(line), METRICS_PREFIX "%s_bucket{le=\"+Inf\"} %lu\n"
+             METRICS_PREFIX "%s_sum %.9f\n" METRICS_PREFIX "%s_count %lu\n",
+             name, (unsigned long)cumulative, name, (double)snapshot->get_sum() / 1e9, name,
+             (unsigned long)cumulative);
+    text += line;
+}
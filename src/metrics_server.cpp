@@ -0,0 +1,189 @@
+/**
+ * @file metrics_server.cpp
+ * @author Mateus Lima Alves (mateuslima.ti@gmail.com)
+ * @brief Metrics HTTP server class methods.
+ * @version 0.1
+ * @date 2022-03-27
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/eventfd.h>
+#include <netinet/in.h>
+#include <netdb.h>
+#include <poll.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <string>
+
+#include <metrics_server.hpp>
+#include <metrics.hpp>
+#include <exceptions.hpp>
+
+/**
+ * @brief Construct a new Metrics Server:: Metrics Server object
+ *
+ * @param port
+ */
+MetricsServer::MetricsServer(const char *port) :
+    l_file_descriptor{-1}, w_file_descriptor{-1}
+{
+    struct addrinfo hints, *addresses;
+    int fd, option = 1;
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    if (getaddrinfo(nullptr, port, &hints, &addresses) != 0)
+    {
+        throw Exception(EXCEPTION_MSG("MetricsServer - Invalid port."));
+    }
+
+    fd = socket(addresses->ai_family, addresses->ai_socktype | SOCK_CLOEXEC,
+                addresses->ai_protocol);
+    if (fd < 0)
+    {
+        freeaddrinfo(addresses);
+        throw Exception(EXCEPTION_MSG("MetricsServer - Could not create socket."));
+    }
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &option, sizeof(option));
+    if (bind(fd, addresses->ai_addr, addresses->ai_addrlen) < 0 ||
+        listen(fd, METRICS_SERVER_BACKLOG) < 0)
+    {
+        freeaddrinfo(addresses);
+        close(fd);
+        throw Exception(EXCEPTION_MSG("MetricsServer - Could not listen on port."));
+    }
+    freeaddrinfo(addresses);
+
+    this->w_file_descriptor = eventfd(0, EFD_CLOEXEC);
+    if (this->w_file_descriptor < 0)
+    {
+        close(fd);
+        throw Exception(EXCEPTION_MSG("MetricsServer - Could not create event."));
+    }
+
+    this->l_file_descriptor = fd;
+    this->thread = std::thread(&MetricsServer::run, this);
+}
+
+/**
+ * @brief Destroy the Metrics Server:: Metrics Server object
+ *
+ */
+MetricsServer::~MetricsServer()
+{
+    uint64_t value = 1;
+
+    if (write(this->w_file_descriptor, &value, sizeof(value)) < 0)
+    {
+        /* Nothing else can wake the thread up, it is left blocked. */
+        this->thread.detach();
+    }
+    if (this->thread.joinable())
+    {
+        this->thread.join();
+        close(this->w_file_descriptor);
+        close(this->l_file_descriptor);
+    }
+}
+
+/**
+ * @brief Accepts and answers connections until stopped.
+ *
+ */
+void MetricsServer::run()
+{
+    struct pollfd fds[2];
+
+    fds[0].fd = this->l_file_descriptor;
+    fds[0].events = POLLIN;
+    fds[1].fd = this->w_file_descriptor;
+    fds[1].events = POLLIN;
+
+    for (;;)
+    {
+        int fd;
+
+        if (poll(fds, 2, -1) < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return;
+        }
+        if (fds[1].revents)
+        {
+            return;
+        }
+        if (!(fds[0].revents & POLLIN))
+        {
+            continue;
+        }
+
+        fd = accept4(this->l_file_descriptor, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0)
+        {
+            continue;
+        }
+        this->serve(fd);
+        close(fd);
+    }
+}
+
+/**
+ * @brief Answers one connection.
+ *
+ * @param fd
+ */
+void MetricsServer::serve(int fd)
+{
+    char request[METRICS_SERVER_REQUEST_LENGTH];
+    struct pollfd event = {fd, POLLIN, 0};
+    std::string response, body;
+    size_t length = 0;
+    const char *status = "404 Not Found";
+
+    /* Only the request line matters, read until the end of the headers. */
+    while (length < sizeof(request) - 1 && poll(&event, 1, METRICS_SERVER_REQUEST_TIMEOUT) > 0)
+    {
+        ssize_t ret = recv(fd, request + length, sizeof(request) - 1 - length, 0);
+        if (ret <= 0)
+        {
+            break;
+        }
+        length += (size_t)ret;
+        request[length] = '\0';
+        if (strstr(request, "\r\n\r\n") != nullptr)
+        {
+            break;
+        }
+    }
+    request[length] = '\0';
+
+    if (strncmp(request, "GET /metrics ", 13) == 0 || strncmp(request, "GET /metrics?", 13) == 0)
+    {
+        status = "200 OK";
+        body = Metrics::get_instance().get_text();
+    }
+
+    response = std::string("HTTP/1.1 ") + status +
+               "\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " +
+               std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+
+    for (size_t sent = 0; sent < response.size();)
+    {
+        ssize_t ret = send(fd, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+        if (ret <= 0)
+        {
+            break;
+        }
+        sent += (size_t)ret;
+    }
+}
@@ -0,0 +1,156 @@
+/**
+ * @file packet_pool.cpp
+ * @author Mateus Lima Alves (mateuslima.ti@gmail.com)
+ * @brief Packet pool class methods.
+ * @version 0.1
+ * @date 2022-03-31
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include <sys/mman.h>
+
+#include <packet_pool.hpp>
+#include <exceptions.hpp>
+
+/**
+ * @brief Construct a new Packet Pool:: Packet Pool object
+ *
+ * @param frame_size
+ * @param frame_count
+ * @param huge_pages
+ */
+PacketPool::PacketPool(size_t frame_size, size_t frame_count, bool huge_pages) :
+    memory{nullptr}, length{0}, huge{false}
+{
+    void *mapping = MAP_FAILED;
+
+    if (frame_size == 0 || frame_count == 0 || frame_count > UINT32_MAX)
+    {
+        throw Exception(EXCEPTION_MSG("POOL - Invalid frame size or count."));
+    }
+
+    this->frame_size = (frame_size + PACKET_POOL_ALIGNMENT - 1) & ~(size_t)(PACKET_POOL_ALIGNMENT - 1);
+    this->frame_count = frame_count;
+    this->length = this->frame_size * frame_count;
+
+    if (huge_pages)
+    {
+        size_t huge_length = (this->length + PACKET_POOL_HUGE_PAGE - 1) & ~(PACKET_POOL_HUGE_PAGE - 1);
+
+        mapping = mmap(nullptr, huge_length, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE, -1, 0);
+        if (mapping != MAP_FAILED)
+        {
+            this->length = huge_length;
+            this->huge = true;
+        }
+    }
+    if (mapping == MAP_FAILED)
+    {
+        mapping = mmap(nullptr, this->length, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+        if (mapping == MAP_FAILED)
+        {
+            throw Exception(EXCEPTION_MSG("POOL - Could not map frames."));
+        }
+        if (huge_pages)
+        {
+            /* Best effort, no huge pages reserved: ask for transparent ones. */
+            madvise(mapping, this->length, MADV_HUGEPAGE);
+        }
+    }
+    this->memory = (uint8_t *)mapping;
+
+    this->free_frames.reserve(frame_count);
+    for (size_t i = frame_count; i > 0; i--)
+    {
+        this->free_frames.push_back((uint32_t)(i - 1));
+    }
+}
+
+/**
+ * @brief Destroy the Packet Pool:: Packet Pool object
+ *
+ */
+PacketPool::~PacketPool()
+{
+    munmap(this->memory, this->length);
+}
+
+/**
+ * @brief Takes a frame out of the pool.
+ *
+ * @return uint8_t*
+ */
+uint8_t *PacketPool::acquire()
+{
+    uint32_t index;
+
+    if (this->free_frames.empty())
+    {
+        return nullptr;
+    }
+    index = this->free_frames.back();
+    this->free_frames.pop_back();
+    return this->memory + (size_t)index * this->frame_size;
+}
+
+/**
+ * @brief Gives a frame back to the pool. Never reallocates, the free list
+ * has room for every frame.
+ *
+ * @param frame
+ */
+void PacketPool::release(uint8_t *frame)
+{
+    size_t offset = (size_t)(frame - this->memory);
+
+    if (frame < this->memory || offset >= this->frame_size * this->frame_count ||
+        offset % this->frame_size != 0 || this->free_frames.size() == this->frame_count)
+    {
+        throw Exception(EXCEPTION_MSG("POOL - Frame does not belong to this pool."));
+    }
+    this->free_frames.push_back((uint32_t)(offset / this->frame_size));
+}
+
+/**
+ * @brief Get the frame size in octets.
+ *
+ * @return size_t
+ */
+size_t PacketPool::get_frame_size()
+{
+    return this->frame_size;
+}
+
+/**
+ * @brief Get the number of frames.
+ *
+ * @return size_t
+ */
+size_t PacketPool::get_frame_count()
+{
+    return this->frame_count;
+}
+
+/**
+ * @brief Get the number of frames not in use.
+ *
+ * @return size_t
+ */
+size_t PacketPool::get_available()
+{
+    return this->free_frames.size();
+}
+
+/**
+ * @brief Checks whether the frames are backed by huge pages.
+ *
+ * @return bool
+ */
+bool PacketPool::is_huge()
+{
+    return this->huge;
+}
@@ -0,0 +1,132 @@
+/**
+ * @file payload_buffer.cpp
+ * @author Mateus Lima Alves (mateuslima.ti@gmail.com)
+ * @brief Payload buffer class methods.
+ * @version 0.1
+ * @date 2022-04-01
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include <cstring>
+
+#include <payload_buffer.hpp>
+
+/**
+ * @brief Construct a new Payload Buffer:: Payload Buffer object
+ *
+ */
+PayloadBuffer::PayloadBuffer() :
+    length{0}, capacity{PAYLOAD_BUFFER_INLINE}
+{
+}
+
+/**
+ * @brief Construct a new Payload Buffer:: Payload Buffer object
+ *
+ * @param other
+ */
+PayloadBuffer::PayloadBuffer(const PayloadBuffer &other) :
+    length{0}, capacity{PAYLOAD_BUFFER_INLINE}
+{
+    this->assign(other.data(), other.size());
+}
+
+/**
+ * @brief Copy other into this buffer.
+ *
+ * @param other
+ * @return PayloadBuffer&
+ */
+PayloadBuffer &PayloadBuffer::operator=(const PayloadBuffer &other)
+{
+    if (this != &other)
+    {
+        this->assign(other.data(), other.size());
+    }
+    return *this;
+}
+
+/**
+ * @brief Destroy the Payload Buffer:: Payload Buffer object
+ *
+ */
+PayloadBuffer::~PayloadBuffer()
+{
+}
+
+/**
+ * @brief Replace the content with a copy of data. The heap storage grows
+ * but never shrinks, so a reused buffer stops allocating once it has seen
+ * its largest payload.
+ *
+ * @param data
+ * @param length
+ */
+void PayloadBuffer::assign(const uint8_t *data, size_t length)
+{
+    if (!data)
+    {
+        length = 0;
+    }
+    if (length > this->capacity)
+    {
+        this->heap_data.reset(new uint8_t[length]);
+        this->capacity = length;
+    }
+    if (length)
+    {
+        memcpy(this->heap_data ? this->heap_data.get() : this->inline_data, data, length);
+    }
+    this->length = length;
+}
+
+/**
+ * @brief Drop the content, keeping the capacity.
+ *
+ */
+void PayloadBuffer::clear()
+{
+    this->length = 0;
+}
+
+/**
+ * @brief Get a view of the content.
+ *
+ * @return byte_span_t
+ */
+byte_span_t PayloadBuffer::get_span() const
+{
+    return {this->data(), this->length};
+}
+
+/**
+ * @brief Get the content.
+ *
+ * @return const uint8_t*
+ */
+const uint8_t *PayloadBuffer::data() const
+{
+    return this->heap_data ? this->heap_data.get() : this->inline_data;
+}
+
+/**
+ * @brief Get the content length in octets.
+ *
+ * @return size_t
+ */
+size_t PayloadBuffer::size() const
+{
+    return this->length;
+}
+
+/**
+ * @brief Get the octets that fit without allocating.
+ *
+ * @return size_t
+ */
+size_t PayloadBuffer::get_capacity() const
+{
+    return this->capacity;
+}
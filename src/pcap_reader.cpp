@@ -0,0 +1,361 @@
+/**
+ * @file pcap_reader.cpp
+ * @author Mateus Lima Alves (mateuslima.ti@gmail.com)
+ * @brief Memory-mapped capture reader methods.
+ * @version 0.1
+ * @date 2022-04-07
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include <pcap_reader.hpp>
+#include <ipv4.hpp>
+#include <exceptions.hpp>
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/**
+ * @brief Construct a new Pcap Reader:: Pcap Reader object
+ *
+ * @param path
+ */
+PcapReader::PcapReader(const char *path) :
+    mapping{nullptr}, size{0}, offset{sizeof(pcap_file_header_t)}, end{0}, swapped{false}, resolution{1},
+    linktype{0}, snaplen{0}, skipped{0}, truncated{false}
+{
+    struct stat status;
+    uint32_t magic;
+    void *mapped;
+    int fd;
+
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        throw Exception(EXCEPTION_MSG("PCAP - Could not open capture file."));
+    }
+    if (fstat(fd, &status) < 0 || (size_t)status.st_size < sizeof(pcap_file_header_t))
+    {
+        close(fd);
+        throw Exception(EXCEPTION_MSG("PCAP - Capture file is too short."));
+    }
+
+    mapped = mmap(nullptr, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED)
+    {
+        throw Exception(EXCEPTION_MSG("PCAP - Could not map capture file."));
+    }
+    /* Best effort, read ahead aggressively. Pages already read stay cached,
+     * they are only reclaimed sooner under memory pressure. */
+    madvise(mapped, (size_t)status.st_size, MADV_SEQUENTIAL);
+    this->mapping = (const uint8_t *)mapped;
+    this->size = (size_t)status.st_size;
+    this->end = this->size;
+
+    memcpy(&magic, this->mapping, sizeof(magic));
+    if (magic == PCAP_MAGIC_NANOSECONDS || magic == PCAP_MAGIC_MICROSECONDS)
+    {
+        this->swapped = false;
+    }
+    else if (__builtin_bswap32(magic) == PCAP_MAGIC_NANOSECONDS ||
+             __builtin_bswap32(magic) == PCAP_MAGIC_MICROSECONDS)
+    {
+        this->swapped = true;
+    }
+    else
+    {
+        munmap(mapped, this->size);
+        throw Exception(EXCEPTION_MSG("PCAP - Not a pcap file (pcapng is not supported)."));
+    }
+    this->resolution = this->read_long(this->mapping) == PCAP_MAGIC_NANOSECONDS ? 1 : 1000;
+    this->linktype = this->read_long(this->mapping + offsetof(pcap_file_header_t, linktype)) & 0xFFFF;
+    this->snaplen = this->read_long(this->mapping + offsetof(pcap_file_header_t, snaplen));
+    if (this->snaplen == 0 || this->snaplen > PCAP_READER_MAX_SNAPLEN)
+    {
+        this->snaplen = PCAP_READER_MAX_SNAPLEN;
+    }
+
+    if (this->linktype != PCAP_LINKTYPE_ETHERNET && this->linktype != PCAP_LINKTYPE_RAW &&
+        this->linktype != PCAP_LINKTYPE_LINUX_SLL && this->linktype != PCAP_LINKTYPE_IPV4)
+    {
+        munmap(mapped, this->size);
+        throw Exception(EXCEPTION_MSG("PCAP - Link type not supported."));
+    }
+}
+
+/**
+ * @brief Destroy the Pcap Reader:: Pcap Reader object
+ *
+ */
+PcapReader::~PcapReader()
+{
+    munmap((void *)this->mapping, this->size);
+}
+
+/**
+ * @brief Get the next IPv4 datagram.
+ *
+ * @param packet
+ * @return true
+ * @return false
+ */
+bool PcapReader::next(pcap_packet_t *packet)
+{
+    while (this->offset < this->end)
+    {
+        const uint8_t *header = this->mapping + this->offset;
+        size_t length, original_length;
+        const uint8_t *datagram;
+
+        if (this->size - this->offset < sizeof(pcap_record_header_t))
+        {
+            this->truncated = true;
+            this->offset = this->size;
+            return false;
+        }
+        length = this->read_long(header + offsetof(pcap_record_header_t, captured_length));
+        original_length = this->read_long(header + offsetof(pcap_record_header_t, original_length));
+        if (length > this->size - this->offset - sizeof(pcap_record_header_t))
+        {
+            this->truncated = true;
+            this->offset = this->size;
+            return false;
+        }
+        this->offset += sizeof(pcap_record_header_t) + length;
+
+        datagram = this->get_datagram(header + sizeof(pcap_record_header_t), &length, &original_length);
+        if (!datagram)
+        {
+            this->skipped++;
+            continue;
+        }
+
+        packet->timestamp = (uint64_t)this->read_long(header + offsetof(pcap_record_header_t, seconds)) *
+                            1000000000ULL +
+                            (uint64_t)this->read_long(header + offsetof(pcap_record_header_t, fraction)) *
+                            this->resolution;
+        packet->data = datagram;
+        packet->length = length;
+        packet->original_length = original_length;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Splits the records into byte ranges of about the same length. The
+ * ranges are cut anywhere, every reader finds its first record itself, so
+ * the threads do not wait for one of them to walk the whole file.
+ *
+ * @param chunks
+ * @return std::vector<size_t>
+ */
+std::vector<size_t> PcapReader::split(size_t chunks)
+{
+    std::vector<size_t> offsets;
+    size_t begin = sizeof(pcap_file_header_t);
+    size_t length = this->size - begin;
+
+    chunks = std::max(std::min(chunks, length / PCAP_READER_MIN_RANGE), (size_t)1);
+    for (size_t i = 0; i < chunks; i++)
+    {
+        offsets.push_back(begin + length / chunks * i);
+    }
+    offsets.push_back(this->size);
+    return offsets;
+}
+
+/**
+ * @brief Restricts next to the records starting in [begin, end). A range
+ * cut by split starts at the first offset that passes is_record, which is
+ * where the reader of the range before stops as well.
+ *
+ * @param begin
+ * @param end
+ */
+void PcapReader::set_range(size_t begin, size_t end)
+{
+    if (begin < sizeof(pcap_file_header_t) || begin > end || end > this->size)
+    {
+        throw Exception(EXCEPTION_MSG("PCAP - Record range invalid."));
+    }
+    if (begin > sizeof(pcap_file_header_t))
+    {
+        while (begin < end && !this->is_record(begin))
+        {
+            begin++;
+        }
+    }
+    this->offset = begin;
+    this->end = end;
+    this->truncated = false;
+}
+
+/**
+ * @brief Get the file length in octets.
+ *
+ * @return size_t
+ */
+size_t PcapReader::get_size()
+{
+    return this->size;
+}
+
+/**
+ * @brief Get the link type of the records.
+ *
+ * @return uint32_t
+ */
+uint32_t PcapReader::get_linktype()
+{
+    return this->linktype;
+}
+
+/**
+ * @brief Get the number of records skipped.
+ *
+ * @return uint64_t
+ */
+uint64_t PcapReader::get_skipped()
+{
+    return this->skipped;
+}
+
+/**
+ * @brief Whether the last record was cut short by the end of the file.
+ *
+ * @return true
+ * @return false
+ */
+bool PcapReader::is_truncated()
+{
+    return this->truncated;
+}
+
+/**
+ * @brief Reads a 32 bit field of the file, in the file byte order.
+ *
+ * @param data
+ * @return uint32_t
+ */
+uint32_t PcapReader::read_long(const uint8_t *data)
+{
+    uint32_t value;
+
+    memcpy(&value, data, sizeof(value));
+    return this->swapped ? __builtin_bswap32(value) : value;
+}
+
+/**
+ * @brief Whether a record header starts at an offset. A header is valid
+ * when it captured something, its time fraction is below a second, its
+ * captured length fits the snap length and the original length, and its
+ * original length is plausible. Chained headers must also be within
+ * PCAP_READER_SYNC_SECONDS of the first one. Payloads (zero padding
+ * especially) may look like one header, rarely like several chained ones
+ * whose lengths line up. A record cut by the end of the file passes, the
+ * reader reports it as truncated.
+ *
+ * @param offset
+ * @return true
+ * @return false
+ */
+bool PcapReader::is_record(size_t offset)
+{
+    uint32_t fraction_limit = this->resolution == 1 ? 1000000000U : 1000000U;
+    uint32_t first = 0;
+
+    for (size_t i = 0; i < PCAP_READER_SYNC_RECORDS && offset < this->size; i++)
+    {
+        const uint8_t *header = this->mapping + offset;
+        uint32_t seconds;
+        size_t length, original_length;
+
+        if (this->size - offset < sizeof(pcap_record_header_t))
+        {
+            return i > 0;
+        }
+        seconds = this->read_long(header + offsetof(pcap_record_header_t, seconds));
+        length = this->read_long(header + offsetof(pcap_record_header_t, captured_length));
+        original_length = this->read_long(header + offsetof(pcap_record_header_t, original_length));
+        if (i == 0)
+        {
+            first = seconds;
+        }
+        if (length == 0 || length > this->snaplen || length > original_length ||
+            original_length > PCAP_READER_MAX_SNAPLEN ||
+            this->read_long(header + offsetof(pcap_record_header_t, fraction)) >= fraction_limit ||
+            (seconds > first ? seconds - first : first - seconds) > PCAP_READER_SYNC_SECONDS)
+        {
+            return false;
+        }
+        offset += sizeof(pcap_record_header_t) + length;
+    }
+    return true;
+}
+
+/**
+ * @brief Strips the link layer header of a record. Ethernet frames may carry
+ * one VLAN tag.
+ *
+ * @param data
+ * @param length
+ * @param original_length
+ * @return const uint8_t*
+ */
+const uint8_t *PcapReader::get_datagram(const uint8_t *data, size_t *length, size_t *original_length)
+{
+    size_t header_length = 0;
+    uint16_t ethertype = PCAP_ETHERTYPE_IPV4;
+
+    switch (this->linktype)
+    {
+    case PCAP_LINKTYPE_ETHERNET:
+    {
+        header_length = PCAP_ETHERNET_LENGTH;
+        if (*length < header_length)
+        {
+            return nullptr;
+        }
+        ethertype = (uint16_t)(data[header_length - 2] << 8 | data[header_length - 1]);
+        if (ethertype == PCAP_ETHERTYPE_VLAN)
+        {
+            header_length += PCAP_VLAN_LENGTH;
+            if (*length < header_length)
+            {
+                return nullptr;
+            }
+            ethertype = (uint16_t)(data[header_length - 2] << 8 | data[header_length - 1]);
+        }
+        break;
+    }
+    case PCAP_LINKTYPE_LINUX_SLL:
+    {
+        header_length = PCAP_LINUX_SLL_LENGTH;
+        if (*length < header_length)
+        {
+            return nullptr;
+        }
+        ethertype = (uint16_t)(data[header_length - 2] << 8 | data[header_length - 1]);
+        break;
+    }
+    default:
+    {
+        break;
+    }
+    }
+
+    if (ethertype != PCAP_ETHERTYPE_IPV4 || *length <= header_length ||
+        (data[header_length] >> 4) != IP_VERSION)
+    {
+        return nullptr;
+    }
+    *length -= header_length;
+    *original_length = *original_length > header_length ? *original_length - header_length : 0;
+    return data + header_length;
+}
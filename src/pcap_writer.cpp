@@ -0,0 +1,303 @@
+/**
+ * @file pcap_writer.cpp
+ * @author Mateus Lima Alves (mateuslima.ti@gmail.com)
+ * @brief Streaming capture writer methods.
+ * @version 0.1
+ * @date 2022-04-06
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include <pcap_writer.hpp>
+#include <exceptions.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+
+/**
+ * @brief Writes a whole buffer to a file, across partial writes.
+ *
+ * @param file_descriptor
+ * @param data
+ * @param length
+ * @return true when every octet was written.
+ */
+static bool write_all(int file_descriptor, const uint8_t *data, size_t length)
+{
+    while (length)
+    {
+        ssize_t ret = ::write(file_descriptor, data, length);
+
+        if (ret < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return false;
+        }
+        data += ret;
+        length -= ret;
+    }
+    return true;
+}
+
+/**
+ * @brief Construct a new Pcap Writer:: Pcap Writer object
+ *
+ * @param path
+ * @param snaplen
+ */
+PcapWriter::PcapWriter(const char *path, uint32_t snaplen) :
+    file_descriptor{-1}, snaplen{snaplen}, active{nullptr, 0, 0}, stopping{false}, records{0},
+    dropped{0}
+{
+    pcap_file_header_t header = {PCAP_MAGIC_NANOSECONDS, PCAP_VERSION_MAJOR, PCAP_VERSION_MINOR, 0, 0,
+                                 snaplen, PCAP_LINKTYPE_RAW};
+
+    if (snaplen == 0 || snaplen + sizeof(pcap_record_header_t) > PCAP_BUFFER_LENGTH)
+    {
+        throw Exception(EXCEPTION_MSG("PCAP - Snap length invalid."));
+    }
+
+    this->file_descriptor = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (this->file_descriptor < 0)
+    {
+        throw Exception(EXCEPTION_MSG("PCAP - Could not create capture file."));
+    }
+    if (!write_all(this->file_descriptor, (const uint8_t *)&header, sizeof(header)))
+    {
+        close(this->file_descriptor);
+        throw Exception(EXCEPTION_MSG("PCAP - Could not write capture file header."));
+    }
+
+    this->storage.reset(new uint8_t[(size_t)PCAP_BUFFER_LENGTH * PCAP_BUFFERS]);
+    for (size_t i = 0; i < PCAP_BUFFERS; i++)
+    {
+        this->free_buffers.push_back(&this->storage[i * PCAP_BUFFER_LENGTH]);
+    }
+
+    this->thread = std::thread(&PcapWriter::run, this);
+}
+
+/**
+ * @brief Destroy the Pcap Writer:: Pcap Writer object
+ *
+ */
+PcapWriter::~PcapWriter()
+{
+    {
+        std::lock_guard<std::mutex> guard(this->mutex);
+        this->stopping = true;
+    }
+    this->full_condition.notify_one();
+    this->thread.join();
+    close(this->file_descriptor);
+}
+
+/**
+ * @brief Appends one datagram.
+ *
+ * @param data
+ * @param length
+ * @param timestamp
+ */
+void PcapWriter::write(const uint8_t *data, size_t length, uint64_t timestamp)
+{
+    std::unique_lock<std::mutex> lock(this->mutex);
+    size_t captured = std::min(length, (size_t)this->snaplen);
+
+    memcpy(this->reserve(lock, captured, length, timestamp), data, captured);
+}
+
+/**
+ * @brief Appends one datagram scattered over several buffers.
+ *
+ * @param vectors
+ * @param count
+ * @param timestamp
+ */
+void PcapWriter::write_gather(const struct iovec *vectors, size_t count, uint64_t timestamp)
+{
+    std::unique_lock<std::mutex> lock(this->mutex);
+    size_t length = 0, captured;
+    uint8_t *record;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        length += vectors[i].iov_len;
+    }
+    captured = std::min(length, (size_t)this->snaplen);
+    record = this->reserve(lock, captured, length, timestamp);
+    for (size_t i = 0; i < count && captured; i++)
+    {
+        size_t part = std::min(vectors[i].iov_len, captured);
+
+        memcpy(record, vectors[i].iov_base, part);
+        record += part;
+        captured -= part;
+    }
+}
+
+/**
+ * @brief Appends the frames of a send batch that were sent.
+ *
+ * @param frames
+ * @param count
+ * @param timestamp
+ */
+void PcapWriter::write_frames(const socket_frame_t *frames, size_t count, uint64_t timestamp)
+{
+    std::unique_lock<std::mutex> lock(this->mutex);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        const socket_frame_t *frame = &frames[i];
+        size_t length = 0, captured;
+        uint8_t *record;
+
+        if (frame->error != 0)
+        {
+            continue;
+        }
+        if (!frame->vectors_count)
+        {
+            captured = std::min(frame->length, (size_t)this->snaplen);
+            memcpy(this->reserve(lock, captured, frame->length, timestamp), frame->data, captured);
+            continue;
+        }
+
+        for (size_t j = 0; j < frame->vectors_count; j++)
+        {
+            length += frame->vectors[j].iov_len;
+        }
+        captured = std::min(length, (size_t)this->snaplen);
+        record = this->reserve(lock, captured, length, timestamp);
+        for (size_t j = 0; j < frame->vectors_count && captured; j++)
+        {
+            size_t part = std::min(frame->vectors[j].iov_len, captured);
+
+            memcpy(record, frame->vectors[j].iov_base, part);
+            record += part;
+            captured -= part;
+        }
+    }
+}
+
+/**
+ * @brief Get the number of records appended.
+ *
+ * @return uint64_t
+ */
+uint64_t PcapWriter::get_records()
+{
+    return this->records.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Get the number of records lost to file write errors.
+ *
+ * @return uint64_t
+ */
+uint64_t PcapWriter::get_dropped()
+{
+    return this->dropped.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Reserves room for a record in the active buffer and writes its
+ * header. Only waits when every buffer is waiting to be written.
+ *
+ * @param lock
+ * @param length
+ * @param original_length
+ * @param timestamp
+ * @return uint8_t*
+ */
+uint8_t *PcapWriter::reserve(std::unique_lock<std::mutex> &lock, size_t length, size_t original_length,
+                             uint64_t timestamp)
+{
+    pcap_record_header_t header = {(uint32_t)(timestamp / 1000000000ULL),
+                                   (uint32_t)(timestamp % 1000000000ULL), (uint32_t)length,
+                                   (uint32_t)original_length};
+    size_t record_length = sizeof(header) + length;
+    uint8_t *record;
+
+    if (this->active.data && this->active.length + record_length > PCAP_BUFFER_LENGTH)
+    {
+        this->hand_off();
+    }
+    if (!this->active.data)
+    {
+        this->free_condition.wait(lock, [this] { return !this->free_buffers.empty(); });
+        this->active.data = this->free_buffers.back();
+        this->free_buffers.pop_back();
+    }
+
+    record = this->active.data + this->active.length;
+    memcpy(record, &header, sizeof(header));
+    this->active.length += record_length;
+    this->active.records++;
+    this->records.store(this->records.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    return record + sizeof(header);
+}
+
+/**
+ * @brief Hands the active buffer to the flush thread.
+ *
+ */
+void PcapWriter::hand_off()
+{
+    this->full_buffers.push_back(this->active);
+    this->active = {nullptr, 0, 0};
+    this->full_condition.notify_one();
+}
+
+/**
+ * @brief Flush thread loop. Wakes up when a buffer is full, and every
+ * PCAP_FLUSH_INTERVAL to hand off a partly used buffer, so a slow capture
+ * still reaches the file. Buffers are written without holding the lock.
+ *
+ */
+void PcapWriter::run()
+{
+    std::unique_lock<std::mutex> lock(this->mutex);
+
+    for (;;)
+    {
+        bool stopping;
+
+        this->full_condition.wait_for(lock, std::chrono::milliseconds(PCAP_FLUSH_INTERVAL), [this] {
+            return !this->full_buffers.empty() || this->stopping;
+        });
+        stopping = this->stopping;
+        if ((this->full_buffers.empty() || stopping) && this->active.length)
+        {
+            this->hand_off();
+        }
+
+        while (!this->full_buffers.empty())
+        {
+            pcap_buffer_t buffer = this->full_buffers.front();
+
+            this->full_buffers.pop_front();
+            lock.unlock();
+            if (!write_all(this->file_descriptor, buffer.data, buffer.length))
+            {
+                this->dropped.fetch_add(buffer.records, std::memory_order_relaxed);
+            }
+            lock.lock();
+            this->free_buffers.push_back(buffer.data);
+            this->free_condition.notify_all();
+        }
+
+        if (stopping)
+        {
+            break;
+        }
+    }
+}
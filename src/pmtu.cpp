@@ -0,0 +1,406 @@
+/**
+ * @file pmtu.cpp
+ * @author Mateus Lima Alves (mateuslima.ti@gmail.com)
+ * @brief Path MTU discovery engine and cache methods.
+ * @version 0.1
+ * @date 2022-04-03
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include <pmtu.hpp>
+#include <icmp.hpp>
+#include <icmp_message.hpp>
+#include <ipv4_view.hpp>
+#include <icmp_view.hpp>
+#include <utils.hpp>
+#include <metrics.hpp>
+#include <exceptions.hpp>
+#include <algorithm>
+
+/**
+ * @brief Sizes probed in the first round, the common MTU plateaus of rfc1191
+ * below the largest size probed, which is probed as well.
+ *
+ */
+static const uint16_t pmtu_plateaus[] = {PMTU_MIN, 576, 1280, 1492, 1500, 4352, 8166};
+
+/**
+ * @brief Construct a new Pmtu Cache:: Pmtu Cache object
+ *
+ * @param expiry
+ */
+PmtuCache::PmtuCache(uint64_t expiry) :
+    expiry{expiry}
+{
+}
+
+/**
+ * @brief Destroy the Pmtu Cache:: Pmtu Cache object
+ *
+ */
+PmtuCache::~PmtuCache()
+{
+}
+
+/**
+ * @brief Get the path MTU to a destination, zero when unknown or expired.
+ *
+ * @param destination_address
+ * @param now
+ * @return uint16_t
+ */
+uint16_t PmtuCache::get(uint32_t destination_address, uint64_t now)
+{
+    auto entry = this->entries.find(destination_address);
+
+    if (entry == this->entries.end() || entry->second.expires <= now)
+    {
+        return 0;
+    }
+    return entry->second.mtu;
+}
+
+/**
+ * @brief Set the path MTU to a destination.
+ *
+ * @param destination_address
+ * @param mtu
+ * @param now
+ */
+void PmtuCache::set(uint32_t destination_address, uint16_t mtu, uint64_t now)
+{
+    this->entries[destination_address] = {mtu, now + this->expiry};
+}
+
+/**
+ * @brief Get the number of cached destinations.
+ *
+ * @return size_t
+ */
+size_t PmtuCache::size()
+{
+    return this->entries.size();
+}
+
+/**
+ * @brief Construct a new Pmtu:: Pmtu object
+ *
+ * @param socket
+ * @param source_address
+ * @param in_flight
+ * @param timeout
+ * @param max_mtu
+ * @param cache
+ */
+Pmtu::Pmtu(Socket &socket, uint32_t source_address, size_t in_flight, int timeout,
+           uint16_t max_mtu, PmtuCache *cache) :
+    ProbeEngine(socket, in_flight, timeout), max_mtu{max_mtu}, cache{cache}, source{nullptr},
+    exhausted{true}, callback{nullptr}, target_count{0}
+{
+    if (max_mtu < PMTU_MIN)
+    {
+        throw Exception(EXCEPTION_MSG("PMTU - Largest datagram probed is below the minimum MTU."));
+    }
+
+    this->ipv4.set_protocol_number(ICMP_NUMBER);
+    this->ipv4.set_source_address(source_address);
+
+    this->payload.resize(max_mtu);
+    this->set_frame_size(max_mtu);
+}
+
+/**
+ * @brief Destroy the Pmtu:: Pmtu object
+ *
+ */
+Pmtu::~Pmtu()
+{
+}
+
+/**
+ * @brief Discovers the path MTU of every target. Targets are started as the
+ * window has room, each one running its rounds independently of the others.
+ *
+ * @param source
+ * @param callback
+ */
+void Pmtu::run(TargetSource &source, const pmtu_callback_t &callback)
+{
+    source.rewind();
+    this->source = &source;
+    this->exhausted = false;
+    this->callback = &callback;
+    this->states.clear();
+    this->pending.clear();
+    this->target_count = 0;
+
+    this->run_window();
+
+    this->source = nullptr;
+    this->callback = nullptr;
+}
+
+/**
+ * @brief Get the number of targets of the last run.
+ *
+ * @return size_t
+ */
+size_t Pmtu::get_targets()
+{
+    return this->target_count;
+}
+
+/**
+ * @brief Queues the next round of a target. The first round probes the
+ * plateaus, the next ones split (lower, upper] evenly, upper always
+ * included: after a FRAGMENTATION_NEEDED, upper is the reported next-hop
+ * MTU, which usually ends the search.
+ *
+ * @param target
+ */
+void Pmtu::plan(size_t target)
+{
+    pmtu_state_t &state = this->states[target];
+    uint32_t destination_address = state.destination_address;
+    uint16_t sizes[PMTU_PROBES];
+    size_t count = 0;
+
+    if (state.rounds == 0)
+    {
+        uint16_t cached = this->cache ? this->cache->get(destination_address, get_timestamp()) : 0;
+
+        if (cached)
+        {
+            pmtu_result_t result = {target, destination_address, PMTU_CACHED, cached, 0, 0, 0};
+            this->states.erase(target);
+            (*this->callback)(result);
+            return;
+        }
+        for (uint16_t plateau : pmtu_plateaus)
+        {
+            if (plateau < this->max_mtu)
+            {
+                sizes[count++] = plateau;
+            }
+        }
+        sizes[count++] = this->max_mtu;
+    }
+    else if (state.lower == 0 || state.lower >= state.upper || state.rounds >= PMTU_MAX_ROUNDS)
+    {
+        pmtu_result_t result = {target, destination_address,
+                                state.lower ? PMTU_FOUND : PMTU_UNREACHABLE, state.lower,
+                                state.next_hop_mtu, state.reporter, state.rounds};
+
+        if (this->cache && state.lower)
+        {
+            this->cache->set(destination_address, state.lower, get_timestamp());
+        }
+        this->states.erase(target);
+        (*this->callback)(result);
+        return;
+    }
+    else
+    {
+        size_t span = state.upper - state.lower;
+        size_t splits = std::min((size_t)PMTU_PROBES, span);
+
+        /* Rounded up, so the sizes are distinct and the last one is upper. */
+        for (size_t i = 1; i <= splits; i++)
+        {
+            sizes[count++] = (uint16_t)(state.lower + (span * i + splits - 1) / splits);
+        }
+    }
+
+    state.rounds++;
+    state.outstanding = (uint16_t)count;
+    for (size_t i = 0; i < count; i++)
+    {
+        this->pending.push_back({((uint64_t)target << 16) | sizes[i], destination_address, 0});
+    }
+}
+
+/**
+ * @brief Records the outcome of a probe. A probe that did not get through
+ * only lowers upper when it is bigger than a size already answered, a lost
+ * reply can not undo a size known to work.
+ *
+ * @param target
+ * @param size
+ * @param answered
+ */
+void Pmtu::resolve(size_t target, uint16_t size, bool answered)
+{
+    pmtu_state_t &state = this->states[target];
+
+    if (answered)
+    {
+        state.lower = std::max(state.lower, size);
+        state.upper = std::max(state.upper, state.lower);
+    }
+    else if (size > state.lower)
+    {
+        state.upper = std::min(state.upper, (uint16_t)(size - 1));
+    }
+
+    if (--state.outstanding == 0)
+    {
+        this->plan(target);
+    }
+}
+
+/**
+ * @brief Whether there are rounds queued or targets left to start.
+ *
+ * @return true
+ * @return false
+ */
+bool Pmtu::has_probes()
+{
+    return !this->pending.empty() || !this->exhausted;
+}
+
+/**
+ * @brief Get the next probes. Queued rounds go first, then new targets are
+ * read from the source and started.
+ *
+ * @param probes
+ * @param max
+ * @return size_t
+ */
+size_t Pmtu::next_probes(engine_probe_t *probes, size_t max)
+{
+    size_t count = 0;
+    uint32_t destination_address;
+
+    while (count < max)
+    {
+        if (this->pending.empty())
+        {
+            if (this->exhausted || this->source->next(&destination_address, 1) == 0)
+            {
+                this->exhausted = true;
+                break;
+            }
+            this->states[this->target_count] = {destination_address, 0, this->max_mtu, 0, 0, 0, 0};
+            this->plan(this->target_count++);
+            continue;
+        }
+        probes[count++] = this->pending.front();
+        this->pending.pop_front();
+    }
+    return count;
+}
+
+/**
+ * @brief Encodes a probe. Probes differ in size, so each one is encoded into
+ * its frame; their payload is shared.
+ *
+ * @param probe
+ * @param sequence_number
+ * @param buffer
+ * @return size_t
+ */
+size_t Pmtu::encode(const engine_probe_t &probe, uint16_t sequence_number, uint8_t *buffer)
+{
+    size_t header_length = this->ipv4.get_header_length();
+    uint16_t size = (uint16_t)probe.target;
+    IcmpMessage<ECHO> icmp;
+
+    icmp.set_identifier(this->identifier);
+    icmp.set_sequence_number(sequence_number);
+    icmp.set_payload(this->payload.data(), size - header_length - IcmpMessage<ECHO>::HEADER_LENGTH);
+    this->ipv4.set_destination_address(probe.destination_address);
+    icmp.encode_into(buffer + header_length, this->max_mtu - header_length);
+    this->ipv4.encode_header_into(buffer, this->max_mtu, icmp.get_length());
+    return size;
+}
+
+/**
+ * @brief Matches a received datagram against the probes in flight. The
+ * record target packs the target index and the probe size.
+ *
+ * @param data
+ * @param length
+ * @param timestamp
+ */
+void Pmtu::handle_reply(const uint8_t *data, size_t length, uint64_t timestamp)
+{
+    Ipv4View ipv4, quoted;
+    IcmpView icmp, quoted_icmp;
+    probe_record_t record;
+    size_t target;
+    uint16_t size, next_hop_mtu;
+
+    if (!ipv4.parse(data, length) || ipv4.get_protocol_number() != ICMP_NUMBER ||
+        !icmp.parse(ipv4.get_data(), ipv4.get_data_length()))
+    {
+        return;
+    }
+
+    if (icmp.get_type() == ECHO_REPLY)
+    {
+        if (icmp.get_identifier() != this->identifier ||
+            this->match(ipv4.get_source_address(), icmp.get_sequence_number(), &record) !=
+            PROBE_MATCHED)
+        {
+            return;
+        }
+        Metrics::get_rtt().record(
+            timestamp > record.sent_timestamp ? timestamp - record.sent_timestamp : 0);
+        this->resolve(record.target >> 16, (uint16_t)record.target, true);
+        return;
+    }
+
+    if (icmp.get_type() != DESTINATION_UNREACHABLE || icmp.get_code() != FRAGMENTATION_NEEDED ||
+        !icmp.get_quoted_datagram(&quoted) || quoted.get_protocol_number() != ICMP_NUMBER ||
+        !quoted_icmp.parse(quoted.get_data(), quoted.get_data_length(), true) ||
+        quoted_icmp.get_type() != ECHO || quoted_icmp.get_identifier() != this->identifier ||
+        this->match(quoted.get_destination_address(), quoted_icmp.get_sequence_number(), &record) !=
+        PROBE_MATCHED)
+    {
+        return;
+    }
+    target = record.target >> 16;
+    size = (uint16_t)record.target;
+
+    /* Routers predating rfc1191 report zero, leaving the search to the rounds. */
+    next_hop_mtu = icmp.get_next_hop_mtu();
+    if (next_hop_mtu >= PMTU_MIN && next_hop_mtu < size)
+    {
+        pmtu_state_t &state = this->states[target];
+
+        state.upper = std::max(std::min(state.upper, next_hop_mtu), state.lower);
+        if (state.next_hop_mtu == 0 || next_hop_mtu < state.next_hop_mtu)
+        {
+            state.next_hop_mtu = next_hop_mtu;
+            state.reporter = ipv4.get_source_address();
+        }
+    }
+    this->resolve(target, size, false);
+}
+
+/**
+ * @brief Handles a probe timeout: a path that drops big datagrams without
+ * reporting it (black hole) is found by the rounds as well.
+ *
+ * @param destination_address
+ * @param record
+ */
+void Pmtu::handle_timeout(uint32_t destination_address, const probe_record_t &record)
+{
+    (void)destination_address;
+    this->resolve(record.target >> 16, (uint16_t)record.target, false);
+}
+
+/**
+ * @brief Handles a probe that could not be sent, usually EMSGSIZE: bigger
+ * than the MTU of the outgoing interface.
+ *
+ * @param probe
+ */
+void Pmtu::handle_send_error(const engine_probe_t &probe)
+{
+    this->resolve(probe.target >> 16, (uint16_t)probe.target, false);
+}
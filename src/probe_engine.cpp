@@ -0,0 +1,227 @@
+/**
+ * @file probe_engine.cpp
+ * @author Mateus Lima Alves (mateuslima.ti@gmail.com)
+ * @brief Probe window methods.
+ * @version 0.1
+ * @date 2022-04-02
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include <probe_engine.hpp>
+#include <utils.hpp>
+#include <metrics.hpp>
+#include <algorithm>
+#include <unistd.h>
+
+/**
+ * @brief Construct a new Probe Engine:: Probe Engine object
+ *
+ * @param socket
+ * @param in_flight
+ * @param timeout
+ */
+ProbeEngine::ProbeEngine(Socket &socket, size_t in_flight, int timeout) :
+    socket(socket), sequence_number{0}, max_in_flight{in_flight},
+    timeout{(uint64_t)timeout * 1000000ULL}, table(in_flight), wheel(in_flight, get_monotonic_timestamp())
+{
+    this->identifier = (uint16_t)getpid();
+    this->frames.resize(SOCKET_BATCH_MAX);
+    this->probes.resize(SOCKET_BATCH_MAX);
+    this->sequences.resize(SOCKET_BATCH_MAX);
+
+    this->socket.enable_receive();
+}
+
+/**
+ * @brief Destroy the Probe Engine:: Probe Engine object
+ *
+ */
+ProbeEngine::~ProbeEngine()
+{
+}
+
+/**
+ * @brief Interleaves sends with the receive loop, so the window stays full
+ * until the last probe is sent.
+ *
+ */
+void ProbeEngine::run_window()
+{
+    receive_callback_t receive_callback = [this](const uint8_t *data, size_t length, uint64_t timestamp) {
+        this->handle_reply(data, length, timestamp);
+    };
+    timer_callback_t timer_callback = [this](uint64_t data) {
+        this->expire(data);
+    };
+
+    this->table.clear();
+    while (this->has_probes() || this->table.get_in_flight() > 0)
+    {
+        this->send_window();
+        Metrics::get_instance().set_in_flight(this->table.get_in_flight());
+        this->socket.receive(this->get_wait_timeout(get_monotonic_timestamp()), receive_callback);
+        this->wheel.advance(get_monotonic_timestamp(), timer_callback);
+    }
+    Metrics::get_instance().set_in_flight(0);
+}
+
+/**
+ * @brief Allocates the frames of a send batch.
+ *
+ * @param frame_size
+ */
+void ProbeEngine::set_frame_size(size_t frame_size)
+{
+    this->pool = std::make_unique<PacketPool>(frame_size, SOCKET_BATCH_MAX);
+}
+
+/**
+ * @brief Matches a reply against the probes in flight.
+ *
+ * @param destination_address
+ * @param sequence_number
+ * @param record
+ * @return probe_match_t
+ */
+probe_match_t ProbeEngine::match(uint32_t destination_address, uint16_t sequence_number,
+                                 probe_record_t *record)
+{
+    probe_match_t result = this->table.match(destination_address, this->identifier, sequence_number,
+                                             record);
+
+    if (result == PROBE_MATCHED)
+    {
+        this->wheel.cancel(record->timer);
+        Metrics::add(Metrics::get_counters().replies);
+    }
+    return result;
+}
+
+/**
+ * @brief Nothing to prepare by default.
+ *
+ * @param now
+ */
+void ProbeEngine::prepare_batch(uint64_t now)
+{
+    (void)now;
+}
+
+/**
+ * @brief Sends one batch of up to SOCKET_BATCH_MAX probes, if the window has
+ * room. Only one batch is sent per loop iteration, so the replies are
+ * drained before they overflow the socket receive buffer.
+ *
+ */
+void ProbeEngine::send_window()
+{
+    size_t room, count;
+    uint64_t now, deadline;
+
+    if (!this->has_probes() || this->table.get_in_flight() >= this->max_in_flight)
+    {
+        return;
+    }
+    room = std::min((size_t)SOCKET_BATCH_MAX, this->max_in_flight - this->table.get_in_flight());
+    count = this->next_probes(this->probes.data(), room);
+    if (count == 0)
+    {
+        return;
+    }
+
+    now = get_timestamp();
+    this->prepare_batch(now);
+    for (size_t i = 0; i < count; i++)
+    {
+        uint32_t destination_address = this->probes[i].destination_address;
+        uint8_t *buffer = this->pool->acquire();
+
+        /* The sequence number wraps: numbers still in flight to the
+         * destination are skipped. There are at most 65535 in flight,
+         * this batch included, so one is always free and it is not used
+         * by an earlier probe of the batch. */
+        do
+        {
+            this->sequences[i] = this->sequence_number++;
+        } while (this->table.is_in_flight(destination_address, this->identifier, this->sequences[i]));
+
+        this->frames[i].data = buffer;
+        this->frames[i].length = this->encode(this->probes[i], this->sequences[i], buffer);
+        this->frames[i].destination_address = destination_address;
+    }
+    Metrics::add(Metrics::get_counters().encoded, count);
+    Metrics::get_encode_latency().record(get_timestamp() - now);
+
+    /* The send time is compared with the kernel receive timestamps, the
+     * deadline must not move when the wall clock is set. */
+    now = get_timestamp();
+    deadline = get_monotonic_timestamp() + this->timeout;
+    this->socket.send_batch(this->frames.data(), count);
+    for (size_t i = 0; i < count; i++)
+    {
+        this->pool->release((uint8_t *)this->frames[i].data);
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        uint32_t destination_address = this->probes[i].destination_address;
+        probe_record_t *record = nullptr;
+
+        if (this->frames[i].error == 0)
+        {
+            record = this->table.insert(destination_address, this->identifier, this->sequences[i]);
+        }
+        if (record == nullptr)
+        {
+            this->handle_send_error(this->probes[i]);
+            continue;
+        }
+
+        record->sent_timestamp = now;
+        record->target = this->probes[i].target;
+        record->retries = this->probes[i].retries;
+        record->timer = this->wheel.schedule(deadline,
+                                             ((uint64_t)destination_address << 16) | this->sequences[i]);
+    }
+}
+
+/**
+ * @brief Handles a probe timeout.
+ *
+ * @param data
+ */
+void ProbeEngine::expire(uint64_t data)
+{
+    uint32_t destination_address = (uint32_t)(data >> 16);
+    probe_record_t record;
+
+    if (!this->table.expire(destination_address, this->identifier, (uint16_t)data, &record))
+    {
+        return;
+    }
+    Metrics::add(Metrics::get_counters().timeouts);
+    this->handle_timeout(destination_address, record);
+}
+
+/**
+ * @brief Get the milliseconds to wait on the socket: none while there are
+ * probes to send and the window has room, otherwise until the timing wheel
+ * has timers to expire.
+ *
+ * @param now
+ * @return int
+ */
+int ProbeEngine::get_wait_timeout(uint64_t now)
+{
+    int timeout;
+
+    if (this->has_probes() && this->table.get_in_flight() < this->max_in_flight)
+    {
+        return 0;
+    }
+
+    timeout = this->wheel.get_wait_timeout(now);
+    return timeout < 0 ? 0 : timeout;
+}
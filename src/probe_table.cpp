@@ -0,0 +1,310 @@
+/**
+ * @file probe_table.cpp
+ * @author Mateus Lima Alves (mateuslima.ti@gmail.com)
+ * @brief In-flight probe table class methods.
+ * @version 0.1
+ * @date 2022-03-24
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include <probe_table.hpp>
+#include <exceptions.hpp>
+
+/**
+ * @brief Fibonacci hashing multiplier (2^64 / golden ratio).
+ *
+ */
+#define PROBE_TABLE_MULTIPLIER  0x9E3779B97F4A7C15ULL
+
+/**
+ * @brief Slots per probe in flight. Retired records are as many as the
+ * probes in flight, so the table is never more than half full.
+ *
+ */
+#define PROBE_TABLE_LOAD        4U
+
+/**
+ * @brief Construct a new Probe Table:: Probe Table object
+ *
+ * @param max_in_flight
+ */
+ProbeTable::ProbeTable(size_t max_in_flight) :
+    max_in_flight{max_in_flight}, in_flight{0}, retired_head{0}, retired_count{0}
+{
+    size_t capacity = 16;
+    unsigned bits = 4;
+
+    if (max_in_flight == 0 || max_in_flight > PROBE_TABLE_MAX_IN_FLIGHT)
+    {
+        throw Exception(EXCEPTION_MSG("PROBE TABLE - Probes in flight must be between 1 and 65535."));
+    }
+
+    while (capacity < max_in_flight * PROBE_TABLE_LOAD)
+    {
+        capacity <<= 1;
+        bits++;
+    }
+
+    this->records.assign(capacity, probe_record_t());
+    this->mask = capacity - 1;
+    this->shift = 64 - bits;
+    this->retired.resize(max_in_flight);
+}
+
+/**
+ * @brief Destroy the Probe Table:: Probe Table object
+ *
+ */
+ProbeTable::~ProbeTable()
+{
+}
+
+/**
+ * @brief Registers a probe just sent.
+ *
+ * @param destination_address
+ * @param identifier
+ * @param sequence_number
+ * @return probe_record_t*
+ */
+probe_record_t *ProbeTable::insert(uint32_t destination_address, uint16_t identifier,
+                                   uint16_t sequence_number)
+{
+    uint64_t key = make_key(destination_address, identifier, sequence_number);
+    size_t slot;
+
+    if (this->in_flight >= this->max_in_flight)
+    {
+        return nullptr;
+    }
+
+    slot = (size_t)((key * PROBE_TABLE_MULTIPLIER) >> this->shift);
+    while (this->records[slot].state != PROBE_FREE && this->records[slot].key != key)
+    {
+        slot = (slot + 1) & this->mask;
+    }
+
+    /* A retired record with the same key is simply reused. One in flight is
+     * not: its probe would never get a result and its timer would expire
+     * the new one. */
+    if (this->records[slot].state == PROBE_IN_FLIGHT)
+    {
+        return nullptr;
+    }
+    this->in_flight++;
+
+    this->records[slot].key = key;
+    this->records[slot].sent_timestamp = 0;
+    this->records[slot].target = 0;
+    this->records[slot].timer = 0;
+    this->records[slot].retries = 0;
+    this->records[slot].state = PROBE_IN_FLIGHT;
+    return &this->records[slot];
+}
+
+/**
+ * @brief Whether a probe is in flight.
+ *
+ * @param destination_address
+ * @param identifier
+ * @param sequence_number
+ * @return true
+ * @return false
+ */
+bool ProbeTable::is_in_flight(uint32_t destination_address, uint16_t identifier, uint16_t sequence_number)
+{
+    size_t slot = this->find(make_key(destination_address, identifier, sequence_number));
+
+    return slot <= this->mask && this->records[slot].state == PROBE_IN_FLIGHT;
+}
+
+/**
+ * @brief Matches a reply, marking its probe as answered.
+ *
+ * @param source_address
+ * @param identifier
+ * @param sequence_number
+ * @param record
+ * @return probe_match_t
+ */
+probe_match_t ProbeTable::match(uint32_t source_address, uint16_t identifier,
+                                uint16_t sequence_number, probe_record_t *record)
+{
+    size_t slot = this->find(make_key(source_address, identifier, sequence_number));
+
+    if (slot > this->mask)
+    {
+        return PROBE_UNKNOWN;
+    }
+
+    *record = this->records[slot];
+    switch (record->state)
+    {
+    case PROBE_IN_FLIGHT:
+    {
+        this->retire(slot, PROBE_ANSWERED);
+        return PROBE_MATCHED;
+    }
+    case PROBE_ANSWERED:
+    {
+        return PROBE_DUPLICATE;
+    }
+    case PROBE_EXPIRED:
+    default:
+    {
+        return PROBE_LATE;
+    }
+    }
+}
+
+/**
+ * @brief Marks a probe in flight as expired.
+ *
+ * @param destination_address
+ * @param identifier
+ * @param sequence_number
+ * @param record
+ * @return true when the probe was in flight.
+ */
+bool ProbeTable::expire(uint32_t destination_address, uint16_t identifier,
+                        uint16_t sequence_number, probe_record_t *record)
+{
+    size_t slot = this->find(make_key(destination_address, identifier, sequence_number));
+
+    if (slot > this->mask || this->records[slot].state != PROBE_IN_FLIGHT)
+    {
+        return false;
+    }
+
+    *record = this->records[slot];
+    this->retire(slot, PROBE_EXPIRED);
+    return true;
+}
+
+/**
+ * @brief Get the number of probes in flight.
+ *
+ * @return size_t
+ */
+size_t ProbeTable::get_in_flight()
+{
+    return this->in_flight;
+}
+
+/**
+ * @brief Forgets every probe.
+ *
+ */
+void ProbeTable::clear()
+{
+    for (auto it = this->records.begin(); it != this->records.end(); ++it)
+    {
+        it->state = PROBE_FREE;
+    }
+    this->in_flight = 0;
+    this->retired_head = 0;
+    this->retired_count = 0;
+}
+
+/**
+ * @brief Packs a probe key.
+ *
+ * @param address
+ * @param identifier
+ * @param sequence_number
+ * @return uint64_t
+ */
+uint64_t ProbeTable::make_key(uint32_t address, uint16_t identifier, uint16_t sequence_number)
+{
+    return ((uint64_t)address << 32) | ((uint32_t)identifier << 16) | sequence_number;
+}
+
+/**
+ * @brief Finds the slot of a key.
+ *
+ * @param key
+ * @return size_t
+ */
+size_t ProbeTable::find(uint64_t key)
+{
+    size_t slot = (size_t)((key * PROBE_TABLE_MULTIPLIER) >> this->shift);
+
+    while (this->records[slot].state != PROBE_FREE)
+    {
+        if (this->records[slot].key == key)
+        {
+            return slot;
+        }
+        slot = (slot + 1) & this->mask;
+    }
+    return this->records.size();
+}
+
+/**
+ * @brief Frees a slot with backward shift deletion: every following record
+ * of the cluster that would not be found anymore moves into the hole.
+ *
+ * @param slot
+ */
+void ProbeTable::erase(size_t slot)
+{
+    size_t hole = slot, next = slot;
+
+    for (;;)
+    {
+        size_t home;
+
+        this->records[hole].state = PROBE_FREE;
+        for (;;)
+        {
+            next = (next + 1) & this->mask;
+            if (this->records[next].state == PROBE_FREE)
+            {
+                return;
+            }
+            home = (size_t)((this->records[next].key * PROBE_TABLE_MULTIPLIER) >> this->shift);
+            /* The record stays when its home lies cyclically in (hole, next]. */
+            if (hole <= next ? (hole < home && home <= next) : (hole < home || home <= next))
+            {
+                continue;
+            }
+            break;
+        }
+        this->records[hole] = this->records[next];
+        hole = next;
+    }
+}
+
+/**
+ * @brief Moves a record out of flight and keeps it as retired.
+ *
+ * @param slot
+ * @param state
+ */
+void ProbeTable::retire(size_t slot, probe_state_t state)
+{
+    uint64_t key = this->records[slot].key;
+
+    /* Make room first, while the record is still in flight, since its key
+     * may be the oldest retired one as well. Erasing may move the record. */
+    if (this->retired_count == this->retired.size())
+    {
+        size_t oldest = this->find(this->retired[this->retired_head]);
+
+        /* The key may have been reused by a probe now in flight. */
+        if (oldest <= this->mask && this->records[oldest].state != PROBE_IN_FLIGHT)
+        {
+            this->erase(oldest);
+        }
+        this->retired_head = (this->retired_head + 1) % this->retired.size();
+        this->retired_count--;
+        slot = this->find(key);
+    }
+
+    this->records[slot].state = state;
+    this->in_flight--;
+    this->retired[(this->retired_head + this->retired_count) % this->retired.size()] = key;
+    this->retired_count++;
+}
@@ -0,0 +1,269 @@
+/**
+ * @file probe_template.cpp
+ * @author Mateus Lima Alves (mateuslima.ti@gmail.com)
+ * @brief Precompiled probe class methods.
+ * @version 0.1
+ * @date 2022-03-21
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include <probe_template.hpp>
+#include <checksum.hpp>
+#include <exceptions.hpp>
+
+/**
+ * @brief Construct a new Probe Template:: Probe Template object
+ *
+ * @param ipv4 IPv4 header of every probe.
+ * @param icmp ICMP packet of every probe.
+ */
+ProbeTemplate::ProbeTemplate(Ipv4 &ipv4, Icmp &icmp) :
+    payload{nullptr}, payload_length{0}
+{
+    if (!icmp_has_sequence(icmp.get_type()))
+    {
+        throw Exception(EXCEPTION_MSG("PROBE - This packet type don't have identifier and sequence number."));
+    }
+
+    this->icmp_offset = ipv4.get_header_length();
+    this->frame.resize(this->icmp_offset + icmp.get_length());
+    ipv4.encode_into(this->frame.data(), this->frame.size(), icmp);
+}
+
+/**
+ * @brief Destroy the Probe Template:: Probe Template object
+ *
+ */
+ProbeTemplate::~ProbeTemplate()
+{
+}
+
+/**
+ * @brief Get the destination address object
+ *
+ * @return uint32_t
+ */
+uint32_t ProbeTemplate::get_destination_address()
+{
+    return __builtin_bswap32(((uint32_t)this->read_word(IP_DESTINATION_OFFSET) << 16) |
+                             this->read_word(IP_DESTINATION_OFFSET + 2));
+}
+
+/**
+ * @brief Get the identifier object
+ *
+ * @return uint16_t
+ */
+uint16_t ProbeTemplate::get_identifier()
+{
+    return this->read_word(this->icmp_offset + ICMP_IDENTIFIER_OFFSET);
+}
+
+/**
+ * @brief Get the ttl object
+ *
+ * @return uint8_t
+ */
+uint8_t ProbeTemplate::get_ttl()
+{
+    return this->frame[IP_TTL_OFFSET];
+}
+
+/**
+ * @brief Get the sequence number object
+ *
+ * @return uint16_t
+ */
+uint16_t ProbeTemplate::get_sequence_number()
+{
+    return this->read_word(this->icmp_offset + ICMP_SEQUENCE_OFFSET);
+}
+
+/**
+ * @brief Set the destination address object. Only the header checksum
+ * covers it, since ICMP has no pseudo header.
+ *
+ * @param destination_address
+ */
+void ProbeTemplate::set_destination_address(uint32_t destination_address)
+{
+    destination_address = __builtin_bswap32(destination_address);
+    this->patch_word(IP_DESTINATION_OFFSET, (uint16_t)(destination_address >> 16),
+                     IP_CHECKSUM_OFFSET);
+    this->patch_word(IP_DESTINATION_OFFSET + 2, (uint16_t)destination_address,
+                     IP_CHECKSUM_OFFSET);
+}
+
+/**
+ * @brief Set the identifier object
+ *
+ * @param identifier
+ */
+void ProbeTemplate::set_identifier(uint16_t identifier)
+{
+    this->patch_word(this->icmp_offset + ICMP_IDENTIFIER_OFFSET, identifier,
+                     this->icmp_offset + ICMP_CHECKSUM_OFFSET);
+}
+
+/**
+ * @brief Set the ttl object, adjusting the header checksum. The ttl shares
+ * its 16 bit word with the protocol number.
+ *
+ * @param ttl
+ */
+void ProbeTemplate::set_ttl(uint8_t ttl)
+{
+    if (ttl == 0)
+    {
+        throw Exception(EXCEPTION_MSG("PROBE - Time to live must be at least one."));
+    }
+    this->patch_word(IP_TTL_OFFSET, (uint16_t)((ttl << 8) | this->frame[IP_PROTOCOL_OFFSET]),
+                     IP_CHECKSUM_OFFSET);
+}
+
+/**
+ * @brief Set the sequence number object
+ *
+ * @param sequence_number
+ */
+void ProbeTemplate::set_sequence_number(uint16_t sequence_number)
+{
+    this->patch_word(this->icmp_offset + ICMP_SEQUENCE_OFFSET, sequence_number,
+                     this->icmp_offset + ICMP_CHECKSUM_OFFSET);
+}
+
+/**
+ * @brief Set the originate timestamp of a TIMESTAMP probe, adjusting the
+ * ICMP checksum.
+ *
+ * @param originate
+ */
+void ProbeTemplate::set_originate_timestamp(uint32_t originate)
+{
+    if (this->frame[this->icmp_offset + ICMP_TYPE_OFFSET] != TIMESTAMP)
+    {
+        throw Exception(EXCEPTION_MSG("PROBE - This packet type don't have an originate timestamp."));
+    }
+    this->patch_word(this->icmp_offset + ICMP_ORIGINATE_OFFSET, (uint16_t)(originate >> 16),
+                     this->icmp_offset + ICMP_CHECKSUM_OFFSET);
+    this->patch_word(this->icmp_offset + ICMP_ORIGINATE_OFFSET + 2, (uint16_t)originate,
+                     this->icmp_offset + ICMP_CHECKSUM_OFFSET);
+}
+
+/**
+ * @brief Attaches a shared payload. The total length is patched
+ * incrementally, the ICMP checksum is summed again from the encoded ICMP
+ * packet and the payload partial sum, computed once here.
+ *
+ * @param payload
+ * @param length
+ */
+void ProbeTemplate::set_payload(const uint8_t *payload, size_t length)
+{
+    uint32_t sum;
+    uint16_t checksum;
+
+    if (payload == nullptr)
+    {
+        length = 0;
+    }
+    if (this->frame.size() + length > IP_MAX_LENGTH)
+    {
+        throw Exception(EXCEPTION_MSG("PROBE - Payload too long for an IPv4 datagram."));
+    }
+
+    this->patch_word(IP_TOTAL_LENGTH_OFFSET, (uint16_t)(this->frame.size() + length),
+                     IP_CHECKSUM_OFFSET);
+
+    this->frame[this->icmp_offset + ICMP_CHECKSUM_OFFSET] = 0;
+    this->frame[this->icmp_offset + ICMP_CHECKSUM_OFFSET + 1] = 0;
+    /* The encoded ICMP packet is made of 16 bit words, so its sum chains. */
+    sum = checksum_partial(&this->frame[this->icmp_offset], this->frame.size() - this->icmp_offset,
+                           length ? checksum_partial(payload, length) : 0);
+    checksum = checksum_fold(sum);
+    this->frame[this->icmp_offset + ICMP_CHECKSUM_OFFSET] = (uint8_t)(checksum >> 8);
+    this->frame[this->icmp_offset + ICMP_CHECKSUM_OFFSET + 1] = (uint8_t)checksum;
+
+    this->payload = length ? payload : nullptr;
+    this->payload_length = length;
+}
+
+/**
+ * @brief Get the encoded datagram.
+ *
+ * @return const uint8_t*
+ */
+const uint8_t *ProbeTemplate::data()
+{
+    return this->frame.data();
+}
+
+/**
+ * @brief Get the datagram length in octets.
+ *
+ * @return size_t
+ */
+size_t ProbeTemplate::get_length()
+{
+    return this->frame.size() + this->payload_length;
+}
+
+/**
+ * @brief Get the encoded datagram length in octets.
+ *
+ * @return size_t
+ */
+size_t ProbeTemplate::get_header_length()
+{
+    return this->frame.size();
+}
+
+/**
+ * @brief Fills the scatter-gather list of the datagram.
+ *
+ * @param vectors
+ * @return size_t
+ */
+size_t ProbeTemplate::get_vectors(struct iovec *vectors)
+{
+    vectors[0].iov_base = this->frame.data();
+    vectors[0].iov_len = this->frame.size();
+    if (this->payload == nullptr)
+    {
+        return 1;
+    }
+    vectors[1].iov_base = (void *)this->payload;
+    vectors[1].iov_len = this->payload_length;
+    return 2;
+}
+
+/**
+ * @brief Reads a big-endian 16 bit word of the datagram.
+ *
+ * @param offset
+ * @return uint16_t
+ */
+uint16_t ProbeTemplate::read_word(size_t offset)
+{
+    return (uint16_t)((this->frame[offset] << 8) | this->frame[offset + 1]);
+}
+
+/**
+ * @brief Writes a word and adjusts the checksum covering it.
+ *
+ * @param offset
+ * @param value
+ * @param checksum_offset
+ */
+void ProbeTemplate::patch_word(size_t offset, uint16_t value, size_t checksum_offset)
+{
+    uint16_t checksum = checksum_adjust(this->read_word(checksum_offset),
+                                        this->read_word(offset), value);
+
+    this->frame[offset] = (uint8_t)(value >> 8);
+    this->frame[offset + 1] = (uint8_t)value;
+    this->frame[checksum_offset] = (uint8_t)(checksum >> 8);
+    this->frame[checksum_offset + 1] = (uint8_t)checksum;
+}
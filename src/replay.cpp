@@ -0,0 +1,144 @@
+/**
+ * @file replay.cpp
+ * @author Mateus Lima Alves (mateuslima.ti@gmail.com)
+ * @brief Capture replay engine methods.
+ * @version 0.1
+ * @date 2022-04-07
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include <replay.hpp>
+#include <ipv4.hpp>
+#include <ipv4_view.hpp>
+#include <utils.hpp>
+#include <exceptions.hpp>
+#include <cstring>
+#include <time.h>
+
+/**
+ * @brief Construct a new Replay:: Replay object
+ *
+ * @param socket
+ * @param speed
+ */
+Replay::Replay(Socket &socket, double speed) :
+    socket(socket), speed{speed}, pending{0}
+{
+    if (!(speed >= 0))
+    {
+        throw Exception(EXCEPTION_MSG("REPLAY - Speed must not be negative."));
+    }
+    this->frames.resize(SOCKET_BATCH_MAX);
+}
+
+/**
+ * @brief Destroy the Replay:: Replay object
+ *
+ */
+Replay::~Replay()
+{
+}
+
+/**
+ * @brief Sends every ICMP datagram of the capture. Datagram i is due at
+ * start + (t_i - t_0) / speed; everything already due joins the pending
+ * batch, which is sent before waiting for a later datagram or once full.
+ * Capture times that go backwards (captures merged from several
+ * interfaces) count as no gap.
+ *
+ * @param reader
+ * @param stats
+ */
+void Replay::run(PcapReader &reader, replay_stats_t *stats)
+{
+    pcap_packet_t packet;
+    uint64_t start, first = 0, last = 0;
+
+    memset(stats, 0, sizeof(*stats));
+    this->pending = 0;
+
+    start = get_timestamp();
+    while (reader.next(&packet))
+    {
+        Ipv4View ipv4;
+
+        if (!ipv4.parse(packet.data, packet.length) || ipv4.get_protocol_number() != ICMP_NUMBER)
+        {
+            stats->skipped++;
+            continue;
+        }
+
+        if (stats->datagrams++ == 0)
+        {
+            first = last = packet.timestamp;
+        }
+        last = packet.timestamp > last ? packet.timestamp : last;
+
+        if (this->speed > 0)
+        {
+            uint64_t due = start + (uint64_t)((double)(last - first) / this->speed);
+
+            if (due > get_timestamp())
+            {
+                this->flush(stats);
+                this->wait_until(due);
+            }
+        }
+
+        this->frames[this->pending].data = packet.data;
+        this->frames[this->pending].length = ipv4.get_header_length() + ipv4.get_data_length();
+        this->frames[this->pending].vectors = nullptr;
+        this->frames[this->pending].vectors_count = 0;
+        this->frames[this->pending].destination_address = ipv4.get_destination_address();
+        if (++this->pending == SOCKET_BATCH_MAX)
+        {
+            this->flush(stats);
+        }
+    }
+    this->flush(stats);
+
+    stats->skipped += reader.get_skipped();
+    stats->capture_duration = last - first;
+    stats->duration = get_timestamp() - start;
+}
+
+/**
+ * @brief Sends the pending batch.
+ *
+ * @param stats
+ */
+void Replay::flush(replay_stats_t *stats)
+{
+    size_t sent;
+
+    if (!this->pending)
+    {
+        return;
+    }
+    sent = this->socket.send_batch(this->frames.data(), this->pending);
+    stats->sent += sent;
+    stats->send_errors += this->pending - sent;
+    this->pending = 0;
+}
+
+/**
+ * @brief Sleeps until REPLAY_SPIN before the deadline, then spins, since a
+ * sleep can overshoot by tens of microseconds.
+ *
+ * @param deadline
+ */
+void Replay::wait_until(uint64_t deadline)
+{
+    for (uint64_t now = get_timestamp(); now < deadline; now = get_timestamp())
+    {
+        if (deadline - now > REPLAY_SPIN)
+        {
+            uint64_t pause = deadline - now - REPLAY_SPIN;
+            struct timespec interval = {(time_t)(pause / 1000000000ULL), (long)(pause % 1000000000ULL)};
+
+            nanosleep(&interval, nullptr);
+        }
+    }
+}
@@ -0,0 +1,307 @@
+/**
+ * @file responder.cpp
+ * @author Mateus Lima Alves (mateuslima.ti@gmail.com)
+ * @brief ECHO responder methods.
+ * @version 0.1
+ * @date 2022-04-05
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include <responder.hpp>
+#include <icmp.hpp>
+#include <ipv4.hpp>
+#include <ipv4_view.hpp>
+#include <icmp_view.hpp>
+#include <checksum.hpp>
+#include <exceptions.hpp>
+#include <algorithm>
+#include <cstring>
+#include <pthread.h>
+#include <sched.h>
+#include <arpa/inet.h>
+
+/**
+ * @brief Writes a big-endian 16 bit word of a datagram and adjusts the
+ * checksum covering it.
+ *
+ * @param data Datagram.
+ * @param offset Offset of the word.
+ * @param value New value of the word.
+ * @param checksum_offset Offset of the checksum.
+ */
+static void patch_word(uint8_t *data, size_t offset, uint16_t value, size_t checksum_offset)
+{
+    uint16_t checksum = checksum_adjust((uint16_t)(data[checksum_offset] << 8 | data[checksum_offset + 1]),
+                                        (uint16_t)(data[offset] << 8 | data[offset + 1]), value);
+
+    data[offset] = (uint8_t)(value >> 8);
+    data[offset + 1] = (uint8_t)value;
+    data[checksum_offset] = (uint8_t)(checksum >> 8);
+    data[checksum_offset + 1] = (uint8_t)checksum;
+}
+
+/**
+ * @brief Construct a new Responder:: Responder object
+ *
+ * Every raw ICMP socket gets a copy of every datagram, so each worker
+ * socket has a BPF program that only accepts the ECHO requests whose
+ * identifier plus sequence number, modulo the number of workers, is its
+ * index. A ping stream is spread evenly over the workers and nothing else
+ * is ever copied to userspace.
+ *
+ * @param threads
+ */
+Responder::Responder(size_t threads) :
+    running{false}
+{
+    if (threads == 0)
+    {
+        threads = std::max(std::thread::hardware_concurrency(), 1U);
+    }
+    if (threads > RESPONDER_MAX_THREADS)
+    {
+        throw Exception(EXCEPTION_MSG("RESPONDER - Too many threads."));
+    }
+
+    this->counters.reset(new responder_counter_t[threads]);
+    for (size_t i = 0; i < threads; i++)
+    {
+        struct sock_filter program[] = {
+            /* X = internet header length. */
+            BPF_STMT(BPF_LDX | BPF_B | BPF_MSH, 0),
+            BPF_STMT(BPF_LD | BPF_B | BPF_IND, ICMP_TYPE_OFFSET),
+            BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ECHO, 0, 8),
+            BPF_STMT(BPF_LD | BPF_H | BPF_IND, ICMP_IDENTIFIER_OFFSET),
+            BPF_STMT(BPF_ST, 0),
+            BPF_STMT(BPF_LD | BPF_H | BPF_IND, ICMP_SEQUENCE_OFFSET),
+            BPF_STMT(BPF_LDX | BPF_MEM, 0),
+            BPF_STMT(BPF_ALU | BPF_ADD | BPF_X, 0),
+            BPF_STMT(BPF_ALU | BPF_MOD | BPF_K, (uint32_t)threads),
+            BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, (uint32_t)i, 0, 1),
+            BPF_STMT(BPF_RET | BPF_K, SOCKET_RECEIVE_LENGTH),
+            BPF_STMT(BPF_RET | BPF_K, 0)};
+
+        this->counters[i].replies = 0;
+        this->sockets.push_back(std::make_unique<Socket>());
+        this->sockets[i]->enable_receive();
+        this->sockets[i]->set_receive_filter(program, sizeof(program) / sizeof(program[0]));
+    }
+}
+
+/**
+ * @brief Destroy the Responder:: Responder object
+ *
+ */
+Responder::~Responder()
+{
+    this->stop();
+}
+
+/**
+ * @brief Starts the workers. Worker i is pinned to the i-th CPU the process
+ * may run on, wrapping around when there are more workers than CPUs.
+ *
+ */
+void Responder::start()
+{
+    std::vector<int> cpus;
+    cpu_set_t allowed;
+
+    if (!this->workers.empty())
+    {
+        return;
+    }
+
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0)
+    {
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+        {
+            if (CPU_ISSET(cpu, &allowed))
+            {
+                cpus.push_back(cpu);
+            }
+        }
+    }
+
+    this->error = nullptr;
+    this->running = true;
+    for (size_t i = 0; i < this->sockets.size(); i++)
+    {
+        this->workers.emplace_back(&Responder::work, this, i);
+        if (!cpus.empty())
+        {
+            cpu_set_t cpu;
+
+            CPU_ZERO(&cpu);
+            CPU_SET(cpus[i % cpus.size()], &cpu);
+            /* Best effort, an unpinned worker still answers. */
+            pthread_setaffinity_np(this->workers[i].native_handle(), sizeof(cpu), &cpu);
+        }
+    }
+}
+
+/**
+ * @brief Stops the workers and waits for them to return.
+ *
+ */
+void Responder::stop()
+{
+    this->running = false;
+    for (std::thread &worker : this->workers)
+    {
+        worker.join();
+    }
+    this->workers.clear();
+}
+
+/**
+ * @brief Whether the workers are running.
+ *
+ * @return true
+ * @return false
+ */
+bool Responder::is_running()
+{
+    return this->running.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Throws the error of the first worker that failed, if any.
+ *
+ */
+void Responder::check_error()
+{
+    std::lock_guard<std::mutex> lock(this->error_mutex);
+
+    if (this->error)
+    {
+        std::rethrow_exception(this->error);
+    }
+}
+
+/**
+ * @brief Get the number of workers.
+ *
+ * @return size_t
+ */
+size_t Responder::get_threads()
+{
+    return this->sockets.size();
+}
+
+/**
+ * @brief Get the number of replies sent by every worker so far.
+ *
+ * @return uint64_t
+ */
+uint64_t Responder::get_replies()
+{
+    uint64_t replies = 0;
+
+    for (size_t i = 0; i < this->sockets.size(); i++)
+    {
+        replies += this->counters[i].replies.load(std::memory_order_relaxed);
+    }
+    return replies;
+}
+
+/**
+ * @brief Rewrites an ECHO request into its ECHO_REPLY in place. Swapping the
+ * addresses leaves the IPv4 header sum unchanged, the time to live and the
+ * type are single words, so both checksums are patched instead of summed
+ * again. Requests to a multicast or broadcast address are not answered, as
+ * the kernel does by default.
+ *
+ * @param data
+ * @param length
+ * @param destination_address
+ * @return size_t
+ */
+size_t Responder::reply(uint8_t *data, size_t length, uint32_t *destination_address)
+{
+    Ipv4View ipv4;
+    IcmpView icmp;
+    uint32_t source_address, target_address;
+    size_t icmp_offset;
+
+    if (!ipv4.parse(data, length) || ipv4.get_protocol_number() != ICMP_NUMBER ||
+        !icmp.parse(ipv4.get_data(), ipv4.get_data_length()) || icmp.get_type() != ECHO)
+    {
+        return 0;
+    }
+
+    source_address = ipv4.get_source_address();
+    target_address = ipv4.get_destination_address();
+    if (IN_MULTICAST(ntohl(target_address)) || target_address == INADDR_BROADCAST)
+    {
+        return 0;
+    }
+
+    icmp_offset = ipv4.get_header_length();
+    memcpy(data + IP_SOURCE_OFFSET, &target_address, sizeof(target_address));
+    memcpy(data + IP_DESTINATION_OFFSET, &source_address, sizeof(source_address));
+    patch_word(data, IP_TTL_OFFSET, (uint16_t)(DEFAULT_TTL << 8 | ICMP_NUMBER), IP_CHECKSUM_OFFSET);
+    patch_word(data, icmp_offset + ICMP_TYPE_OFFSET, (uint16_t)(ECHO_REPLY << 8 | icmp.get_code()),
+               icmp_offset + ICMP_CHECKSUM_OFFSET);
+
+    *destination_address = source_address;
+    return icmp_offset + ipv4.get_data_length();
+}
+
+/**
+ * @brief Worker loop. Every received batch is rewritten in place and sent
+ * back with a single send_batch, straight from the socket receive buffers.
+ * A worker that fails records its error and stops the others, a responder
+ * missing a share of the requests must not keep running.
+ *
+ * @param index
+ */
+void Responder::work(size_t index)
+{
+    Socket &socket = *this->sockets[index];
+    std::atomic<uint64_t> &replies = this->counters[index].replies;
+    batch_callback_t callback = [&socket, &replies](socket_frame_t *frames, size_t count) {
+        size_t ready = 0;
+
+        for (size_t i = 0; i < count; i++)
+        {
+            uint32_t destination_address;
+            size_t length = Responder::reply((uint8_t *)frames[i].data, frames[i].length,
+                                             &destination_address);
+
+            if (length)
+            {
+                frames[ready] = frames[i];
+                frames[ready].length = length;
+                frames[ready].destination_address = destination_address;
+                ready++;
+            }
+        }
+        if (ready)
+        {
+            replies.store(replies.load(std::memory_order_relaxed) + socket.send_batch(frames, ready),
+                          std::memory_order_relaxed);
+        }
+    };
+
+    try
+    {
+        while (this->running.load(std::memory_order_relaxed))
+        {
+            socket.receive_batch(RESPONDER_WAIT_TIMEOUT, callback);
+        }
+    }
+    catch (...)
+    {
+        std::lock_guard<std::mutex> lock(this->error_mutex);
+
+        if (!this->error)
+        {
+            this->error = std::current_exception();
+        }
+        this->running = false;
+    }
+}
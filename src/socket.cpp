@@ -17,18 +17,31 @@
 #include <string.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <algorithm>
 
 #include <socket.hpp>
+#include <pcap_writer.hpp>
+#include <metrics.hpp>
+#include <utils.hpp>
 #include <exceptions.hpp>
 #include <iostream>
 
+/**
+ * @brief Capture writer every socket logs its datagrams to, null when none.
+ *
+ */
+std::atomic<PcapWriter *> Socket::capture{nullptr};
+
 /**
  * @brief Construct a new Socket:: Socket object
  *
  */
-Socket::Socket()
+Socket::Socket() :
+    s_file_descriptor{-1}, r_file_descriptor{-1}, e_file_descriptor{-1}, r_drops{0}
 {
-    int ret, fd, option;
+    int ret, fd, option = 1;
 
     fd = socket(AF_INET, SOCK_RAW, IPPROTO_RAW);
     if (fd < 0)
@@ -39,6 +52,7 @@ Socket::Socket()
     ret = setsockopt(fd, IPPROTO_IP, IP_HDRINCL, &option, sizeof(option));
     if (ret < 0)
     {
+        close(fd);
         throw Exception(EXCEPTION_MSG("Socket - Could not set socket options."));
     }
 
@@ -51,6 +65,18 @@ Socket::Socket()
  */
 Socket::~Socket()
 {
+    if (this->e_file_descriptor >= 0)
+    {
+        close(this->e_file_descriptor);
+    }
+    if (this->r_file_descriptor >= 0)
+    {
+        close(this->r_file_descriptor);
+    }
+    if (this->s_file_descriptor >= 0)
+    {
+        close(this->s_file_descriptor);
+    }
 }
 
 /**
@@ -59,19 +85,408 @@ Socket::~Socket()
  * @param raw 
  * @param destination_address 
  */
-void Socket::send_raw(std::vector<uint8_t> raw, uint32_t destination_address)
+void Socket::send_raw(const std::vector<uint8_t> &raw, uint32_t destination_address)
+{
+    this->send_raw(raw.data(), raw.size(), destination_address);
+}
+
+/**
+ * @brief Send a datagram held in a caller-owned buffer.
+ *
+ * @param raw Encoded datagram.
+ * @param length Datagram length in octets.
+ * @param destination_address Destination address, in network byte order.
+ */
+void Socket::send_raw(const uint8_t *raw, size_t length, uint32_t destination_address)
 {
     int bytes_sent;
     struct sockaddr_in localaddr;
+    PcapWriter *writer = Socket::capture.load(std::memory_order_relaxed);
+    uint64_t timestamp = writer ? get_timestamp() : 0;
     localaddr.sin_family = AF_INET;
     localaddr.sin_addr.s_addr = destination_address;
     localaddr.sin_port = 0; // Any local port will do
 
     /* Send packet */
-    bytes_sent = sendto(this->s_file_descriptor, raw.data(), raw.size(), 0,
+    bytes_sent = sendto(this->s_file_descriptor, raw, length, 0,
                         (struct sockaddr *)&localaddr, sizeof(localaddr));
     if (bytes_sent < 0)
     {
+        Metrics::add(Metrics::get_counters().send_errors);
         throw Exception(EXCEPTION_MSG("Socket - Could not send raw to destination."));
     }
+    Metrics::add(Metrics::get_counters().sent);
+    if (writer)
+    {
+        writer->write(raw, length, timestamp);
+    }
+}
+
+/**
+ * @brief Send a datagram scattered over several buffers with a single
+ * sendmsg call, so shared parts like a payload are never copied.
+ *
+ * @param vectors Buffers of the datagram, in order.
+ * @param count Number of buffers.
+ * @param destination_address Destination address, in network byte order.
+ */
+void Socket::send_gather(const struct iovec *vectors, size_t count, uint32_t destination_address)
+{
+    struct sockaddr_in address;
+    struct msghdr message;
+    PcapWriter *writer = Socket::capture.load(std::memory_order_relaxed);
+    uint64_t timestamp = writer ? get_timestamp() : 0;
+
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = destination_address;
+
+    memset(&message, 0, sizeof(message));
+    message.msg_name = &address;
+    message.msg_namelen = sizeof(address);
+    message.msg_iov = (struct iovec *)vectors;
+    message.msg_iovlen = count;
+
+    if (sendmsg(this->s_file_descriptor, &message, 0) < 0)
+    {
+        Metrics::add(Metrics::get_counters().send_errors);
+        throw Exception(EXCEPTION_MSG("Socket - Could not send gathered datagram to destination."));
+    }
+    Metrics::add(Metrics::get_counters().sent);
+    if (writer)
+    {
+        writer->write_gather(vectors, count, timestamp);
+    }
+}
+
+/**
+ * @brief Send several datagrams with as few sendmmsg calls as possible.
+ * Frames with a scatter-gather list are sent from it. It never throws, a
+ * message that could not be sent gets its errno stored in the frame error
+ * field and the remaining messages are still sent.
+ *
+ * @param frames Frames to be sent.
+ * @param count Number of frames.
+ * @return size_t Number of frames sent.
+ */
+size_t Socket::send_batch(socket_frame_t *frames, size_t count)
+{
+    struct mmsghdr messages[SOCKET_BATCH_MAX];
+    struct iovec vectors[SOCKET_BATCH_MAX];
+    struct sockaddr_in addresses[SOCKET_BATCH_MAX];
+    metrics_counters_t &counters = Metrics::get_counters();
+    size_t sent = 0, index = 0;
+    uint64_t start = get_timestamp();
+
+    while (index < count)
+    {
+        unsigned int length = (unsigned int)std::min(count - index, (size_t)SOCKET_BATCH_MAX);
+        int ret;
+
+        for (unsigned int i = 0; i < length; i++)
+        {
+            socket_frame_t *frame = &frames[index + i];
+
+            addresses[i].sin_family = AF_INET;
+            addresses[i].sin_addr.s_addr = frame->destination_address;
+            addresses[i].sin_port = 0;
+            vectors[i].iov_base = (void *)frame->data;
+            vectors[i].iov_len = frame->length;
+            memset(&messages[i], 0, sizeof(messages[i]));
+            messages[i].msg_hdr.msg_name = &addresses[i];
+            messages[i].msg_hdr.msg_namelen = sizeof(addresses[i]);
+            messages[i].msg_hdr.msg_iov = &vectors[i];
+            messages[i].msg_hdr.msg_iovlen = 1;
+            if (frame->vectors_count)
+            {
+                messages[i].msg_hdr.msg_iov = (struct iovec *)frame->vectors;
+                messages[i].msg_hdr.msg_iovlen = frame->vectors_count;
+            }
+        }
+
+        ret = sendmmsg(this->s_file_descriptor, messages, length, 0);
+        if (ret < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            /* sendmmsg only fails when the first message fails, skip it. */
+            frames[index++].error = errno;
+            continue;
+        }
+
+        for (int i = 0; i < ret; i++)
+        {
+            frames[index + i].error = 0;
+        }
+        sent += ret;
+        index += ret;
+    }
+
+    Metrics::add(counters.sent, sent);
+    Metrics::add(counters.send_errors, count - sent);
+    Metrics::get_send_latency().record(get_timestamp() - start);
+    if (PcapWriter *writer = Socket::capture.load(std::memory_order_relaxed))
+    {
+        writer->write_frames(frames, count, start);
+    }
+    return sent;
+}
+
+/**
+ * @brief Opens the non-blocking raw ICMP receive socket and registers it
+ * with epoll. Received datagrams carry their kernel receive timestamp.
+ *
+ */
+void Socket::enable_receive()
+{
+    struct epoll_event event;
+    int fd, option = 1, buffer_size = SOCKET_RECEIVE_BUFFER;
+
+    if (this->r_file_descriptor >= 0)
+    {
+        return;
+    }
+
+    fd = socket(AF_INET, SOCK_RAW | SOCK_NONBLOCK, IPPROTO_ICMP);
+    if (fd < 0)
+    {
+        throw Exception(EXCEPTION_MSG("Socket - Could not create receive socket"));
+    }
+    if (setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPNS, &option, sizeof(option)) < 0)
+    {
+        close(fd);
+        throw Exception(EXCEPTION_MSG("Socket - Could not set receive socket options."));
+    }
+    /* Best effort, the kernel caps it at net.core.rmem_max. */
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &buffer_size, sizeof(buffer_size));
+    /* Best effort, datagrams carry the count of drops on buffer overflow. */
+    setsockopt(fd, SOL_SOCKET, SO_RXQ_OVFL, &option, sizeof(option));
+
+    this->e_file_descriptor = epoll_create1(0);
+    if (this->e_file_descriptor < 0)
+    {
+        close(fd);
+        throw Exception(EXCEPTION_MSG("Socket - Could not create epoll instance."));
+    }
+
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    if (epoll_ctl(this->e_file_descriptor, EPOLL_CTL_ADD, fd, &event) < 0)
+    {
+        close(fd);
+        throw Exception(EXCEPTION_MSG("Socket - Could not register receive socket."));
+    }
+
+    this->r_file_descriptor = fd;
+    /* 4 MiB held for the socket lifetime, worth a couple of huge pages. */
+    this->r_pool = std::make_unique<PacketPool>(SOCKET_RECEIVE_LENGTH, SOCKET_BATCH_MAX, true);
+    for (unsigned int i = 0; i < SOCKET_BATCH_MAX; i++)
+    {
+        this->r_frames[i] = this->r_pool->acquire();
+    }
+}
+
+/**
+ * @brief Attaches a classic BPF program to the receive socket, so the kernel
+ * only queues the datagrams it accepts. Datagrams queued before the program
+ * was attached are discarded.
+ *
+ * @param program BPF instructions.
+ * @param length Number of instructions.
+ */
+void Socket::set_receive_filter(const struct sock_filter *program, size_t length)
+{
+    struct sock_fprog filter;
+    uint8_t discard;
+
+    if (this->r_file_descriptor < 0)
+    {
+        throw Exception(EXCEPTION_MSG("Socket - Receive is not enabled."));
+    }
+
+    filter.len = (unsigned short)length;
+    filter.filter = (struct sock_filter *)program;
+    if (setsockopt(this->r_file_descriptor, SOL_SOCKET, SO_ATTACH_FILTER, &filter, sizeof(filter)) < 0)
+    {
+        throw Exception(EXCEPTION_MSG("Socket - Could not attach receive filter."));
+    }
+    while (recv(this->r_file_descriptor, &discard, sizeof(discard), MSG_DONTWAIT | MSG_TRUNC) >= 0)
+    {
+    }
+}
+
+/**
+ * @brief Waits up to timeout milliseconds for datagrams and then drains every
+ * datagram ready, handing each one to the callback.
+ *
+ * @param timeout Wait timeout in milliseconds, zero polls and -1 blocks.
+ * @param callback Called for every datagram received.
+ * @return size_t Number of datagrams received.
+ */
+size_t Socket::receive(int timeout, const receive_callback_t &callback)
+{
+    if (!this->wait(timeout))
+    {
+        return 0;
+    }
+    return this->drain(&callback, nullptr);
+}
+
+/**
+ * @brief Waits up to timeout milliseconds for datagrams and then drains every
+ * datagram ready, handing them to the callback one recvmmsg batch at a time.
+ *
+ * @param timeout Wait timeout in milliseconds, zero polls and -1 blocks.
+ * @param callback Called for every batch received.
+ * @return size_t Number of datagrams received.
+ */
+size_t Socket::receive_batch(int timeout, const batch_callback_t &callback)
+{
+    if (!this->wait(timeout))
+    {
+        return 0;
+    }
+    return this->drain(nullptr, &callback);
+}
+
+/**
+ * @brief Sets the capture writer every socket logs its datagrams to, sent
+ * ones when they are handed to the kernel and received ones with their
+ * kernel timestamp.
+ *
+ * @param writer Capture writer, null to stop capturing. Must outlive its use.
+ */
+void Socket::set_capture(PcapWriter *writer)
+{
+    Socket::capture.store(writer, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Waits up to timeout milliseconds for the receive socket to be
+ * readable.
+ *
+ * @param timeout Wait timeout in milliseconds, zero polls and -1 blocks.
+ * @return true when datagrams are ready.
+ */
+bool Socket::wait(int timeout)
+{
+    struct epoll_event event;
+    int ret;
+
+    if (this->r_file_descriptor < 0)
+    {
+        throw Exception(EXCEPTION_MSG("Socket - Receive is not enabled."));
+    }
+
+    ret = epoll_wait(this->e_file_descriptor, &event, 1, timeout);
+    if (ret < 0 && errno != EINTR)
+    {
+        throw Exception(EXCEPTION_MSG("Socket - Could not wait for datagrams."));
+    }
+    return ret > 0;
+}
+
+/**
+ * @brief Receives with recvmmsg until the socket has no datagram left.
+ *
+ * @param callback Called for every datagram received, may be null.
+ * @param batch_callback Called for every batch received, may be null.
+ * @return size_t Number of datagrams received.
+ */
+size_t Socket::drain(const receive_callback_t *callback, const batch_callback_t *batch_callback)
+{
+    struct mmsghdr messages[SOCKET_BATCH_MAX];
+    struct iovec vectors[SOCKET_BATCH_MAX];
+    char controls[SOCKET_BATCH_MAX][CMSG_SPACE(sizeof(struct timespec)) +
+                                    CMSG_SPACE(sizeof(uint32_t))];
+    socket_frame_t frames[SOCKET_BATCH_MAX];
+    metrics_counters_t &counters = Metrics::get_counters();
+    PcapWriter *writer = Socket::capture.load(std::memory_order_relaxed);
+    size_t received = 0;
+
+    for (;;)
+    {
+        struct timespec now;
+        uint64_t fallback;
+        int ret;
+
+        for (unsigned int i = 0; i < SOCKET_BATCH_MAX; i++)
+        {
+            vectors[i].iov_base = this->r_frames[i];
+            vectors[i].iov_len = SOCKET_RECEIVE_LENGTH;
+            memset(&messages[i], 0, sizeof(messages[i]));
+            messages[i].msg_hdr.msg_iov = &vectors[i];
+            messages[i].msg_hdr.msg_iovlen = 1;
+            messages[i].msg_hdr.msg_control = controls[i];
+            messages[i].msg_hdr.msg_controllen = sizeof(controls[i]);
+        }
+
+        ret = recvmmsg(this->r_file_descriptor, messages, SOCKET_BATCH_MAX, MSG_DONTWAIT, nullptr);
+        if (ret < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                break;
+            }
+            throw Exception(EXCEPTION_MSG("Socket - Could not receive datagrams."));
+        }
+
+        clock_gettime(CLOCK_REALTIME, &now);
+        fallback = (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+
+        for (int i = 0; i < ret; i++)
+        {
+            struct msghdr *header = &messages[i].msg_hdr;
+            uint64_t timestamp = fallback;
+
+            for (struct cmsghdr *control = CMSG_FIRSTHDR(header); control != nullptr;
+                 control = CMSG_NXTHDR(header, control))
+            {
+                if (control->cmsg_level == SOL_SOCKET && control->cmsg_type == SCM_TIMESTAMPNS)
+                {
+                    struct timespec stamp;
+                    memcpy(&stamp, CMSG_DATA(control), sizeof(stamp));
+                    timestamp = (uint64_t)stamp.tv_sec * 1000000000ULL + stamp.tv_nsec;
+                }
+                else if (control->cmsg_level == SOL_SOCKET && control->cmsg_type == SO_RXQ_OVFL)
+                {
+                    uint32_t drops;
+                    memcpy(&drops, CMSG_DATA(control), sizeof(drops));
+                    /* Cumulative count of the socket, only the increase is new. */
+                    Metrics::add(counters.drops, (uint32_t)(drops - this->r_drops));
+                    this->r_drops = drops;
+                }
+            }
+            memset(&frames[i], 0, sizeof(frames[i]));
+            frames[i].data = (const uint8_t *)vectors[i].iov_base;
+            frames[i].length = std::min((size_t)messages[i].msg_len, (size_t)SOCKET_RECEIVE_LENGTH);
+            if (writer)
+            {
+                writer->write(frames[i].data, frames[i].length, timestamp);
+            }
+            if (callback)
+            {
+                (*callback)(frames[i].data, frames[i].length, timestamp);
+            }
+        }
+        received += ret;
+        Metrics::add(counters.received, ret);
+        if (batch_callback)
+        {
+            (*batch_callback)(frames, (size_t)ret);
+        }
+
+        if (ret < SOCKET_BATCH_MAX)
+        {
+            break;
+        }
+    }
+    return received;
 }
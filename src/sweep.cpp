@@ -0,0 +1,315 @@
+/**
+ * @file sweep.cpp
+ * @author Mateus Lima Alves (mateuslima.ti@gmail.com)
+ * @brief Multi-target ECHO (or TIMESTAMP) sweep engine methods.
+ * @version 0.1
+ * @date 2022-03-23
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include <sweep.hpp>
+#include <icmp.hpp>
+#include <icmp_message.hpp>
+#include <ipv4.hpp>
+#include <ipv4_view.hpp>
+#include <icmp_view.hpp>
+#include <metrics.hpp>
+#include <exceptions.hpp>
+#include <algorithm>
+#include <cstring>
+
+/**
+ * @brief Construct a new Sweep:: Sweep object
+ *
+ * @param socket
+ * @param source_address
+ * @param in_flight
+ * @param timeout
+ * @param retries
+ * @param count
+ * @param type
+ */
+Sweep::Sweep(Socket &socket, uint32_t source_address, size_t in_flight, int timeout,
+             uint16_t retries, size_t count, message_type_t type) :
+    ProbeEngine(socket, in_flight, timeout), type{type}, max_retries{retries}, count{count},
+    source{nullptr}, round{0}, exhausted{true}, target_count{0}, callback{nullptr},
+    next_target{0}, duplicates{0}, late{0}
+{
+    Ipv4 ipv4;
+
+    ipv4.set_protocol_number(ICMP_NUMBER);
+    ipv4.set_source_address(source_address);
+    switch (type)
+    {
+    case ECHO:
+    {
+        IcmpMessage<ECHO> icmp;
+        icmp.set_identifier(this->identifier);
+        this->probe = std::make_unique<ProbeTemplate>(ipv4, icmp);
+        break;
+    }
+    case TIMESTAMP:
+    {
+        IcmpMessage<TIMESTAMP> icmp;
+        icmp.set_identifier(this->identifier);
+        this->probe = std::make_unique<ProbeTemplate>(ipv4, icmp);
+        break;
+    }
+    default:
+    {
+        throw Exception(EXCEPTION_MSG("SWEEP - Probes must be ECHO or TIMESTAMP."));
+    }
+    }
+
+    this->set_frame_size(this->probe->get_length());
+}
+
+/**
+ * @brief Destroy the Sweep:: Sweep object
+ *
+ */
+Sweep::~Sweep()
+{
+}
+
+/**
+ * @brief Probes every target on the shared probe window.
+ *
+ * @param source
+ * @param callback
+ */
+void Sweep::run(TargetSource &source, const sweep_callback_t &callback)
+{
+    source.rewind();
+    this->source = &source;
+    this->round = 0;
+    this->exhausted = false;
+    this->target_count = 0;
+    this->callback = &callback;
+    this->retransmits.clear();
+    this->next_target = 0;
+    this->duplicates = 0;
+    this->late = 0;
+
+    this->run_window();
+
+    this->source = nullptr;
+    this->callback = nullptr;
+}
+
+/**
+ * @brief Get the number of targets of the last run.
+ *
+ * @return size_t
+ */
+size_t Sweep::get_targets()
+{
+    return this->target_count;
+}
+
+/**
+ * @brief Get the number of duplicate replies of the last run.
+ *
+ * @return size_t
+ */
+size_t Sweep::get_duplicates()
+{
+    return this->duplicates;
+}
+
+/**
+ * @brief Get the number of late replies of the last run.
+ *
+ * @return size_t
+ */
+size_t Sweep::get_late()
+{
+    return this->late;
+}
+
+/**
+ * @brief Whether there are targets left to probe.
+ *
+ * @return true
+ * @return false
+ */
+bool Sweep::has_probes()
+{
+    return !this->exhausted || !this->retransmits.empty();
+}
+
+/**
+ * @brief Get the next probes: retransmits first, then new targets.
+ *
+ * @param probes
+ * @param max
+ * @return size_t
+ */
+size_t Sweep::next_probes(engine_probe_t *probes, size_t max)
+{
+    size_t count = 0;
+
+    for (; count < max && !this->retransmits.empty(); count++)
+    {
+        probes[count] = this->retransmits.front();
+        this->retransmits.pop_front();
+    }
+    return count + this->read_targets(&probes[count], max - count);
+}
+
+/**
+ * @brief Stamps the originate timestamp of a TIMESTAMP batch.
+ *
+ * @param now
+ */
+void Sweep::prepare_batch(uint64_t now)
+{
+    /* One clock read per batch. The originate timestamp only has
+     * millisecond resolution, the delays are computed from the send
+     * time in nanoseconds kept in the probe record. */
+    if (this->type == TIMESTAMP)
+    {
+        this->probe->set_originate_timestamp(icmp_timestamp(now));
+    }
+}
+
+/**
+ * @brief Encodes a probe from the template.
+ *
+ * @param probe
+ * @param sequence_number
+ * @param buffer
+ * @return size_t
+ */
+size_t Sweep::encode(const engine_probe_t &probe, uint16_t sequence_number, uint8_t *buffer)
+{
+    this->probe->set_destination_address(probe.destination_address);
+    this->probe->set_sequence_number(sequence_number);
+    memcpy(buffer, this->probe->data(), this->probe->get_length());
+    return this->probe->get_length();
+}
+
+/**
+ * @brief Reads the next targets from the source. Targets are numbered in
+ * the order they are read, from zero again every round.
+ *
+ * @param targets
+ * @param max
+ * @return size_t
+ */
+size_t Sweep::read_targets(engine_probe_t *targets, size_t max)
+{
+    uint32_t addresses[SOCKET_BATCH_MAX];
+    size_t count = 0;
+
+    while (count < max && !this->exhausted)
+    {
+        size_t read = this->source->next(addresses, std::min(max - count, (size_t)SOCKET_BATCH_MAX));
+
+        if (read == 0)
+        {
+            if (++this->round >= this->count || this->next_target == 0)
+            {
+                this->exhausted = true;
+                break;
+            }
+            this->source->rewind();
+            this->next_target = 0;
+            continue;
+        }
+        for (size_t i = 0; i < read; i++)
+        {
+            targets[count++] = {this->next_target++, addresses[i], 0};
+        }
+        this->target_count = std::max(this->target_count, this->next_target);
+    }
+    return count;
+}
+
+/**
+ * @brief Matches a received datagram against the probes in flight.
+ *
+ * @param data
+ * @param length
+ * @param timestamp
+ */
+void Sweep::handle_reply(const uint8_t *data, size_t length, uint64_t timestamp)
+{
+    Ipv4View ipv4;
+    IcmpView icmp;
+    probe_record_t record;
+
+    if (!ipv4.parse(data, length) || ipv4.get_protocol_number() != ICMP_NUMBER ||
+        !icmp.parse(ipv4.get_data(), ipv4.get_data_length()) ||
+        icmp.get_type() != (this->type == TIMESTAMP ? TIMESTAMP_REPLY : ECHO_REPLY) ||
+        icmp.get_identifier() != this->identifier)
+    {
+        return;
+    }
+
+    switch (this->match(ipv4.get_source_address(), icmp.get_sequence_number(), &record))
+    {
+    case PROBE_MATCHED:
+    {
+        sweep_result_t result = {record.target, ipv4.get_source_address(), SWEEP_ALIVE,
+                                 timestamp > record.sent_timestamp ? timestamp - record.sent_timestamp : 0,
+                                 record.retries, timestamp, 0, 0};
+        if (this->type == TIMESTAMP)
+        {
+            result.receive_timestamp = icmp.get_receive_timestamp();
+            result.transmit_timestamp = icmp.get_transmit_timestamp();
+        }
+        Metrics::get_rtt().record(result.rtt);
+        (*this->callback)(result);
+        break;
+    }
+    case PROBE_DUPLICATE:
+    {
+        this->duplicates++;
+        break;
+    }
+    case PROBE_LATE:
+    {
+        this->late++;
+        break;
+    }
+    case PROBE_UNKNOWN:
+    default:
+    {
+        break;
+    }
+    }
+}
+
+/**
+ * @brief Handles a probe timeout, scheduling a retransmit while the target
+ * has retries left.
+ *
+ * @param destination_address
+ * @param record
+ */
+void Sweep::handle_timeout(uint32_t destination_address, const probe_record_t &record)
+{
+    if (record.retries < this->max_retries)
+    {
+        this->retransmits.push_back({record.target, destination_address, (uint16_t)(record.retries + 1)});
+        return;
+    }
+
+    sweep_result_t result = {record.target, destination_address, SWEEP_TIMEOUT, 0, record.retries, 0, 0, 0};
+    (*this->callback)(result);
+}
+
+/**
+ * @brief Reports a probe that could not be sent.
+ *
+ * @param probe
+ */
+void Sweep::handle_send_error(const engine_probe_t &probe)
+{
+    sweep_result_t result = {probe.target, probe.destination_address, SWEEP_SEND_ERROR, 0,
+                             probe.retries, 0, 0, 0};
+    (*this->callback)(result);
+}
@@ -0,0 +1,252 @@
+/**
+ * @file target_source.cpp
+ * @author Mateus Lima Alves (mateuslima.ti@gmail.com)
+ * @brief Streaming target source methods.
+ * @version 0.1
+ * @date 2022-04-09
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include <target_source.hpp>
+#include <exceptions.hpp>
+#include <algorithm>
+#include <cstring>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/**
+ * @brief Construct a new Target Source:: Target Source object
+ *
+ * @param targets
+ * @param targets_count
+ * @param path
+ */
+TargetSource::TargetSource(char **targets, int targets_count, const char *path) :
+    targets{targets}, targets_count{targets_count}, next_argument{0}, mapping{nullptr}, size{0},
+    offset{0}, addresses{nullptr}, next_address{0}, range_next{1}, range_last{0}
+{
+    struct stat status;
+    void *mapped;
+    int fd;
+
+    if (path == nullptr)
+    {
+        return;
+    }
+
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        throw Exception(EXCEPTION_MSG("TARGETS - Could not open targets file"));
+    }
+    if (fstat(fd, &status) < 0)
+    {
+        close(fd);
+        throw Exception(EXCEPTION_MSG("TARGETS - Could not read targets file"));
+    }
+    if (status.st_size == 0)
+    {
+        close(fd);
+        return;
+    }
+
+    mapped = mmap(nullptr, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED)
+    {
+        throw Exception(EXCEPTION_MSG("TARGETS - Could not map targets file"));
+    }
+    /* Best effort, read ahead aggressively. Pages already read stay cached,
+     * they are only reclaimed sooner under memory pressure. */
+    madvise(mapped, (size_t)status.st_size, MADV_SEQUENTIAL);
+    this->mapping = (const char *)mapped;
+    this->size = (size_t)status.st_size;
+}
+
+/**
+ * @brief Construct a new Target Source:: Target Source object
+ *
+ * @param addresses
+ */
+TargetSource::TargetSource(const std::vector<uint32_t> &addresses) :
+    targets{nullptr}, targets_count{0}, next_argument{0}, mapping{nullptr}, size{0}, offset{0},
+    addresses{&addresses}, next_address{0}, range_next{1}, range_last{0}
+{
+}
+
+/**
+ * @brief Destroy the Target Source:: Target Source object
+ *
+ */
+TargetSource::~TargetSource()
+{
+    if (this->mapping)
+    {
+        munmap((void *)this->mapping, this->size);
+    }
+}
+
+/**
+ * @brief Get the next target addresses. Entries are only parsed once the
+ * range of the one before is used up.
+ *
+ * @param addresses
+ * @param max
+ * @return size_t
+ */
+size_t TargetSource::next(uint32_t *addresses, size_t max)
+{
+    size_t count = 0;
+
+    if (this->addresses)
+    {
+        count = std::min(max, this->addresses->size() - this->next_address);
+        memcpy(addresses, this->addresses->data() + this->next_address, count * sizeof(uint32_t));
+        this->next_address += count;
+        return count;
+    }
+
+    while (count < max)
+    {
+        const char *entry;
+        size_t length;
+
+        if (this->range_next > this->range_last)
+        {
+            if (!this->next_entry(&entry, &length))
+            {
+                break;
+            }
+            this->parse(entry, length);
+            continue;
+        }
+        addresses[count++] = htonl((uint32_t)this->range_next++);
+    }
+    return count;
+}
+
+/**
+ * @brief Starts reading the targets again from the first one.
+ *
+ */
+void TargetSource::rewind()
+{
+    this->next_argument = 0;
+    this->offset = 0;
+    this->next_address = 0;
+    this->range_next = 1;
+    this->range_last = 0;
+}
+
+/**
+ * @brief Get the next target entry: the command line targets first, then
+ * the targets file lines that are not blank once the comment is cut.
+ *
+ * @param entry
+ * @param length
+ * @return true
+ * @return false
+ */
+bool TargetSource::next_entry(const char **entry, size_t *length)
+{
+    if (this->next_argument < this->targets_count)
+    {
+        *entry = this->targets[this->next_argument++];
+        *length = strlen(*entry);
+        return true;
+    }
+
+    while (this->offset < this->size)
+    {
+        const char *line = this->mapping + this->offset;
+        const char *newline = (const char *)memchr(line, '\n', this->size - this->offset);
+        const char *end = newline ? newline : this->mapping + this->size;
+        const char *comment = (const char *)memchr(line, '#', (size_t)(end - line));
+
+        this->offset = (size_t)(end - this->mapping) + 1;
+        if (comment)
+        {
+            end = comment;
+        }
+        while (line < end && (*line == ' ' || *line == '\t' || *line == '\r'))
+        {
+            line++;
+        }
+        while (end > line && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r'))
+        {
+            end--;
+        }
+        if (line < end)
+        {
+            *entry = line;
+            *length = (size_t)(end - line);
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Parses an address or a CIDR prefix. Prefixes shorter than /31 skip
+ * their network and broadcast addresses.
+ *
+ * @param entry
+ * @param length
+ */
+void TargetSource::parse(const char *entry, size_t length)
+{
+    char address[TARGET_ENTRY_MAX + 1];
+    const char *slash;
+    struct in_addr parsed;
+    size_t prefix_length = 32;
+    uint32_t mask;
+
+    if (length > TARGET_ENTRY_MAX)
+    {
+        throw Exception(EXCEPTION_MSG("TARGETS - Address invalid"));
+    }
+    slash = (const char *)memchr(entry, '/', length);
+    memcpy(address, entry, slash ? (size_t)(slash - entry) : length);
+    address[slash ? (size_t)(slash - entry) : length] = '\0';
+    if (inet_pton(AF_INET, address, &parsed) != 1)
+    {
+        throw Exception(EXCEPTION_MSG("TARGETS - Address invalid"));
+    }
+
+    if (slash)
+    {
+        const char *digit = slash + 1;
+
+        if (digit == entry + length || entry + length - digit > 2)
+        {
+            throw Exception(EXCEPTION_MSG("TARGETS - CIDR prefix length invalid"));
+        }
+        prefix_length = 0;
+        for (; digit < entry + length; digit++)
+        {
+            if (*digit < '0' || *digit > '9')
+            {
+                throw Exception(EXCEPTION_MSG("TARGETS - CIDR prefix length invalid"));
+            }
+            prefix_length = prefix_length * 10 + (size_t)(*digit - '0');
+        }
+        if (prefix_length > 32)
+        {
+            throw Exception(EXCEPTION_MSG("TARGETS - CIDR prefix length invalid"));
+        }
+    }
+
+    mask = prefix_length ? (uint32_t)(UINT32_MAX << (32 - prefix_length)) : 0;
+    this->range_next = ntohl(parsed.s_addr) & mask;
+    this->range_last = this->range_next | (uint32_t)~mask;
+    if (prefix_length < 31)
+    {
+        this->range_next++;
+        this->range_last--;
+    }
+}
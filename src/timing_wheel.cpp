@@ -0,0 +1,329 @@
+/**
+ * @file timing_wheel.cpp
+ * @author Mateus Lima Alves (mateuslima.ti@gmail.com)
+ * @brief Hashed hierarchical timing wheel class methods.
+ * @version 0.1
+ * @date 2022-03-25
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include <timing_wheel.hpp>
+#include <exceptions.hpp>
+
+/**
+ * @brief Construct a new Timing Wheel:: Timing Wheel object
+ *
+ * @param capacity
+ * @param now
+ * @param resolution
+ */
+TimingWheel::TimingWheel(size_t capacity, uint64_t now, uint64_t resolution) :
+    free_list{TIMER_INVALID}, origin{now}, resolution{resolution}, current{0}, pending{0}
+{
+    if (capacity == 0 || capacity >= TIMER_INVALID || resolution == 0)
+    {
+        throw Exception(EXCEPTION_MSG("TIMING WHEEL - Invalid capacity or resolution."));
+    }
+
+    this->nodes.resize(capacity);
+    for (size_t i = capacity; i-- > 0;)
+    {
+        this->nodes[i].pending = false;
+        this->nodes[i].next = this->free_list;
+        this->free_list = (timer_id_t)i;
+    }
+    for (size_t i = 0; i < TIMING_WHEEL_LEVELS * TIMING_WHEEL_SLOTS; i++)
+    {
+        this->heads[i] = TIMER_INVALID;
+    }
+    for (unsigned level = 0; level < TIMING_WHEEL_LEVELS; level++)
+    {
+        for (unsigned word = 0; word < TIMING_WHEEL_SLOTS / 64; word++)
+        {
+            this->bitmaps[level][word] = 0;
+        }
+    }
+}
+
+/**
+ * @brief Destroy the Timing Wheel:: Timing Wheel object
+ *
+ */
+TimingWheel::~TimingWheel()
+{
+}
+
+/**
+ * @brief Schedules a timer. Deadlines already due fire on the next tick.
+ *
+ * @param deadline
+ * @param data
+ * @return timer_id_t
+ */
+timer_id_t TimingWheel::schedule(uint64_t deadline, uint64_t data)
+{
+    timer_id_t timer = this->free_list;
+    uint64_t expiry = this->to_tick(deadline);
+
+    if (timer == TIMER_INVALID)
+    {
+        return TIMER_INVALID;
+    }
+    this->free_list = this->nodes[timer].next;
+
+    this->nodes[timer].expiry = expiry > this->current ? expiry : this->current + 1;
+    this->nodes[timer].data = data;
+    this->nodes[timer].pending = true;
+    this->link(timer);
+    this->pending++;
+    return timer;
+}
+
+/**
+ * @brief Cancels a pending timer.
+ *
+ * @param timer
+ */
+void TimingWheel::cancel(timer_id_t timer)
+{
+    if (timer >= this->nodes.size() || !this->nodes[timer].pending)
+    {
+        return;
+    }
+
+    this->unlink(timer);
+    this->nodes[timer].pending = false;
+    this->nodes[timer].next = this->free_list;
+    this->free_list = timer;
+    this->pending--;
+}
+
+/**
+ * @brief Expires every timer due until now. Ticks without timers are
+ * skipped through the level zero bitmap, only the ticks holding timers or
+ * cascading a higher level are visited.
+ *
+ * @param now
+ * @param callback
+ * @return size_t
+ */
+size_t TimingWheel::advance(uint64_t now, const timer_callback_t &callback)
+{
+    uint64_t target = now > this->origin ? (now - this->origin) / this->resolution : 0;
+    size_t expired = 0;
+
+    while (this->current < target)
+    {
+        unsigned index = (unsigned)(this->current & TIMING_WHEEL_MASK);
+        unsigned slot = index < TIMING_WHEEL_MASK ? this->find_slot(index + 1) : TIMING_WHEEL_SLOTS;
+        uint64_t next = (this->current & ~(uint64_t)TIMING_WHEEL_MASK) + slot;
+
+        if (next > target)
+        {
+            this->current = target;
+            break;
+        }
+        this->current = next;
+
+        if ((this->current & TIMING_WHEEL_MASK) == 0)
+        {
+            unsigned indexes[TIMING_WHEEL_LEVELS];
+            unsigned level = 1;
+
+            for (unsigned i = 1; i < TIMING_WHEEL_LEVELS; i++)
+            {
+                indexes[i] = (unsigned)((this->current >> (i * TIMING_WHEEL_BITS)) & TIMING_WHEEL_MASK);
+            }
+            /* A level only wraps when every level below it wrapped too. */
+            while (level + 1 < TIMING_WHEEL_LEVELS && indexes[level] == 0)
+            {
+                level++;
+            }
+            for (; level > 0; level--)
+            {
+                this->cascade(level, indexes[level]);
+            }
+        }
+
+        slot = (unsigned)(this->current & TIMING_WHEEL_MASK);
+        while (this->heads[slot] != TIMER_INVALID)
+        {
+            timer_id_t timer = this->heads[slot];
+            uint64_t data = this->nodes[timer].data;
+
+            this->cancel(timer);
+            callback(data);
+            expired++;
+        }
+    }
+    return expired;
+}
+
+/**
+ * @brief Get the milliseconds the event loop may sleep: until the next
+ * occupied level zero slot or, when there is none, until the next cascade.
+ *
+ * @param now
+ * @return int
+ */
+int TimingWheel::get_wait_timeout(uint64_t now)
+{
+    unsigned index = (unsigned)(this->current & TIMING_WHEEL_MASK);
+    unsigned slot;
+    uint64_t deadline;
+
+    if (this->pending == 0)
+    {
+        return -1;
+    }
+
+    slot = index < TIMING_WHEEL_MASK ? this->find_slot(index + 1) : TIMING_WHEEL_SLOTS;
+    deadline = this->origin +
+               ((this->current & ~(uint64_t)TIMING_WHEEL_MASK) + slot) * this->resolution;
+    if (deadline <= now)
+    {
+        return 0;
+    }
+    return (int)((deadline - now + 999999ULL) / 1000000ULL);
+}
+
+/**
+ * @brief Get the number of pending timers.
+ *
+ * @return size_t
+ */
+size_t TimingWheel::get_pending()
+{
+    return this->pending;
+}
+
+/**
+ * @brief Converts a time into a tick, rounding up so timers never fire early.
+ *
+ * @param time
+ * @return uint64_t
+ */
+uint64_t TimingWheel::to_tick(uint64_t time)
+{
+    if (time <= this->origin)
+    {
+        return 0;
+    }
+    return (time - this->origin + this->resolution - 1) / this->resolution;
+}
+
+/**
+ * @brief Links a node into the slot matching its distance to the current
+ * tick: level n holds the timers due within 2^(8 * (n + 1)) ticks.
+ *
+ * @param timer
+ */
+void TimingWheel::link(timer_id_t timer)
+{
+    timer_node_t *node = &this->nodes[timer];
+    uint64_t delta = node->expiry - this->current;
+    unsigned level = 0, index, slot;
+
+    if (delta >> (TIMING_WHEEL_LEVELS * TIMING_WHEEL_BITS))
+    {
+        node->expiry = this->current + ((1ULL << (TIMING_WHEEL_LEVELS * TIMING_WHEEL_BITS)) - 1);
+        delta = node->expiry - this->current;
+    }
+    while (level + 1 < TIMING_WHEEL_LEVELS && (delta >> ((level + 1) * TIMING_WHEEL_BITS)))
+    {
+        level++;
+    }
+
+    index = (unsigned)((node->expiry >> (level * TIMING_WHEEL_BITS)) & TIMING_WHEEL_MASK);
+    slot = level * TIMING_WHEEL_SLOTS + index;
+
+    node->slot = (uint16_t)slot;
+    node->previous = TIMER_INVALID;
+    node->next = this->heads[slot];
+    if (node->next != TIMER_INVALID)
+    {
+        this->nodes[node->next].previous = timer;
+    }
+    this->heads[slot] = timer;
+    this->bitmaps[level][index / 64] |= 1ULL << (index % 64);
+}
+
+/**
+ * @brief Unlinks a node from its slot.
+ *
+ * @param timer
+ */
+void TimingWheel::unlink(timer_id_t timer)
+{
+    timer_node_t *node = &this->nodes[timer];
+
+    if (node->previous != TIMER_INVALID)
+    {
+        this->nodes[node->previous].next = node->next;
+    }
+    else
+    {
+        this->heads[node->slot] = node->next;
+    }
+    if (node->next != TIMER_INVALID)
+    {
+        this->nodes[node->next].previous = node->previous;
+    }
+
+    if (this->heads[node->slot] == TIMER_INVALID)
+    {
+        unsigned level = node->slot / TIMING_WHEEL_SLOTS;
+        unsigned index = node->slot % TIMING_WHEEL_SLOTS;
+        this->bitmaps[level][index / 64] &= ~(1ULL << (index % 64));
+    }
+}
+
+/**
+ * @brief Moves the timers of a higher level slot to the levels below, now
+ * that they are closer to their expiry.
+ *
+ * @param level
+ * @param index
+ */
+void TimingWheel::cascade(unsigned level, unsigned index)
+{
+    unsigned slot = level * TIMING_WHEEL_SLOTS + index;
+    timer_id_t timer = this->heads[slot];
+
+    this->heads[slot] = TIMER_INVALID;
+    this->bitmaps[level][index / 64] &= ~(1ULL << (index % 64));
+
+    while (timer != TIMER_INVALID)
+    {
+        timer_id_t next = this->nodes[timer].next;
+        this->link(timer);
+        timer = next;
+    }
+}
+
+/**
+ * @brief Finds the first occupied level zero slot in [from, TIMING_WHEEL_SLOTS).
+ *
+ * @param from
+ * @return unsigned
+ */
+unsigned TimingWheel::find_slot(unsigned from)
+{
+    unsigned word = from / 64;
+    uint64_t bits = this->bitmaps[0][word] & (~0ULL << (from % 64));
+
+    for (;;)
+    {
+        if (bits)
+        {
+            return word * 64 + (unsigned)__builtin_ctzll(bits);
+        }
+        if (++word == TIMING_WHEEL_SLOTS / 64)
+        {
+            return TIMING_WHEEL_SLOTS;
+        }
+        bits = this->bitmaps[0][word];
+    }
+}
@@ -0,0 +1,300 @@
+/**
+ * @file traceroute.cpp
+ * @author Mateus Lima Alves (mateuslima.ti@gmail.com)
+ * @brief Parallel traceroute engine methods.
+ * @version 0.1
+ * @date 2022-04-02
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include <traceroute.hpp>
+#include <icmp.hpp>
+#include <icmp_message.hpp>
+#include <ipv4.hpp>
+#include <ipv4_view.hpp>
+#include <icmp_view.hpp>
+#include <metrics.hpp>
+#include <exceptions.hpp>
+#include <cstring>
+
+/**
+ * @brief Construct a new Traceroute:: Traceroute object
+ *
+ * @param socket
+ * @param source_address
+ * @param in_flight
+ * @param timeout
+ * @param max_ttl
+ */
+Traceroute::Traceroute(Socket &socket, uint32_t source_address, size_t in_flight, int timeout,
+                       uint8_t max_ttl) :
+    ProbeEngine(socket, in_flight, timeout), max_ttl{max_ttl}, source{nullptr}, exhausted{true},
+    target_count{0}, callback{nullptr}, destination_address{0}, next_ttl{max_ttl}
+{
+    static const uint8_t balance[TRACEROUTE_BALANCE_LENGTH] = {0, 0};
+    IcmpMessage<ECHO> icmp;
+    Ipv4 ipv4;
+
+    if (max_ttl == 0)
+    {
+        throw Exception(EXCEPTION_MSG("TRACEROUTE - Maximum TTL must be at least one."));
+    }
+
+    ipv4.set_protocol_number(ICMP_NUMBER);
+    ipv4.set_source_address(source_address);
+    icmp.set_identifier(this->identifier);
+    icmp.set_payload(balance, sizeof(balance));
+    this->icmp_offset = ipv4.get_header_length();
+    this->probe = std::make_unique<ProbeTemplate>(ipv4, icmp);
+
+    this->set_frame_size(this->probe->get_length());
+}
+
+/**
+ * @brief Destroy the Traceroute:: Traceroute object
+ *
+ */
+Traceroute::~Traceroute()
+{
+}
+
+/**
+ * @brief Probes every TTL of every target on the shared probe window.
+ *
+ * @param source
+ * @param callback
+ */
+void Traceroute::run(TargetSource &source, const traceroute_callback_t &callback)
+{
+    source.rewind();
+    this->source = &source;
+    this->exhausted = false;
+    this->target_count = 0;
+    this->callback = &callback;
+    this->next_ttl = this->max_ttl;
+    this->paths.clear();
+
+    this->run_window();
+
+    this->source = nullptr;
+    this->callback = nullptr;
+}
+
+/**
+ * @brief Get the number of targets of the last run.
+ *
+ * @return size_t
+ */
+size_t Traceroute::get_targets()
+{
+    return this->target_count;
+}
+
+/**
+ * @brief Get the number of hops probed per target.
+ *
+ * @return uint8_t
+ */
+uint8_t Traceroute::get_max_ttl()
+{
+    return this->max_ttl;
+}
+
+/**
+ * @brief Whether there are probes left to send.
+ *
+ * @return true
+ * @return false
+ */
+bool Traceroute::has_probes()
+{
+    return this->next_ttl < this->max_ttl || !this->exhausted;
+}
+
+/**
+ * @brief Get the next probes. Probes are ordered by target then TTL, so
+ * every TTL of a target leaves in the same batch when max_ttl fits in it.
+ * A target is read from the source, and its path allocated, when its first
+ * TTL is sent; the probe index packs the target index and the TTL.
+ *
+ * @param probes
+ * @param max
+ * @return size_t
+ */
+size_t Traceroute::next_probes(engine_probe_t *probes, size_t max)
+{
+    size_t count = 0;
+
+    while (count < max)
+    {
+        if (this->next_ttl >= this->max_ttl)
+        {
+            if (this->exhausted || this->source->next(&this->destination_address, 1) == 0)
+            {
+                this->exhausted = true;
+                break;
+            }
+            traceroute_path_t &path = this->paths[this->target_count++];
+
+            path.target = this->target_count - 1;
+            path.destination_address = this->destination_address;
+            path.hops.resize(this->max_ttl);
+            path.completed = 0;
+            this->next_ttl = 0;
+        }
+        probes[count++] = {(uint64_t)(this->target_count - 1) * this->max_ttl + this->next_ttl++,
+                           this->destination_address, 0};
+    }
+    return count;
+}
+
+/**
+ * @brief Encodes a probe. The template only has its TTL and destination
+ * patched (IPv4 header checksum); the sequence number is written straight
+ * into the frame along with its one's complement in the data, which adds up
+ * to zero in the ICMP checksum, so the checksum is the same for every probe.
+ *
+ * @param probe
+ * @param sequence_number
+ * @param buffer
+ * @return size_t
+ */
+size_t Traceroute::encode(const engine_probe_t &probe, uint16_t sequence_number, uint8_t *buffer)
+{
+    size_t sequence_offset = this->icmp_offset + ICMP_SEQUENCE_OFFSET;
+    size_t balance_offset = this->icmp_offset + ICMP_MESSAGE_LENGTH;
+    uint16_t balance = (uint16_t)~sequence_number;
+
+    this->probe->set_destination_address(probe.destination_address);
+    this->probe->set_ttl((uint8_t)(probe.target % this->max_ttl + 1));
+    memcpy(buffer, this->probe->data(), this->probe->get_length());
+    buffer[sequence_offset] = (uint8_t)(sequence_number >> 8);
+    buffer[sequence_offset + 1] = (uint8_t)sequence_number;
+    buffer[balance_offset] = (uint8_t)(balance >> 8);
+    buffer[balance_offset + 1] = (uint8_t)balance;
+    return this->probe->get_length();
+}
+
+/**
+ * @brief Matches a received datagram against the probes in flight. An
+ * ECHO_REPLY comes from the target itself; TIME_EXCEEDED and
+ * DESTINATION_UNREACHABLE come from a node on the path and quote the probe
+ * header, whose destination, identifier and sequence number find the probe.
+ *
+ * @param data
+ * @param length
+ * @param timestamp
+ */
+void Traceroute::handle_reply(const uint8_t *data, size_t length, uint64_t timestamp)
+{
+    Ipv4View ipv4, quoted;
+    IcmpView icmp, quoted_icmp;
+    probe_record_t record;
+    uint32_t destination_address;
+    traceroute_status_t status;
+
+    if (!ipv4.parse(data, length) || ipv4.get_protocol_number() != ICMP_NUMBER ||
+        !icmp.parse(ipv4.get_data(), ipv4.get_data_length()))
+    {
+        return;
+    }
+
+    switch (icmp.get_type())
+    {
+    case ECHO_REPLY:
+    {
+        if (icmp.get_identifier() != this->identifier)
+        {
+            return;
+        }
+        destination_address = ipv4.get_source_address();
+        status = TRACEROUTE_REACHED;
+        if (this->match(destination_address, icmp.get_sequence_number(), &record) != PROBE_MATCHED)
+        {
+            return;
+        }
+        break;
+    }
+    case TIME_EXCEEDED:
+    case DESTINATION_UNREACHABLE:
+    {
+        if (!icmp.get_quoted_datagram(&quoted) || quoted.get_protocol_number() != ICMP_NUMBER ||
+            !quoted_icmp.parse(quoted.get_data(), quoted.get_data_length(), true) ||
+            quoted_icmp.get_type() != ECHO || quoted_icmp.get_identifier() != this->identifier)
+        {
+            return;
+        }
+        destination_address = quoted.get_destination_address();
+        status = icmp.get_type() == TIME_EXCEEDED ? TRACEROUTE_TIME_EXCEEDED : TRACEROUTE_UNREACHABLE;
+        if (this->match(destination_address, quoted_icmp.get_sequence_number(), &record) !=
+            PROBE_MATCHED)
+        {
+            return;
+        }
+        break;
+    }
+    default:
+    {
+        return;
+    }
+    }
+
+    this->report(record.target, ipv4.get_source_address(), status,
+                 timestamp > record.sent_timestamp ? timestamp - record.sent_timestamp : 0);
+}
+
+/**
+ * @brief Records a probe result, reporting the path of its target once
+ * every TTL has an outcome.
+ *
+ * @param probe
+ * @param address
+ * @param status
+ * @param rtt
+ */
+void Traceroute::report(uint64_t probe, uint32_t address, traceroute_status_t status, uint64_t rtt)
+{
+    auto path = this->paths.find(probe / this->max_ttl);
+    size_t ttl = probe % this->max_ttl;
+
+    if (path == this->paths.end())
+    {
+        return;
+    }
+    if (status != TRACEROUTE_TIMEOUT && status != TRACEROUTE_SEND_ERROR)
+    {
+        Metrics::get_rtt().record(rtt);
+    }
+
+    path->second.hops[ttl] = {path->second.target, path->second.destination_address,
+                              (uint8_t)(ttl + 1), address, status, rtt};
+    if (++path->second.completed == this->max_ttl)
+    {
+        (*this->callback)(path->second);
+        this->paths.erase(path);
+    }
+}
+
+/**
+ * @brief Reports a probe timeout.
+ *
+ * @param destination_address
+ * @param record
+ */
+void Traceroute::handle_timeout(uint32_t destination_address, const probe_record_t &record)
+{
+    (void)destination_address;
+    this->report(record.target, 0, TRACEROUTE_TIMEOUT, 0);
+}
+
+/**
+ * @brief Reports a probe that could not be sent.
+ *
+ * @param probe
+ */
+void Traceroute::handle_send_error(const engine_probe_t &probe)
+{
+    this->report(probe.target, 0, TRACEROUTE_SEND_ERROR, 0);
+}
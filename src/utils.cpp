@@ -18,6 +18,17 @@
 #include <sys/socket.h>
 #include <netdb.h>
 #include <string.h>
+#include <errno.h>
+#include <getopt.h>
+#include <stdlib.h>
+#include <time.h>
+#include <string>
+#include <socket.hpp>
+#include <ipv4.hpp>
+#include <traceroute.hpp>
+#include <pmtu.hpp>
+#include <responder.hpp>
+#include <probe_table.hpp>
 
 /**
  * @brief Get the application addresses object
@@ -30,19 +41,382 @@
 void get_application_addresses(int received_addresses_num, char *received_addresses[],
                                uint32_t *source_address, uint32_t *destination_address)
 {
-    if (received_addresses_num < 3)
+    struct in_addr parsed;
+
+    if (received_addresses_num != 3)
     {
         throw Exception(EXCEPTION_MSG("UTILS - You need to pass <source IP> <destination IP>"));
     }
 
-    *source_address = inet_addr(received_addresses[1]);
-    if (*source_address < 0)
+    if (inet_pton(AF_INET, received_addresses[1], &parsed) != 1)
     {
         throw Exception(EXCEPTION_MSG("UTILS - Source IP invalid"));
     }
-    *destination_address = inet_addr(received_addresses[2]);
-    if (*destination_address < 0)
+    *source_address = parsed.s_addr;
+    if (inet_pton(AF_INET, received_addresses[2], &parsed) != 1)
     {
         throw Exception(EXCEPTION_MSG("UTILS - Destination IP invalid"));
     }
-}
\ No newline at end of file
+    *destination_address = parsed.s_addr;
+}
+
+/**
+ * @brief Parses a non-negative integer option value.
+ *
+ * @param value Option value.
+ * @param parsed Parsed value.
+ * @return true when the value is a non-negative integer.
+ */
+static bool parse_unsigned(const char *value, size_t *parsed)
+{
+    char *end;
+    unsigned long long number;
+
+    errno = 0;
+    number = strtoull(value, &end, 10);
+    if (errno != 0 || end == value || *end != '\0' || *value == '-')
+    {
+        return false;
+    }
+    *parsed = (size_t)number;
+    return true;
+}
+
+/**
+ * @brief Parses a positive integer option value.
+ *
+ * @param value Option value.
+ * @param parsed Parsed value.
+ * @return true when the value is a positive integer.
+ */
+static bool parse_positive(const char *value, size_t *parsed)
+{
+    return parse_unsigned(value, parsed) && *parsed != 0;
+}
+
+/**
+ * @brief Get the application options object
+ *
+ * usage: icmp-client [--metrics] [--quiet] [--count N] [--batch N] [--rate PPS]
+ *                    [--size N] [--pmtu] <source IP> <destination IP>
+ *        icmp-client sweep [--metrics] [--count N] [--in-flight N] [--timeout MS] [--retries N] [--file PATH]
+ *                    <source IP> [target IP | CIDR ...]
+ *        icmp-client traceroute [--metrics] [--max-ttl N] [--in-flight N] [--timeout MS] [--file PATH]
+ *                    <source IP> [target IP | CIDR ...]
+ *        icmp-client pmtu [--metrics] [--max-mtu N] [--in-flight N] [--timeout MS] [--file PATH]
+ *                    <source IP> [target IP | CIDR ...]
+ *        icmp-client timestamp [--metrics] [--count N] [--in-flight N] [--timeout MS] [--retries N]
+ *                    [--file PATH] <source IP> [target IP | CIDR ...]
+ *        icmp-client responder [--metrics] [--quiet] [--threads N]
+ *        icmp-client replay [--metrics] [--speed X | --speed max] <capture file>
+ *        icmp-client analyze [--quiet] [--threads N] <capture file>
+ *
+ * Every mode also takes --pcap PATH to capture the datagrams it sends and
+ * receives.
+ *
+ * @param argc
+ * @param argv
+ * @param options
+ */
+void get_application_options(int argc, char *argv[], application_options_t *options)
+{
+    static const struct option long_options[] = {
+        {"count", required_argument, nullptr, 'c'},
+        {"batch", required_argument, nullptr, 'b'},
+        {"in-flight", required_argument, nullptr, 'i'},
+        {"timeout", required_argument, nullptr, 't'},
+        {"file", required_argument, nullptr, 'f'},
+        {"retries", required_argument, nullptr, 'r'},
+        {"metrics", no_argument, nullptr, 'm'},
+        {"rate", required_argument, nullptr, 'R'},
+        {"quiet", no_argument, nullptr, 'q'},
+        {"size", required_argument, nullptr, 's'},
+        {"max-ttl", required_argument, nullptr, 'T'},
+        {"max-mtu", required_argument, nullptr, 'M'},
+        {"pmtu", no_argument, nullptr, 'P'},
+        {"threads", required_argument, nullptr, 'j'},
+        {"pcap", required_argument, nullptr, 'w'},
+        {"speed", required_argument, nullptr, 'S'},
+        {nullptr, 0, nullptr, 0}};
+    size_t value;
+    int option;
+
+    options->mode = MODE_PING;
+    options->count = 1;
+    options->batch = 1;
+    options->size = 0;
+    options->in_flight = 1024;
+    options->timeout = SOCKET_WAIT_TIMEOUT;
+    options->retries = 0;
+    options->targets_file = nullptr;
+    options->targets = nullptr;
+    options->targets_count = 0;
+    options->metrics = false;
+    options->rate = 0;
+    options->quiet = false;
+    options->max_ttl = TRACEROUTE_MAX_TTL;
+    options->max_mtu = PMTU_DEFAULT_MAX;
+    options->pmtu = false;
+    options->threads = 0;
+    options->pcap_file = nullptr;
+    options->capture_file = nullptr;
+    options->speed = 1.0;
+
+    /* The mode name, when present, takes the place of the program name. */
+    if (argc > 1)
+    {
+        if (strcmp(argv[1], "sweep") == 0)
+        {
+            options->mode = MODE_SWEEP;
+        }
+        else if (strcmp(argv[1], "traceroute") == 0)
+        {
+            options->mode = MODE_TRACEROUTE;
+        }
+        else if (strcmp(argv[1], "pmtu") == 0)
+        {
+            options->mode = MODE_PMTU;
+        }
+        else if (strcmp(argv[1], "timestamp") == 0)
+        {
+            options->mode = MODE_TIMESTAMP;
+        }
+        else if (strcmp(argv[1], "responder") == 0)
+        {
+            options->mode = MODE_RESPONDER;
+        }
+        else if (strcmp(argv[1], "replay") == 0)
+        {
+            options->mode = MODE_REPLAY;
+        }
+        else if (strcmp(argv[1], "analyze") == 0)
+        {
+            options->mode = MODE_ANALYZE;
+        }
+        if (options->mode != MODE_PING)
+        {
+            argc--;
+            argv++;
+        }
+    }
+
+    optind = 1;
+    while ((option = getopt_long(argc, argv, "c:b:i:t:f:r:mR:qs:T:M:Pj:w:S:", long_options, nullptr)) != -1)
+    {
+        switch (option)
+        {
+        case 'c':
+        {
+            if (!parse_positive(optarg, &options->count))
+            {
+                throw Exception(EXCEPTION_MSG("UTILS - Count must be a positive integer"));
+            }
+            break;
+        }
+        case 'b':
+        {
+            /* The ping mode maps a frame pool and sizes its vectors from it. */
+            if (!parse_positive(optarg, &options->batch) || options->batch > SOCKET_BATCH_LIMIT)
+            {
+                throw Exception(EXCEPTION_MSG("UTILS - Batch must be between 1 and 1024"));
+            }
+            break;
+        }
+        case 'i':
+        {
+            if (!parse_positive(optarg, &options->in_flight) ||
+                options->in_flight > PROBE_TABLE_MAX_IN_FLIGHT)
+            {
+                throw Exception(EXCEPTION_MSG("UTILS - In flight must be between 1 and 65535"));
+            }
+            break;
+        }
+        case 't':
+        {
+            if (!parse_positive(optarg, &value) || value > INT32_MAX)
+            {
+                throw Exception(EXCEPTION_MSG("UTILS - Timeout must be a positive integer"));
+            }
+            options->timeout = (int)value;
+            break;
+        }
+        case 'f':
+        {
+            options->targets_file = optarg;
+            break;
+        }
+        case 'r':
+        {
+            if (!parse_unsigned(optarg, &value) || value > UINT16_MAX)
+            {
+                throw Exception(EXCEPTION_MSG("UTILS - Retries must be a non-negative integer"));
+            }
+            options->retries = (uint16_t)value;
+            break;
+        }
+        case 'm':
+        {
+            options->metrics = true;
+            break;
+        }
+        case 'R':
+        {
+            if (!parse_positive(optarg, &options->rate))
+            {
+                throw Exception(EXCEPTION_MSG("UTILS - Rate must be a positive integer"));
+            }
+            break;
+        }
+        case 'q':
+        {
+            options->quiet = true;
+            break;
+        }
+        case 's':
+        {
+            if (!parse_unsigned(optarg, &options->size) || options->size > IP_MAX_LENGTH)
+            {
+                throw Exception(EXCEPTION_MSG("UTILS - Size must be a payload length in octets"));
+            }
+            break;
+        }
+        case 'T':
+        {
+            if (!parse_positive(optarg, &value) || value > TRACEROUTE_TTL_LIMIT)
+            {
+                throw Exception(EXCEPTION_MSG("UTILS - Max TTL must be between 1 and 255"));
+            }
+            options->max_ttl = (uint8_t)value;
+            break;
+        }
+        case 'M':
+        {
+            if (!parse_positive(optarg, &value) || value < PMTU_MIN || value > IP_MAX_LENGTH)
+            {
+                throw Exception(EXCEPTION_MSG("UTILS - Max MTU must be between 68 and 65535"));
+            }
+            options->max_mtu = (uint16_t)value;
+            break;
+        }
+        case 'P':
+        {
+            options->pmtu = true;
+            break;
+        }
+        case 'j':
+        {
+            if (!parse_positive(optarg, &options->threads) || options->threads > RESPONDER_MAX_THREADS)
+            {
+                throw Exception(EXCEPTION_MSG("UTILS - Threads must be between 1 and 256"));
+            }
+            break;
+        }
+        case 'w':
+        {
+            options->pcap_file = optarg;
+            break;
+        }
+        case 'S':
+        {
+            char *end;
+
+            if (strcmp(optarg, "max") == 0)
+            {
+                options->speed = 0;
+                break;
+            }
+            errno = 0;
+            options->speed = strtod(optarg, &end);
+            if (errno != 0 || end == optarg || *end != '\0' || !(options->speed > 0))
+            {
+                throw Exception(EXCEPTION_MSG("UTILS - Speed must be a positive factor or max"));
+            }
+            break;
+        }
+        default:
+        {
+            throw Exception(EXCEPTION_MSG("UTILS - Usage: [sweep | traceroute | pmtu | timestamp | responder | replay | analyze] [options] <source IP> <destination IP | targets>"));
+        }
+        }
+    }
+
+    if (options->mode == MODE_RESPONDER)
+    {
+        return;
+    }
+
+    if (options->mode == MODE_REPLAY || options->mode == MODE_ANALYZE)
+    {
+        if (optind >= argc)
+        {
+            throw Exception(EXCEPTION_MSG("UTILS - You need to pass <capture file>"));
+        }
+        options->capture_file = argv[optind];
+        return;
+    }
+
+    if (options->mode != MODE_PING)
+    {
+        if (optind >= argc)
+        {
+            throw Exception(EXCEPTION_MSG("UTILS - You need to pass <source IP> [targets]"));
+        }
+        options->source_address = get_address(argv[optind]);
+        options->targets = &argv[optind + 1];
+        options->targets_count = argc - optind - 1;
+        if (options->targets_count == 0 && options->targets_file == nullptr)
+        {
+            throw Exception(EXCEPTION_MSG("UTILS - You need to pass targets or --file"));
+        }
+        return;
+    }
+
+    get_application_addresses(argc - optind + 1, &argv[optind - 1],
+                              &options->source_address, &options->destination_address);
+}
+
+/**
+ * @brief Parses a dotted-quad address.
+ *
+ * @param address
+ * @return uint32_t Address, in network byte order.
+ */
+uint32_t get_address(const char *address)
+{
+    struct in_addr parsed;
+
+    if (inet_pton(AF_INET, address, &parsed) != 1)
+    {
+        throw Exception(EXCEPTION_MSG("UTILS - Address invalid"));
+    }
+    return parsed.s_addr;
+}
+
+/**
+ * @brief Get the current time in nanoseconds, from the same clock as the
+ * socket receive timestamps (CLOCK_REALTIME).
+ *
+ * @return uint64_t
+ */
+uint64_t get_timestamp()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_REALTIME, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+/**
+ * @brief Get the current time in nanoseconds from CLOCK_MONOTONIC, which
+ * never steps when the wall clock is set. For deadlines and timers; round
+ * trip times use get_timestamp, like the socket receive timestamps.
+ *
+ * @return uint64_t
+ */
+uint64_t get_monotonic_timestamp()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}